@@ -0,0 +1,104 @@
+#include "ArenaAllocator.h"
+
+// Every block is prefixed with its size
+#define ARENA_HEADER_SIZE sizeof(size_t)
+
+ArenaAllocator::ArenaAllocator(uint8_t *buffer, size_t size)
+{
+    _buffer = buffer;
+    _size = size;
+}
+
+void *ArenaAllocator::allocate(size_t size)
+{
+    size_t blockSize = ARENA_HEADER_SIZE + Align(size);
+    if(_top + blockSize > _size)
+    {
+        return nullptr;
+    }
+
+    memcpy(_buffer + _top, &size, sizeof(size));
+    _last = _top;
+    _top += blockSize;
+
+    if(_top > _peak)
+    {
+        _peak = _top;
+    }
+
+    return _buffer + _last + ARENA_HEADER_SIZE;
+}
+
+void ArenaAllocator::deallocate(void *pointer)
+{
+    if(pointer == nullptr)
+    {
+        return;
+    }
+
+    // Only the newest block is returned to the arena, the rest waits for Reset()
+    if((uint8_t *)pointer == _buffer + _last + ARENA_HEADER_SIZE && _top > 0)
+    {
+        _top = _last;
+    }
+}
+
+void *ArenaAllocator::reallocate(void *pointer, size_t newSize)
+{
+    if(pointer == nullptr)
+    {
+        return allocate(newSize);
+    }
+
+    size_t offset = (uint8_t *)pointer - _buffer - ARENA_HEADER_SIZE;
+    if(offset == _last && _top > _last)
+    {
+        size_t blockSize = ARENA_HEADER_SIZE + Align(newSize);
+        if(_last + blockSize > _size)
+        {
+            return nullptr;
+        }
+
+        memcpy(_buffer + _last, &newSize, sizeof(newSize));
+        _top = _last + blockSize;
+
+        if(_top > _peak)
+        {
+            _peak = _top;
+        }
+
+        return pointer;
+    }
+
+    size_t oldSize = GetBlockSize(offset);
+    void *block = allocate(newSize);
+    if(block != nullptr)
+    {
+        memcpy(block, pointer, (oldSize < newSize) ? oldSize : newSize);
+    }
+
+    return block;
+}
+
+void ArenaAllocator::Reset()
+{
+    _top = 0;
+    _last = 0;
+}
+
+size_t ArenaAllocator::GetPeak()
+{
+    return _peak;
+}
+
+size_t ArenaAllocator::Align(size_t size)
+{
+    return (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+}
+
+size_t ArenaAllocator::GetBlockSize(size_t offset)
+{
+    size_t size;
+    memcpy(&size, _buffer + offset, sizeof(size));
+    return size;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <Hal.h>
+#include <ArduinoJson.h>
+
+// Bump allocator over a caller owned buffer, so a JsonDocument never touches
+// the heap. Only the newest block can shrink, grow in place or be given back,
+// which is how ArduinoJson uses strings and pools during a single parse.
+// Reset() releases everything at once.
+
+class ArenaAllocator : public ArduinoJson::Allocator
+{
+private:
+    uint8_t *_buffer;
+    size_t _size;
+    size_t _top = 0;
+    size_t _last = 0;
+    size_t _peak = 0;
+    static size_t Align(size_t size);
+    size_t GetBlockSize(size_t offset);
+
+public:
+    ArenaAllocator(uint8_t *buffer, size_t size);
+    void *allocate(size_t size) override;
+    void deallocate(void *pointer) override;
+    void *reallocate(void *pointer, size_t newSize) override;
+    void Reset();
+    size_t GetPeak();
+};
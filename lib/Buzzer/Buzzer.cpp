@@ -5,13 +5,13 @@ Buzzer_Class BUZZER;
 void Buzzer_Class::InitBuzzer(uint32_t pin)
 {
     _pin = pin;
-    pinMode(pin, OUTPUT);
+    HalPinMode(pin, OUTPUT);
     InternalTone();
-    delay(50);
+    HalDelay(50);
     InternalNoTone();
-    delay(50);
+    HalDelay(50);
     InternalTone();
-    delay(50);
+    HalDelay(50);
     InternalNoTone();
 }
 
@@ -21,7 +21,7 @@ void Buzzer_Class::Tick()
     {
         case BEEP_IDLE: break;
         case BEEP_SHORT:
-            if(millis() - beepMillis <= 50)
+            if(HalMillis() - beepMillis <= 50)
             {
                 InternalTone();
             }
@@ -32,7 +32,7 @@ void Buzzer_Class::Tick()
             }
             break;
         case BEEP_LONG:
-            if(millis() - beepMillis <= 150)
+            if(HalMillis() - beepMillis <= 150)
             {
                 InternalTone();
             }
@@ -46,16 +46,16 @@ void Buzzer_Class::Tick()
             if(beepCount >= 2)
                 buzzerState = BEEP_IDLE;
 
-            if(millis() - beepMillis <= 200)
+            if(HalMillis() - beepMillis <= 200)
             {
                 InternalTone();
             }
             else
             {
                 InternalNoTone();
-                delay(10);
+                HalDelay(10);
                 beepCount++;
-                beepMillis = millis();
+                beepMillis = HalMillis();
             }
 
             break;
@@ -68,7 +68,7 @@ void Buzzer_Class::Single()
         return;
 
     buzzerStatus = BEEP_SHORT; 
-    beepMillis = millis();
+    beepMillis = HalMillis();
 }
 
 void Buzzer_Class::Long()
@@ -77,7 +77,7 @@ void Buzzer_Class::Long()
         return;
 
     buzzerStatus = BEEP_LONG; 
-    beepMillis = millis();
+    beepMillis = HalMillis();
 }
 
 void Buzzer_Class::Double()
@@ -86,15 +86,15 @@ void Buzzer_Class::Double()
         return;
 
     buzzerStatus = BEEP_DOUBLE; 
-    beepMillis = millis();
+    beepMillis = HalMillis();
 }
 
 void Buzzer_Class::InternalTone()
 {
-    tone(_pin, 4000);
+    HalTone(_pin, 4000);
 }
 
 void Buzzer_Class::InternalNoTone()
 {
-    noTone(_pin);
+    HalNoTone(_pin);
 }
\ No newline at end of file
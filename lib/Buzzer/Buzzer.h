@@ -1,4 +1,5 @@
-#include <Arduino.h>
+#pragma once
+#include <Hal.h>
 
 enum Buzzer_Status
 {
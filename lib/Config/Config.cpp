@@ -0,0 +1,316 @@
+#include "Config.h"
+#include <Crc32.h>
+#include <MsgPack.h>
+
+#define CONFIG_FIELD(key, type, field) {key, type, offsetof(Configuration, field), #field}
+#define CONFIG_KEYFRAME(key, led, number) {key, FIELD_KEYFRAME, offsetof(Configuration, led##_keyframes) + (number - 1) * sizeof(uint32_t), #led "_keyframe" #number}
+
+Configuration _config;
+volatile uint32_t configDirty[CONFIG_DIRTY_WORDS];
+volatile uint32_t configDirtyMillis = 0;
+
+// Keys are stored on the card, never renumber or reuse a retired key
+const ConfigField configFields[] =
+{
+    CONFIG_FIELD(10, FIELD_UINT8, whiteLed_onTimeHour),
+    CONFIG_FIELD(11, FIELD_UINT8, whiteLed_onTimeMinute),
+    CONFIG_FIELD(12, FIELD_UINT8, whiteLed_offTimeHour),
+    CONFIG_FIELD(13, FIELD_UINT8, whiteLed_offTimeMinute),
+    CONFIG_FIELD(14, FIELD_UINT8, whiteLed_rampUp),
+    CONFIG_FIELD(15, FIELD_UINT8, whiteLed_rampDown),
+    CONFIG_FIELD(16, FIELD_UINT8, whiteLed_maxDuty),
+
+    CONFIG_FIELD(20, FIELD_UINT8, colorLed_onTimeHour),
+    CONFIG_FIELD(21, FIELD_UINT8, colorLed_onTimeMinute),
+    CONFIG_FIELD(22, FIELD_UINT8, colorLed_offTimeHour),
+    CONFIG_FIELD(23, FIELD_UINT8, colorLed_offTimeMinute),
+    CONFIG_FIELD(24, FIELD_UINT8, colorLed_rampUp),
+    CONFIG_FIELD(25, FIELD_UINT8, colorLed_rampDown),
+    CONFIG_FIELD(26, FIELD_UINT8, colorLed_maxDuty),
+
+    CONFIG_FIELD(70, FIELD_UINT8, weather_mode),
+    CONFIG_FIELD(71, FIELD_UINT8, weather_depth),
+
+    CONFIG_FIELD(30, FIELD_UINT8, pump1_onTimeHour),
+    CONFIG_FIELD(31, FIELD_UINT8, pump1_onTimeMinute),
+    CONFIG_FIELD(32, FIELD_UINT8, pump1_duty),
+    CONFIG_FIELD(33, FIELD_MILLI, pump1_volume_bottle),
+    CONFIG_FIELD(34, FIELD_MILLI, pump1_volume),
+    CONFIG_FIELD(35, FIELD_MILLI, pump1_calibrationOffset),
+    CONFIG_FIELD(36, FIELD_BOOL, pump1_enable),
+
+    CONFIG_FIELD(40, FIELD_UINT8, pump2_onTimeHour),
+    CONFIG_FIELD(41, FIELD_UINT8, pump2_onTimeMinute),
+    CONFIG_FIELD(42, FIELD_UINT8, pump2_duty),
+    CONFIG_FIELD(43, FIELD_MILLI, pump2_volume_bottle),
+    CONFIG_FIELD(44, FIELD_MILLI, pump2_volume),
+    CONFIG_FIELD(45, FIELD_MILLI, pump2_calibrationOffset),
+    CONFIG_FIELD(46, FIELD_BOOL, pump2_enable),
+
+    CONFIG_FIELD(50, FIELD_UINT8, pump3_onTimeHour),
+    CONFIG_FIELD(51, FIELD_UINT8, pump3_onTimeMinute),
+    CONFIG_FIELD(52, FIELD_UINT8, pump3_duty),
+    CONFIG_FIELD(53, FIELD_MILLI, pump3_volume_bottle),
+    CONFIG_FIELD(54, FIELD_MILLI, pump3_volume),
+    CONFIG_FIELD(55, FIELD_MILLI, pump3_calibrationOffset),
+    CONFIG_FIELD(56, FIELD_BOOL, pump3_enable),
+
+    CONFIG_FIELD(60, FIELD_UINT8, pump4_onTimeHour),
+    CONFIG_FIELD(61, FIELD_UINT8, pump4_onTimeMinute),
+    CONFIG_FIELD(62, FIELD_UINT8, pump4_duty),
+    CONFIG_FIELD(63, FIELD_MILLI, pump4_volume_bottle),
+    CONFIG_FIELD(64, FIELD_MILLI, pump4_volume),
+    CONFIG_FIELD(65, FIELD_MILLI, pump4_calibrationOffset),
+    CONFIG_FIELD(66, FIELD_BOOL, pump4_enable),
+
+    CONFIG_KEYFRAME(100, whiteLed, 1),
+    CONFIG_KEYFRAME(101, whiteLed, 2),
+    CONFIG_KEYFRAME(102, whiteLed, 3),
+    CONFIG_KEYFRAME(103, whiteLed, 4),
+    CONFIG_KEYFRAME(104, whiteLed, 5),
+    CONFIG_KEYFRAME(105, whiteLed, 6),
+    CONFIG_KEYFRAME(106, whiteLed, 7),
+    CONFIG_KEYFRAME(107, whiteLed, 8),
+    CONFIG_KEYFRAME(108, whiteLed, 9),
+    CONFIG_KEYFRAME(109, whiteLed, 10),
+    CONFIG_KEYFRAME(110, whiteLed, 11),
+    CONFIG_KEYFRAME(111, whiteLed, 12),
+    CONFIG_KEYFRAME(112, whiteLed, 13),
+    CONFIG_KEYFRAME(113, whiteLed, 14),
+    CONFIG_KEYFRAME(114, whiteLed, 15),
+    CONFIG_KEYFRAME(115, whiteLed, 16),
+
+    CONFIG_KEYFRAME(120, colorLed, 1),
+    CONFIG_KEYFRAME(121, colorLed, 2),
+    CONFIG_KEYFRAME(122, colorLed, 3),
+    CONFIG_KEYFRAME(123, colorLed, 4),
+    CONFIG_KEYFRAME(124, colorLed, 5),
+    CONFIG_KEYFRAME(125, colorLed, 6),
+    CONFIG_KEYFRAME(126, colorLed, 7),
+    CONFIG_KEYFRAME(127, colorLed, 8),
+    CONFIG_KEYFRAME(128, colorLed, 9),
+    CONFIG_KEYFRAME(129, colorLed, 10),
+    CONFIG_KEYFRAME(130, colorLed, 11),
+    CONFIG_KEYFRAME(131, colorLed, 12),
+    CONFIG_KEYFRAME(132, colorLed, 13),
+    CONFIG_KEYFRAME(133, colorLed, 14),
+    CONFIG_KEYFRAME(134, colorLed, 15),
+    CONFIG_KEYFRAME(135, colorLed, 16)
+};
+
+size_t Config_Encode(const Configuration *config, uint32_t sequence, uint8_t *buffer, size_t size)
+{
+    ConfigHeader header;
+    if(size <= sizeof(header))
+    {
+        return 0;
+    }
+
+    MsgPackWriter writer(buffer + sizeof(header), size - sizeof(header));
+    writer.WriteMapHeader(CONFIG_FIELD_COUNT);
+
+    for(size_t i = 0; i < CONFIG_FIELD_COUNT; i++)
+    {
+        void *field = Config_FieldPtr((Configuration *)config, &configFields[i]);
+        writer.WriteUint(configFields[i].key);
+
+        switch (configFields[i].type)
+        {
+        case FIELD_UINT8:
+            writer.WriteUint(*(uint8_t *)field);
+            break;
+
+        case FIELD_MILLI:
+            writer.WriteFloat(Config_MilliToFloat(*(int32_t *)field));
+            break;
+
+        case FIELD_BOOL:
+            writer.WriteBool(*(bool *)field);
+            break;
+
+        case FIELD_KEYFRAME:
+            writer.WriteUint(*(uint32_t *)field);
+            break;
+        }
+    }
+
+    if(writer.IsOverflow())
+    {
+        return 0;
+    }
+
+    header.magic = CONFIG_MAGIC;
+    header.version = CONFIG_VERSION;
+    header.length = writer.GetLength();
+    header.crc = Crc32(buffer + sizeof(header), header.length);
+    header.sequence = sequence;
+    memcpy(buffer, &header, sizeof(header));
+
+    return sizeof(header) + header.length;
+}
+
+bool Config_Decode(Configuration *config, const uint8_t *buffer, size_t length, uint32_t *sequence)
+{
+    ConfigHeader header = {};
+    size_t headerSize;
+    if(length < CONFIG_HEADER_V1_SIZE)
+    {
+        return false;
+    }
+
+    memcpy(&header, buffer, CONFIG_HEADER_V1_SIZE);
+    headerSize = (header.version < 2) ? CONFIG_HEADER_V1_SIZE : sizeof(header);
+    if(length < headerSize)
+    {
+        return false;
+    }
+
+    memcpy(&header, buffer, headerSize);
+    if(header.magic != CONFIG_MAGIC || header.version > CONFIG_VERSION || header.length != length - headerSize)
+    {
+        return false;
+    }
+
+    if(Crc32(buffer + headerSize, header.length) != header.crc)
+    {
+        return false;
+    }
+
+    *sequence = header.sequence;
+    MsgPackReader reader(buffer + headerSize, header.length);
+    uint16_t count;
+    if(!reader.ReadMapHeader(&count))
+    {
+        return false;
+    }
+
+    for(uint16_t i = 0; i < count; i++)
+    {
+        MsgPackValue key;
+        MsgPackValue value;
+        if(!reader.ReadValue(&key) || !reader.ReadValue(&value))
+        {
+            return false;
+        }
+
+        // Unknown keys belong to newer firmware, skip them
+        const ConfigField *field = (key.type == MSGPACK_UINT && key.u <= 0xFF) ? Config_FindField(key.u) : nullptr;
+        if(field == nullptr) {continue;}
+
+        switch (field->type)
+        {
+        case FIELD_UINT8:
+            if(value.type == MSGPACK_UINT && value.u <= 0xFF) {Config_SetBits(config, field, value.u);}
+            break;
+
+        case FIELD_MILLI:
+            if(value.type == MSGPACK_UINT) {value.f = value.u;}
+            if(value.type == MSGPACK_INT) {value.f = value.i;}
+            if(value.type == MSGPACK_FLOAT || value.type == MSGPACK_UINT || value.type == MSGPACK_INT) {*(int32_t *)Config_FieldPtr(config, field) = Config_FloatToMilli(value.f);}
+            break;
+
+        case FIELD_BOOL:
+            if(value.type == MSGPACK_BOOL) {Config_SetBits(config, field, value.b);}
+            break;
+
+        case FIELD_KEYFRAME:
+            if(value.type == MSGPACK_UINT) {Config_SetBits(config, field, value.u);}
+            break;
+        }
+    }
+
+    return true;
+}
+
+void *Config_FieldPtr(Configuration *config, const ConfigField *field)
+{
+    return (uint8_t *)config + field->offset;
+}
+
+uint32_t Config_GetBits(Configuration *config, const ConfigField *field)
+{
+    void *ptr = Config_FieldPtr(config, field);
+    uint32_t bits = 0;
+    float value;
+
+    switch (field->type)
+    {
+    case FIELD_UINT8: bits = *(uint8_t *)ptr; break;
+    case FIELD_MILLI: value = Config_MilliToFloat(*(int32_t *)ptr); memcpy(&bits, &value, sizeof(value)); break;
+    case FIELD_BOOL: bits = *(bool *)ptr; break;
+    case FIELD_KEYFRAME: bits = *(uint32_t *)ptr; break;
+    }
+
+    return bits;
+}
+
+void Config_SetBits(Configuration *config, const ConfigField *field, uint32_t bits)
+{
+    void *ptr = Config_FieldPtr(config, field);
+    float value;
+
+    switch (field->type)
+    {
+    case FIELD_UINT8: *(uint8_t *)ptr = bits; break;
+    case FIELD_MILLI: memcpy(&value, &bits, sizeof(value)); *(int32_t *)ptr = Config_FloatToMilli(value); break;
+    case FIELD_BOOL: *(bool *)ptr = (bits != 0); break;
+    case FIELD_KEYFRAME: *(uint32_t *)ptr = bits; break;
+    }
+}
+
+void Config_MarkDirty(const void *field)
+{
+    uintptr_t offset = (uintptr_t)field - (uintptr_t)&_config;
+
+    for(size_t i = 0; i < CONFIG_FIELD_COUNT; i++)
+    {
+        if(configFields[i].offset == offset)
+        {
+            Config_SetDirty(i);
+            return;
+        }
+    }
+}
+
+void Config_SetDirty(size_t index)
+{
+    __atomic_fetch_or(&configDirty[index / 32], 1UL << (index % 32), __ATOMIC_RELAXED);
+    configDirtyMillis = HalMillis();
+}
+
+bool Config_IsDirty()
+{
+    for(uint8_t i = 0; i < CONFIG_DIRTY_WORDS; i++)
+    {
+        if(configDirty[i] != 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const ConfigField *Config_FindField(uint8_t key)
+{
+    for(size_t i = 0; i < CONFIG_FIELD_COUNT; i++)
+    {
+        if(configFields[i].key == key)
+        {
+            return &configFields[i];
+        }
+    }
+
+    return nullptr;
+}
+
+// Only the codecs convert, files and flash keep the float ml of older firmware
+float Config_MilliToFloat(int32_t value)
+{
+    return value / 1000.0F;
+}
+
+int32_t Config_FloatToMilli(float value)
+{
+    return (int32_t)(value * 1000.0F + (value < 0 ? -0.5F : 0.5F));
+}
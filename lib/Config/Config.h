@@ -0,0 +1,139 @@
+#pragma once
+#include <Hal.h>
+
+// The settings and how they are stored. Every persisted field has an entry in
+// configFields, the codecs and the dirty tracking all walk that table.
+
+#define CONFIG_LED_KEYFRAMES  16
+
+struct Configuration
+{
+    // WHITE LED
+    uint8_t whiteLed_onTimeHour = 12;
+    uint8_t whiteLed_onTimeMinute = 0;
+    uint8_t whiteLed_offTimeHour = 20;
+    uint8_t whiteLed_offTimeMinute = 0;
+    uint8_t whiteLed_rampUp = 30;
+    uint8_t whiteLed_rampDown = 30;
+    uint8_t whiteLed_maxDuty = 100;
+
+    // COLOR LED
+    uint8_t colorLed_onTimeHour = 12;
+    uint8_t colorLed_onTimeMinute = 0;
+    uint8_t colorLed_offTimeHour = 20;
+    uint8_t colorLed_offTimeMinute = 0;
+    uint8_t colorLed_rampUp = 30;
+    uint8_t colorLed_rampDown = 30;
+    uint8_t colorLed_maxDuty = 100;
+
+    // LED PROFILES, keyframe words (LightProfile::Pack), 0 is an unused slot.
+    // With any keyframe set the profile replaces the on/off times and ramps
+    uint32_t whiteLed_keyframes[CONFIG_LED_KEYFRAMES] = {};
+    uint32_t colorLed_keyframes[CONFIG_LED_KEYFRAMES] = {};
+
+    // WEATHER, weatherMode and the dip under full cloud cover in percent
+    uint8_t weather_mode = 0;
+    uint8_t weather_depth = 40;
+
+    // PUMP 1, volumes in thousandths of a ml. The calibration offset is the
+    // volume one 5 second calibration run delivered. The names are labels
+    // built into the firmware, not settings: they have no entry in
+    // configFields, the old JSON never stored them and a pumpN_name key in an
+    // imported file is ignored
+    const char *pump1_name = "------FE-------";
+    uint8_t pump1_onTimeHour = 12;
+    uint8_t pump1_onTimeMinute = 0;
+    uint8_t pump1_duty = 100;
+    int32_t pump1_volume_bottle = 450000;
+    int32_t pump1_volume = 5000;
+    int32_t pump1_calibrationOffset = 0;
+    bool pump1_enable = false;
+
+    // PUMP 2
+    const char *pump2_name = "-----Tropica-------";
+    uint8_t pump2_onTimeHour = 12;
+    uint8_t pump2_onTimeMinute = 0;
+    uint8_t pump2_duty = 100;
+    int32_t pump2_volume_bottle = 450000;
+    int32_t pump2_volume = 5000;
+    int32_t pump2_calibrationOffset = 0;
+    bool pump2_enable = false;
+
+    // PUMP 3
+    const char *pump3_name = "-------------------";
+    uint8_t pump3_onTimeHour = 12;
+    uint8_t pump3_onTimeMinute = 0;
+    uint8_t pump3_duty = 100;
+    int32_t pump3_volume_bottle = 450000;
+    int32_t pump3_volume = 5000;
+    int32_t pump3_calibrationOffset = 0;
+    bool pump3_enable = false;
+
+    // PUMP 4
+    const char *pump4_name = "--------CO2--------";
+    uint8_t pump4_onTimeHour = 12;
+    uint8_t pump4_onTimeMinute = 0;
+    uint8_t pump4_duty = 100;
+    int32_t pump4_volume_bottle = 450000;
+    int32_t pump4_volume = 5000;
+    int32_t pump4_calibrationOffset = 0;
+    bool pump4_enable = false;
+
+    // RTC
+    uint16_t years = 2024;
+    uint8_t months = 1;
+    uint8_t days = 1;
+    uint8_t hours = 0;
+    uint8_t minutes = 0;
+};
+
+extern Configuration _config;
+
+#define CONFIG_MAGIC          0x46435141UL
+#define CONFIG_VERSION        2
+#define CONFIG_FIELD_COUNT    76
+#define CONFIG_DIRTY_WORDS    ((CONFIG_FIELD_COUNT + 31) / 32)
+
+enum configFieldType
+{
+    FIELD_UINT8,
+    FIELD_MILLI,    // int32_t thousandths, stored as float ml like the old float fields
+    FIELD_BOOL,
+    FIELD_KEYFRAME  // uint32_t keyframe word, [hour, minute, level, easing] in JSON
+};
+
+struct ConfigField
+{
+    uint8_t key;
+    uint8_t type;
+    uint16_t offset;
+    const char *name;
+};
+
+struct ConfigHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t crc;
+    uint32_t sequence;
+};
+
+// Version 1 files ended the header before the sequence number
+#define CONFIG_HEADER_V1_SIZE offsetof(ConfigHeader, sequence)
+
+extern const ConfigField configFields[CONFIG_FIELD_COUNT];
+extern volatile uint32_t configDirty[CONFIG_DIRTY_WORDS];
+extern volatile uint32_t configDirtyMillis;
+
+size_t Config_Encode(const Configuration *config, uint32_t sequence, uint8_t *buffer, size_t size);
+bool Config_Decode(Configuration *config, const uint8_t *buffer, size_t length, uint32_t *sequence);
+void *Config_FieldPtr(Configuration *config, const ConfigField *field);
+uint32_t Config_GetBits(Configuration *config, const ConfigField *field);
+void Config_SetBits(Configuration *config, const ConfigField *field, uint32_t bits);
+const ConfigField *Config_FindField(uint8_t key);
+float Config_MilliToFloat(int32_t value);
+int32_t Config_FloatToMilli(float value);
+void Config_MarkDirty(const void *field);
+void Config_SetDirty(size_t index);
+bool Config_IsDirty();
@@ -0,0 +1,349 @@
+#include "Controller.h"
+#include <Buzzer.h>
+#include <Profiler.h>
+
+Controller::Controller(Configuration *config, TimeRTC *timeRTC, Pump **pumps, Led *whiteLed, Led *colorLed)
+{
+    _config = config;
+    _timeRTC = timeRTC;
+    _pumps = pumps;
+    AttachLed(whiteLed, LED_GROUP_WHITE);
+    AttachLed(colorLed, LED_GROUP_COLOR);
+}
+
+// Before ApplyConfig(), the LED takes its group's parameters from there on
+boolean Controller::AttachLed(Led *led, uint8_t group)
+{
+    if(_ledCount >= CONTROLLER_LED_COUNT)
+        return false;
+
+    _leds[_ledCount] = led;
+    _ledGroups[_ledCount] = group;
+    _ledCount++;
+    return true;
+}
+
+void Controller::ApplyConfig()
+{
+    for(uint8_t i = 0; i < _ledCount; i++)
+    {
+        if(_ledGroups[i] == LED_GROUP_WHITE)
+            _leds[i]->SetParameters(_config->whiteLed_maxDuty, _config->whiteLed_rampUp, _config->whiteLed_rampDown);
+        else
+            _leds[i]->SetParameters(_config->colorLed_maxDuty, _config->colorLed_rampUp, _config->colorLed_rampDown);
+    }
+
+    _pumps[0]->SetParameters(_config->pump1_duty, _config->pump1_volume, _config->pump1_calibrationOffset);
+    _pumps[1]->SetParameters(_config->pump2_duty, _config->pump2_volume, _config->pump2_calibrationOffset);
+    _pumps[2]->SetParameters(_config->pump3_duty, _config->pump3_volume, _config->pump3_calibrationOffset);
+    _pumps[3]->SetParameters(_config->pump4_duty, _config->pump4_volume, _config->pump4_calibrationOffset);
+    CompileProfile(&_whiteProfile, _config->whiteLed_keyframes);
+    CompileProfile(&_colorProfile, _config->colorLed_keyframes);
+    _weather.SetMode(_config->weather_mode, _config->weather_depth);
+    for(uint8_t i = 0; i < _ledCount; i++)
+    {
+        _leds[i]->SetEffect(LED_EFFECT_ONE, 0);
+    }
+
+    CompileSchedule();
+}
+
+void Controller::Tick()
+{
+    PROFILER.Start(PROFILE_LED);
+    if(_timeRTC->IsTimeUpdated())
+    {
+        _secondMillis = HalMillis();
+    }
+
+    // Profile levels first, a resync below fades in to them. The weather is
+    // seeded with the day and only recomputed once per WEATHER_STEP_MS
+    if(_whiteProfile.IsActive() || _colorProfile.IsActive() || _weather.IsActive())
+    {
+        uint32_t millisOfDay = GetMillisOfDay();
+        int whiteLevel = _whiteProfile.IsActive() ? _whiteProfile.GetLevel(millisOfDay) : -1;
+        int colorLevel = _colorProfile.IsActive() ? _colorProfile.GetLevel(millisOfDay) : -1;
+        for(uint8_t i = 0; i < _ledCount; i++)
+        {
+            int level = (_ledGroups[i] == LED_GROUP_WHITE) ? whiteLevel : colorLevel;
+            if(level >= 0) {_leds[i]->SetLevel(level);}
+        }
+
+        if(_weather.Update(_timeRTC->GetUnixTime() / 86400UL, millisOfDay))
+        {
+            for(uint8_t i = 0; i < _ledCount; i++)
+            {
+                bool isFlash = (_ledGroups[i] == LED_GROUP_COLOR && _weather.IsFlash());
+                _leds[i]->SetEffect(_weather.GetScale(), isFlash ? HAL_PWM_MAX : 0);
+            }
+        }
+    }
+
+    for(uint8_t i = 0; i < _ledCount; i++)
+    {
+        _leds[i]->Tick();
+    }
+    PROFILER.Stop(PROFILE_LED);
+
+    PROFILER.Start(PROFILE_PUMP);
+    for(uint8_t i = 0; i < CONTROLLER_PUMP_COUNT; i++)
+    {
+        _pumps[i]->Tick();
+    }
+    PROFILER.Stop(PROFILE_PUMP);
+
+    PROFILER.Start(PROFILE_SCHEDULE);
+    if(_schedule.Sync(_timeRTC->GetSecondOfDay()))
+    {
+        CheckLedRepeatOn();
+    }
+
+    uint8_t event;
+    while(_schedule.Next(&event))
+    {
+        CheckPumpOn(event);
+        CheckLedOn(event);
+    }
+    PROFILER.Stop(PROFILE_SCHEDULE);
+}
+
+void Controller::DoCommand(const ControlCommand &command)
+{
+    switch (command.type)
+    {
+        case CONTROL_APPLY_CONFIG: ApplyConfig(); break;
+        case CONTROL_LED_MANUAL: GroupDo(command.index, &Led::Manual); break;
+        case CONTROL_LED_DUTY:
+            for(uint8_t i = 0; i < _ledCount; i++)
+            {
+                if(_ledGroups[i] == command.index) {_leds[i]->UpdateDuty(command.duty);}
+            }
+            break;
+        case CONTROL_PUMP_DOSE: CheckPumpOn(EVENT_PUMP_1 + command.index); break;
+        case CONTROL_PUMP_START: _pumps[command.index]->Start(); break;
+        case CONTROL_PUMP_ENABLE: _pumps[command.index]->Enable(); break;
+        case CONTROL_PUMP_DISABLE: _pumps[command.index]->Disable(); break;
+        case CONTROL_PUMP_CALIBRATE: _pumps[command.index]->SetParameters(command.duty, 5000, command.value); break;
+        case CONTROL_BOTTLE_RESET:
+            switch (command.index)
+            {
+                case 0: _config->pump1_volume_bottle = BOTTLE_VOLUME_FULL; Config_MarkDirty(&_config->pump1_volume_bottle); break;
+                case 1: _config->pump2_volume_bottle = BOTTLE_VOLUME_FULL; Config_MarkDirty(&_config->pump2_volume_bottle); break;
+                case 2: _config->pump3_volume_bottle = BOTTLE_VOLUME_FULL; Config_MarkDirty(&_config->pump3_volume_bottle); break;
+                case 3: _config->pump4_volume_bottle = BOTTLE_VOLUME_FULL; Config_MarkDirty(&_config->pump4_volume_bottle); break;
+            }
+            _isBottleWarning = false;
+            break;
+    }
+}
+
+void Controller::CompileSchedule()
+{
+    _schedule.Clear();
+
+    // WHITE LED, a profile takes over the on/off times
+    if(!_whiteProfile.IsActive())
+    {
+        _schedule.Add(Schedule::SecondOfDay(_config->whiteLed_onTimeHour, _config->whiteLed_onTimeMinute, 0), EVENT_WHITE_LED_ON);
+        _schedule.Add(Schedule::SecondOfDay(_config->whiteLed_offTimeHour, _config->whiteLed_offTimeMinute, 0), EVENT_WHITE_LED_OFF);
+    }
+
+    // COLOR LED
+    if(!_colorProfile.IsActive())
+    {
+        _schedule.Add(Schedule::SecondOfDay(_config->colorLed_onTimeHour, _config->colorLed_onTimeMinute, 0), EVENT_COLOR_LED_ON);
+        _schedule.Add(Schedule::SecondOfDay(_config->colorLed_offTimeHour, _config->colorLed_offTimeMinute, 0), EVENT_COLOR_LED_OFF);
+    }
+
+    // PUMPS
+    if(_config->pump1_enable) {_schedule.Add(Schedule::SecondOfDay(_config->pump1_onTimeHour, _config->pump1_onTimeMinute, 0), EVENT_PUMP_1);}
+    if(_config->pump2_enable) {_schedule.Add(Schedule::SecondOfDay(_config->pump2_onTimeHour, _config->pump2_onTimeMinute, 0), EVENT_PUMP_2);}
+    if(_config->pump3_enable) {_schedule.Add(Schedule::SecondOfDay(_config->pump3_onTimeHour, _config->pump3_onTimeMinute, 0), EVENT_PUMP_3);}
+    if(_config->pump4_enable) {_schedule.Add(Schedule::SecondOfDay(_config->pump4_onTimeHour, _config->pump4_onTimeMinute, 0), EVENT_PUMP_4);}
+
+    _schedule.Build();
+}
+
+void Controller::CheckPumpOn(uint8_t event)
+{
+    switch (event)
+    {
+        case EVENT_PUMP_1:
+            _pumps[0]->Start();
+            VolumeBottle(&_config->pump1_volume_bottle, _config->pump1_volume);
+            break;
+        case EVENT_PUMP_2:
+            _pumps[1]->Start();
+            VolumeBottle(&_config->pump2_volume_bottle, _config->pump2_volume);
+            break;
+        case EVENT_PUMP_3:
+            _pumps[2]->Start();
+            VolumeBottle(&_config->pump3_volume_bottle, _config->pump3_volume);
+            break;
+        case EVENT_PUMP_4:
+            _pumps[3]->Start();
+            VolumeBottle(&_config->pump4_volume_bottle, _config->pump4_volume);
+            break;
+    }
+}
+
+void Controller::CheckLedOn(uint8_t event)
+{
+    switch (event)
+    {
+        case EVENT_COLOR_LED_ON:
+            if(_colorLedOn)
+            {
+                _colorLedOn = false;
+                GroupDo(LED_GROUP_COLOR, &Led::Start);
+            }
+            break;
+        case EVENT_COLOR_LED_OFF:
+            if(!_colorLedOn)
+            {
+                _colorLedOn = true;
+                GroupDo(LED_GROUP_COLOR, &Led::Stop);
+            }
+            break;
+        case EVENT_WHITE_LED_ON:
+            if(_whiteLedOn)
+            {
+                _whiteLedOn = false;
+                GroupDo(LED_GROUP_WHITE, &Led::Start);
+            }
+            break;
+        case EVENT_WHITE_LED_OFF:
+            if(!_whiteLedOn)
+            {
+                _whiteLedOn = true;
+                GroupDo(LED_GROUP_WHITE, &Led::Stop);
+            }
+            break;
+    }
+}
+
+void Controller::CheckLedRepeatOn()
+{
+    uint32_t secondOfDay = _timeRTC->GetSecondOfDay();
+
+    if(_colorProfile.IsActive())
+    {
+        ResumeProfile(LED_GROUP_COLOR, &_colorProfile, &_colorLedOn);
+    }
+    else
+    {
+        ResumeLed(LED_GROUP_COLOR, &_colorLedOn, Schedule::SecondOfDay(_config->colorLed_onTimeHour, _config->colorLed_onTimeMinute, 0),
+                  Schedule::SecondOfDay(_config->colorLed_offTimeHour, _config->colorLed_offTimeMinute, 0), _config->colorLed_rampDown, secondOfDay);
+    }
+
+    if(_whiteProfile.IsActive())
+    {
+        ResumeProfile(LED_GROUP_WHITE, &_whiteProfile, &_whiteLedOn);
+    }
+    else
+    {
+        ResumeLed(LED_GROUP_WHITE, &_whiteLedOn, Schedule::SecondOfDay(_config->whiteLed_onTimeHour, _config->whiteLed_onTimeMinute, 0),
+                  Schedule::SecondOfDay(_config->whiteLed_offTimeHour, _config->whiteLed_offTimeMinute, 0), _config->whiteLed_rampDown, secondOfDay);
+    }
+}
+
+// On a resync (boot, clock change, new config) the LEDs pick up the ramp the
+// schedule has them in: the ramp up from the on time, or the ramp down in the
+// rampDown minutes after the off time. Past that the schedule has them off,
+// a clock moved out of the window turns off what its on event started
+void Controller::ResumeLed(uint8_t group, bool *isLedOn, uint32_t onSecond, uint32_t offSecond, uint8_t rampDown, uint32_t secondOfDay)
+{
+    uint32_t sinceOn = (secondOfDay + SECONDS_PER_DAY - onSecond) % SECONDS_PER_DAY;
+    uint32_t sinceOff = (secondOfDay + SECONDS_PER_DAY - offSecond) % SECONDS_PER_DAY;
+    uint32_t onLength = (offSecond + SECONDS_PER_DAY - onSecond) % SECONDS_PER_DAY;
+
+    if(sinceOn < onLength)
+    {
+        if(*isLedOn)
+        {
+            *isLedOn = false;
+            for(uint8_t i = 0; i < _ledCount; i++)
+            {
+                if(_ledGroups[i] == group) {_leds[i]->Resume(true, sinceOn);}
+            }
+        }
+    }
+    else if(sinceOff < rampDown * 60UL)
+    {
+        *isLedOn = true;
+        for(uint8_t i = 0; i < _ledCount; i++)
+        {
+            if(_ledGroups[i] == group) {_leds[i]->Resume(false, sinceOff);}
+        }
+    }
+    else if(!*isLedOn)
+    {
+        *isLedOn = true;
+        GroupDo(group, &Led::Disable);
+    }
+}
+
+// A profile keeps the LEDs on around the clock and Tick() moves the level.
+// They fade in to where the curve is now; switched off by hand they stay off
+// until the next boot
+void Controller::ResumeProfile(uint8_t group, LightProfile *profile, bool *isLedOn)
+{
+    if(*isLedOn)
+    {
+        *isLedOn = false;
+        int level = profile->GetLevel(GetMillisOfDay());
+        for(uint8_t i = 0; i < _ledCount; i++)
+        {
+            if(_ledGroups[i] == group)
+            {
+                _leds[i]->SetLevel(level);
+                _leds[i]->Enable();
+            }
+        }
+    }
+}
+
+void Controller::GroupDo(uint8_t group, void (Led::*action)())
+{
+    for(uint8_t i = 0; i < _ledCount; i++)
+    {
+        if(_ledGroups[i] == group) {(_leds[i]->*action)();}
+    }
+}
+
+void Controller::CompileProfile(LightProfile *profile, const uint32_t *keyframes)
+{
+    profile->Clear();
+    for(uint8_t i = 0; i < CONFIG_LED_KEYFRAMES; i++)
+    {
+        profile->Add(keyframes[i]);
+    }
+
+    profile->Build();
+}
+
+// The RTC counts whole seconds, the HAL clock fills in the milliseconds
+uint32_t Controller::GetMillisOfDay()
+{
+    uint32_t millis = HalMillis() - _secondMillis;
+    return _timeRTC->GetSecondOfDay() * 1000UL + ((millis < 1000) ? millis : 999);
+}
+
+boolean Controller::IsBottleWarning()
+{
+    return _isBottleWarning;
+}
+
+void Controller::VolumeBottle(int32_t *volumeBottle, int32_t volume)
+{
+    *volumeBottle = *volumeBottle - volume; 
+    Config_MarkDirty(volumeBottle);
+
+    if(*volumeBottle < BOTTLE_VOLUME_LOW)
+    {
+        BUZZER.Long();
+        BUZZER.Double();
+        BUZZER.Long();
+        _isBottleWarning = true;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <Hal.h>
+#include <Config.h>
+#include <TimeRTC.h>
+#include <Schedule.h>
+#include <Pump.h>
+#include <Led.h>
+#include <LightProfile.h>
+#include <Weather.h>
+
+// The control loop: applies the config to the LEDs and pumps, runs the daily
+// schedule against the RTC and keeps track of the dosing bottles. It holds no
+// board state of its own, so the same code runs on target and on the host.
+//
+// LEDs run in two groups, one per schedule in the config. The board channels
+// start them, AttachLed() adds expansion channels that ramp, fade and switch
+// with their group.
+
+#define CONTROLLER_PUMP_COUNT   4
+#define CONTROLLER_LED_COUNT    (2 + PCA9685_BOARDS * PCA9685_CHANNELS)
+
+// Thousandths of a ml, like the volumes in the config
+#define BOTTLE_VOLUME_FULL      450000
+#define BOTTLE_VOLUME_LOW       50000
+
+enum scheduleEventType
+{
+    EVENT_WHITE_LED_ON,
+    EVENT_WHITE_LED_OFF,
+    EVENT_COLOR_LED_ON,
+    EVENT_COLOR_LED_OFF,
+    EVENT_PUMP_1,
+    EVENT_PUMP_2,
+    EVENT_PUMP_3,
+    EVENT_PUMP_4
+};
+
+// Also the index of the LED commands
+enum ledGroup
+{
+    LED_GROUP_WHITE,
+    LED_GROUP_COLOR
+};
+
+enum controlCommandType
+{
+    CONTROL_APPLY_CONFIG,
+    CONTROL_LED_MANUAL,
+    CONTROL_LED_DUTY,
+    CONTROL_PUMP_DOSE,
+    CONTROL_PUMP_START,
+    CONTROL_PUMP_ENABLE,
+    CONTROL_PUMP_DISABLE,
+    CONTROL_PUMP_CALIBRATE,
+    CONTROL_BOTTLE_RESET
+};
+
+struct ControlCommand
+{
+    uint8_t type;
+    uint8_t index;
+    uint8_t duty;
+    int32_t value;
+};
+
+class Controller
+{
+private:
+    Configuration *_config;
+    TimeRTC *_timeRTC;
+    Pump **_pumps;
+    Led *_leds[CONTROLLER_LED_COUNT];
+    uint8_t _ledGroups[CONTROLLER_LED_COUNT];
+    uint8_t _ledCount = 0;
+    Schedule _schedule;
+    LightProfile _whiteProfile;
+    LightProfile _colorProfile;
+    Weather _weather;
+    uint32_t _secondMillis = 0;
+    bool _whiteLedOn = true;
+    bool _colorLedOn = true;
+    bool _isBottleWarning = false;
+    void CompileSchedule();
+    void CompileProfile(LightProfile *profile, const uint32_t *keyframes);
+    uint32_t GetMillisOfDay();
+    void VolumeBottle(int32_t *volumeBottle, int32_t volume);
+    void ResumeLed(uint8_t group, bool *isLedOn, uint32_t onSecond, uint32_t offSecond, uint8_t rampDown, uint32_t secondOfDay);
+    void ResumeProfile(uint8_t group, LightProfile *profile, bool *isLedOn);
+    void GroupDo(uint8_t group, void (Led::*action)());
+
+public:
+    Controller(Configuration *config, TimeRTC *timeRTC, Pump **pumps, Led *whiteLed, Led *colorLed);
+    boolean AttachLed(Led *led, uint8_t group);
+    void ApplyConfig();
+    void Tick();
+    void DoCommand(const ControlCommand &command);
+    void CheckPumpOn(uint8_t event);
+    void CheckLedOn(uint8_t event);
+    void CheckLedRepeatOn();
+    boolean IsBottleWarning();
+};
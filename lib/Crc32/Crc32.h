@@ -0,0 +1,6 @@
+#pragma once
+#include <Hal.h>
+
+// CRC-32 (IEEE 802.3, reflected, same as zlib). Pass the previous result
+// as crc to continue over several buffers.
+uint32_t Crc32(const uint8_t *data, size_t length, uint32_t crc = 0);
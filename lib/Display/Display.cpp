@@ -0,0 +1,130 @@
+#include "Display.h"
+
+void Display::begin(uint8_t cols, uint8_t rows)
+{
+    HalDisplayBegin(cols, rows);
+    HalDisplayClear();
+    memset(_frame, ' ', sizeof(_frame));
+    memset(_shown, ' ', sizeof(_shown));
+    _lcdCol = 0;
+    _lcdRow = 0;
+    _isLcdBacklight = true;
+    _busBytes += DISPLAY_I2C_BYTES_PER_WRITE;
+}
+
+void Display::clear()
+{
+    memset(_frame, ' ', sizeof(_frame));
+    _dirtyRows = (1 << DISPLAY_ROWS) - 1;
+    _col = 0;
+    _row = 0;
+}
+
+void Display::backlight()
+{
+    _isBacklight = true;
+}
+
+void Display::noBacklight()
+{
+    _isBacklight = false;
+}
+
+void Display::setCursor(uint8_t col, uint8_t row)
+{
+    _col = col;
+    _row = (row < DISPLAY_ROWS) ? row : DISPLAY_ROWS - 1;
+}
+
+void Display::print(const char *text)
+{
+    char *cell = _frame[_row];
+
+    for(; *text != '\0' && _col < DISPLAY_COLS; text++, _col++)
+    {
+        if(cell[_col] != *text)
+        {
+            cell[_col] = *text;
+            _dirtyRows |= (1 << _row);
+        }
+    }
+}
+
+void Display::print(const __FlashStringHelper *text)
+{
+    print(reinterpret_cast<const char *>(text));
+}
+
+void Display::createChar(uint8_t location, const uint8_t *bitmap)
+{
+    // Leaves the LCD addressing the character RAM, the next run moves the cursor back
+    HalDisplayCreateChar(location, bitmap);
+    _busBytes += 9 * DISPLAY_I2C_BYTES_PER_WRITE;
+    _lcdRow = 0xFF;
+}
+
+void Display::Flush()
+{
+    if(_isBacklight != _isLcdBacklight)
+    {
+        HalDisplayBacklight(_isBacklight);
+        _isLcdBacklight = _isBacklight;
+        _busBytes += DISPLAY_I2C_BYTES_PER_BACKLIGHT;
+    }
+
+    for(uint8_t row = 0; row < DISPLAY_ROWS && _dirtyRows != 0; row++)
+    {
+        if(!(_dirtyRows & (1 << row)))
+            continue;
+
+        _dirtyRows &= ~(1 << row);
+        uint8_t col = 0;
+        while(col < DISPLAY_COLS)
+        {
+            if(_frame[row][col] == _shown[row][col])
+            {
+                col++;
+                continue;
+            }
+
+            // Rewriting one unchanged character costs the same as a cursor move, so such gaps join the run
+            uint8_t end = col + 1;
+            for(uint8_t next = end; next < DISPLAY_COLS && next <= end + 1; next++)
+            {
+                if(_frame[row][next] != _shown[row][next])
+                {
+                    end = next + 1;
+                }
+            }
+
+            WriteRun(row, col, end);
+            col = end;
+        }
+    }
+}
+
+void Display::WriteRun(uint8_t row, uint8_t start, uint8_t end)
+{
+    char run[DISPLAY_COLS + 1];
+    uint8_t length = end - start;
+
+    if(_lcdRow != row || _lcdCol != start)
+    {
+        HalDisplaySetCursor(start, row);
+        _busBytes += DISPLAY_I2C_BYTES_PER_WRITE;
+    }
+
+    memcpy(run, &_frame[row][start], length);
+    run[length] = '\0';
+    HalDisplayWrite(run);
+    memcpy(&_shown[row][start], run, length);
+
+    _busBytes += length * DISPLAY_I2C_BYTES_PER_WRITE;
+    _lcdRow = row;
+    _lcdCol = end;
+}
+
+uint32_t Display::GetBusBytes()
+{
+    return _busBytes;
+}
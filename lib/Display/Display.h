@@ -0,0 +1,45 @@
+#pragma once
+#include <Hal.h>
+
+// Character LCD on top of the HAL display. Mirrors the LiquidCrystal calls
+// the menus use, so the same pages drive the hd44780 or the host simulation.
+//
+// The calls only change a shadow of the 20x4 screen in RAM. Flush() sends
+// the characters that differ from what the LCD shows, as runs with one
+// cursor move each. Text past the last column is dropped instead of
+// wrapping onto another row like the controller would. The backlight is
+// applied on the next flush as well, so only Flush() touches the bus.
+
+#define DISPLAY_COLS 20
+#define DISPLAY_ROWS 4
+// Each LCD byte is both nibbles with an E pulse each on the expander, the address per chunk is left out
+#define DISPLAY_I2C_BYTES_PER_WRITE 4
+#define DISPLAY_I2C_BYTES_PER_BACKLIGHT 1
+
+class Display
+{
+private:
+    char _frame[DISPLAY_ROWS][DISPLAY_COLS];
+    char _shown[DISPLAY_ROWS][DISPLAY_COLS];
+    uint8_t _col = 0;
+    uint8_t _row = 0;
+    uint8_t _lcdCol = 0xFF;
+    uint8_t _lcdRow = 0xFF;
+    uint8_t _dirtyRows = 0;
+    bool _isBacklight = false;
+    bool _isLcdBacklight = false;
+    uint32_t _busBytes = 0;
+    void WriteRun(uint8_t row, uint8_t start, uint8_t end);
+
+public:
+    void begin(uint8_t cols, uint8_t rows);
+    void clear();
+    void backlight();
+    void noBacklight();
+    void setCursor(uint8_t col, uint8_t row);
+    void print(const char *text);
+    void print(const __FlashStringHelper *text);
+    void createChar(uint8_t location, const uint8_t *bitmap);
+    void Flush();
+    uint32_t GetBusBytes();
+};
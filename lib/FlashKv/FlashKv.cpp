@@ -0,0 +1,266 @@
+#include "FlashKv.h"
+#include <Crc32.h>
+
+#if !defined(STM32F1xx)
+// Host builds keep the pages in RAM
+static uint8_t flashKvMemory[FLASH_KV_PAGE_COUNT * FLASH_KV_PAGE_SIZE];
+#endif
+
+boolean FlashKv::Begin()
+{
+    bool isFound = false;
+
+    // The newest completely written page is the active one. A newer page that
+    // was torn by a power cut during Rotate() is still in the receiving state
+    // and gets erased again by the next rotation.
+    for(uint8_t page = 0; page < FLASH_KV_PAGE_COUNT; page++)
+    {
+        const FlashKvHeader *header = GetHeader(page);
+        if(header->magic != FLASH_KV_MAGIC || header->state != FLASH_KV_PAGE_ACTIVE)
+        {
+            continue;
+        }
+
+        if(!isFound || header->sequence > _sequence)
+        {
+            isFound = true;
+            _page = page;
+            _sequence = header->sequence;
+        }
+    }
+
+    if(!isFound)
+    {
+        return Format();
+    }
+
+    _position = FLASH_KV_RECORD_COUNT;
+    while(_position > 0 && IsBlank(GetRecord(_page, _position - 1)))
+    {
+        _position--;
+    }
+
+    _isReady = true;
+    return true;
+}
+
+boolean FlashKv::Read(uint16_t key, uint32_t *value)
+{
+    if(!_isReady)
+    {
+        return false;
+    }
+
+    return FindLatest(_page, _position, key, value);
+}
+
+boolean FlashKv::Write(uint16_t key, uint32_t value)
+{
+    uint32_t current;
+
+    if(!_isReady || key == FLASH_KV_EMPTY)
+    {
+        return false;
+    }
+
+    if(FindLatest(_page, _position, key, &current) && current == value)
+    {
+        return true;
+    }
+
+    if(_position >= FLASH_KV_RECORD_COUNT && !Rotate())
+    {
+        return false;
+    }
+
+    return ProgramRecord(GetAddress(_page, _position++), key, value);
+}
+
+boolean FlashKv::Format()
+{
+    _isReady = false;
+
+    for(uint8_t page = 0; page < FLASH_KV_PAGE_COUNT; page++)
+    {
+        if(!ErasePage(page))
+        {
+            return false;
+        }
+    }
+
+    if(!OpenPage(0, 1) || !ProgramHalfWord(GetAddress(0, 0) - sizeof(FlashKvHeader) + 2, FLASH_KV_PAGE_ACTIVE))
+    {
+        return false;
+    }
+
+    _page = 0;
+    _sequence = 1;
+    _position = 0;
+    _isReady = true;
+    return true;
+}
+
+boolean FlashKv::IsEmpty()
+{
+    return _position == 0;
+}
+
+uint32_t FlashKv::GetSequence()
+{
+    return _sequence;
+}
+
+uint16_t FlashKv::GetFreeRecords()
+{
+    return FLASH_KV_RECORD_COUNT - _position;
+}
+
+const FlashKvHeader *FlashKv::GetHeader(uint8_t page)
+{
+    return (const FlashKvHeader *)(GetAddress(page, 0) - sizeof(FlashKvHeader));
+}
+
+const FlashKvRecord *FlashKv::GetRecord(uint8_t page, uint16_t index)
+{
+    return (const FlashKvRecord *)GetAddress(page, index);
+}
+
+uintptr_t FlashKv::GetAddress(uint8_t page, uint16_t index)
+{
+#if defined(STM32F1xx)
+    uintptr_t base = FLASH_KV_BASE;
+#else
+    uintptr_t base = (uintptr_t)flashKvMemory;
+#endif
+
+    return base + page * FLASH_KV_PAGE_SIZE + sizeof(FlashKvHeader) + index * FLASH_KV_RECORD_SIZE;
+}
+
+boolean FlashKv::IsValid(const FlashKvRecord *record)
+{
+    return record->key != FLASH_KV_EMPTY && record->check == GetCheck(record->key, record->value);
+}
+
+boolean FlashKv::IsBlank(const FlashKvRecord *record)
+{
+    return record->key == FLASH_KV_EMPTY && record->check == FLASH_KV_EMPTY && record->value == 0xFFFFFFFF;
+}
+
+boolean FlashKv::FindLatest(uint8_t page, uint16_t position, uint16_t key, uint32_t *value)
+{
+    while(position > 0)
+    {
+        const FlashKvRecord *record = GetRecord(page, --position);
+        if(record->key == key && IsValid(record))
+        {
+            *value = record->value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+boolean FlashKv::OpenPage(uint8_t page, uint32_t sequence)
+{
+    uintptr_t address = GetAddress(page, 0) - sizeof(FlashKvHeader);
+
+    // State is left erased until the page is complete
+    return ProgramHalfWord(address, FLASH_KV_MAGIC)
+        && ProgramHalfWord(address + 4, sequence & 0xFFFF)
+        && ProgramHalfWord(address + 6, sequence >> 16);
+}
+
+boolean FlashKv::Rotate()
+{
+    uint8_t next = (_page + 1) % FLASH_KV_PAGE_COUNT;
+    uint16_t copied = 0;
+
+    if(!ErasePage(next) || !OpenPage(next, _sequence + 1))
+    {
+        return false;
+    }
+
+    // Copy the latest value of every key, older duplicates are dropped
+    for(uint16_t i = 0; i < _position; i++)
+    {
+        const FlashKvRecord *record = GetRecord(_page, i);
+        uint32_t value;
+
+        if(!IsValid(record) || FindLatest(next, copied, record->key, &value))
+        {
+            continue;
+        }
+
+        FindLatest(_page, _position, record->key, &value);
+        if(copied >= FLASH_KV_RECORD_COUNT || !ProgramRecord(GetAddress(next, copied), record->key, value))
+        {
+            return false;
+        }
+
+        copied++;
+    }
+
+    if(!ProgramHalfWord(GetAddress(next, 0) - sizeof(FlashKvHeader) + 2, FLASH_KV_PAGE_ACTIVE))
+    {
+        return false;
+    }
+
+    _page = next;
+    _sequence++;
+    _position = copied;
+    return _position < FLASH_KV_RECORD_COUNT;
+}
+
+boolean FlashKv::ErasePage(uint8_t page)
+{
+    uintptr_t address = GetAddress(page, 0) - sizeof(FlashKvHeader);
+
+#if defined(STM32F1xx)
+    FLASH_EraseInitTypeDef erase = {};
+    uint32_t pageError = 0;
+
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.PageAddress = address;
+    erase.NbPages = 1;
+
+    HAL_FLASH_Unlock();
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &pageError);
+    HAL_FLASH_Lock();
+
+    return status == HAL_OK;
+#else
+    memset((void *)(uintptr_t)address, 0xFF, FLASH_KV_PAGE_SIZE);
+    return true;
+#endif
+}
+
+boolean FlashKv::ProgramRecord(uintptr_t address, uint16_t key, uint32_t value)
+{
+    // Key goes last, a record torn by a power cut fails its check
+    return ProgramHalfWord(address + 4, value & 0xFFFF)
+        && ProgramHalfWord(address + 6, value >> 16)
+        && ProgramHalfWord(address + 2, GetCheck(key, value))
+        && ProgramHalfWord(address, key);
+}
+
+boolean FlashKv::ProgramHalfWord(uintptr_t address, uint16_t value)
+{
+#if defined(STM32F1xx)
+    HAL_FLASH_Unlock();
+    HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address, value);
+    HAL_FLASH_Lock();
+
+    return status == HAL_OK && *(volatile uint16_t *)address == value;
+#else
+    volatile uint16_t *cell = (volatile uint16_t *)(uintptr_t)address;
+    *cell &= value;
+    return *cell == value;
+#endif
+}
+
+uint16_t FlashKv::GetCheck(uint16_t key, uint32_t value)
+{
+    uint8_t data[6] = {(uint8_t)key, (uint8_t)(key >> 8), (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    return Crc32(data, sizeof(data)) & 0xFFFF;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <Hal.h>
+
+// Append only key/value log in the last pages of internal flash. Every page
+// starts with a header, followed by 8 byte records. When the active page is
+// full the next page is erased and the live records are copied over, so the
+// pages wear evenly and the active page always holds the whole state.
+
+#define FLASH_KV_PAGE_SIZE      1024
+#define FLASH_KV_PAGE_COUNT     4
+#define FLASH_KV_FLASH_SIZE     (128UL * 1024)
+#define FLASH_KV_BASE           (0x08000000UL + FLASH_KV_FLASH_SIZE - FLASH_KV_PAGE_COUNT * FLASH_KV_PAGE_SIZE)
+#define FLASH_KV_RECORD_SIZE    8
+#define FLASH_KV_RECORD_COUNT   (FLASH_KV_PAGE_SIZE / FLASH_KV_RECORD_SIZE - 1)
+#define FLASH_KV_MAGIC          0x4B56
+#define FLASH_KV_PAGE_ACTIVE    0x0000
+#define FLASH_KV_EMPTY          0xFFFF
+
+struct FlashKvHeader
+{
+    uint16_t magic;
+    uint16_t state;
+    uint32_t sequence;
+};
+
+struct FlashKvRecord
+{
+    uint16_t key;
+    uint16_t check;
+    uint32_t value;
+};
+
+class FlashKv
+{
+private:
+    uint8_t _page = 0;
+    uint16_t _position = 0;
+    uint32_t _sequence = 0;
+    bool _isReady = false;
+    const FlashKvHeader *GetHeader(uint8_t page);
+    const FlashKvRecord *GetRecord(uint8_t page, uint16_t index);
+    uintptr_t GetAddress(uint8_t page, uint16_t index);
+    boolean IsValid(const FlashKvRecord *record);
+    boolean IsBlank(const FlashKvRecord *record);
+    boolean FindLatest(uint8_t page, uint16_t position, uint16_t key, uint32_t *value);
+    boolean OpenPage(uint8_t page, uint32_t sequence);
+    boolean Rotate();
+    boolean ErasePage(uint8_t page);
+    boolean ProgramRecord(uintptr_t address, uint16_t key, uint32_t value);
+    boolean ProgramHalfWord(uintptr_t address, uint16_t value);
+    static uint16_t GetCheck(uint16_t key, uint32_t value);
+
+public:
+    boolean Begin();
+    boolean Read(uint16_t key, uint32_t *value);
+    boolean Write(uint16_t key, uint32_t value);
+    boolean Format();
+    boolean IsEmpty();
+    uint32_t GetSequence();
+    uint16_t GetFreeRecords();
+};
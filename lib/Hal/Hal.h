@@ -0,0 +1,153 @@
+#pragma once
+
+// Thin hardware layer between the libs and the board. HalArduino.cpp maps it
+// onto the STM32duino core and the attached peripherals, HalNative.cpp
+// simulates the same peripherals for the host build ([env:native]).
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+class __FlashStringHelper;
+#define F(text) (reinterpret_cast<const __FlashStringHelper *>(text))
+
+#define INPUT           0x0
+#define OUTPUT          0x1
+#define INPUT_PULLUP    0x2
+#define CHANGE          2
+#define FALLING         3
+#define RISING          4
+
+enum
+{
+    PA0, PA1, PA2, PA3, PA4, PA5, PA6, PA7, PA8, PA9, PA10, PA11, PA12, PA13, PA14, PA15,
+    PB0, PB1, PB2, PB3, PB4, PB5, PB6, PB7, PB8, PB9, PB10, PB11, PB12, PB13, PB14, PB15,
+    HAL_PIN_COUNT
+};
+#endif
+
+#define HAL_RTC_ADDRESS 0x68
+
+// BOARD, buses up and 12 bit PWM
+void HalBegin();
+
+// CLOCK
+uint32_t HalMillis();
+uint32_t HalMicros();
+void HalDelay(uint32_t ms);
+
+// CYCLES, free running counter for profiling. DWT CYCCNT on target, host
+// nanoseconds on the host; the difference of two reads is valid across a wrap
+uint32_t HalCycles();
+uint32_t HalCyclesPerSecond();
+
+// GPIO
+void HalPinMode(uint32_t pin, uint32_t mode);
+void HalPwmWrite(uint32_t pin, uint32_t value);
+void HalAttachInterrupt(uint32_t pin, void (*callback)(), uint32_t mode);
+void HalInterruptsOff();
+void HalInterruptsOn();
+
+// PWM, 12 bit. HalPwmAttach() looks the timer channel of a pin up once, then
+// HalPwmSet() is a single compare register store on STM32F1. Pins without a
+// channel, other cores and the host go through HalPwmWrite()
+#define HAL_PWM_MAX 4095
+
+struct HalPwm
+{
+    uint32_t pin;
+    volatile uint32_t *compare;
+};
+
+HalPwm HalPwmAttach(uint32_t pin);
+#if defined(STM32F1xx)
+inline void HalPwmSet(const HalPwm &pwm, uint32_t value)
+{
+    if(pwm.compare != nullptr)
+    {
+        *pwm.compare = value;
+        return;
+    }
+
+    HalPwmWrite(pwm.pin, value);
+}
+#else
+void HalPwmSet(const HalPwm &pwm, uint32_t value);
+#endif
+
+// TONE
+void HalTone(uint32_t pin, uint32_t frequency);
+void HalNoTone(uint32_t pin);
+
+// RTC, raw DS3231 register access
+boolean HalRtcRead(uint8_t reg, uint8_t *data, uint8_t length);
+boolean HalRtcWrite(uint8_t reg, const uint8_t *data, uint8_t length);
+
+// PWM EXPANDER, register writes to PCA9685 boards. Write waits for the ACK,
+// Post returns once the bytes are queued and does not report a NACK. Up to
+// HAL_EXPANDER_POST_MAX bytes after the register
+#define HAL_EXPANDER_ADDRESS    0x40
+#define HAL_EXPANDER_POST_MAX   64
+boolean HalExpanderWrite(uint8_t address, uint8_t reg, const uint8_t *data, uint8_t length);
+boolean HalExpanderPost(uint8_t address, uint8_t reg, const uint8_t *data, uint8_t length);
+
+// DISPLAY, HD44780 character LCD. On STM32F1 the calls queue the bytes and
+// return, the RTC calls are interleaved with them on the bus. Not reentrant,
+// callers of the display and RTC share one lock
+void HalDisplayBegin(uint8_t cols, uint8_t rows);
+void HalDisplayClear();
+void HalDisplayBacklight(boolean isOn);
+void HalDisplaySetCursor(uint8_t col, uint8_t row);
+void HalDisplayWrite(const char *text);
+void HalDisplayCreateChar(uint8_t location, const uint8_t *bitmap);
+
+// SERIAL, debug output on USART3 (PB10 TX), PA9/PA10 carry the LEDs
+void HalSerialBegin(uint32_t baud);
+void HalSerialWrite(const char *text);
+
+// FILE, whole file access on the SD card. Writing replaces the file
+boolean HalFileBegin(uint32_t csPin);
+boolean HalFileRead(const char *name, uint8_t *buffer, size_t size, size_t *length);
+boolean HalFileWrite(const char *name, const uint8_t *buffer, size_t length);
+boolean HalFileAppend(const char *name, const uint8_t *buffer, size_t length);
+
+// FILE, streaming read of one file at a time
+boolean HalFileOpen(const char *name);
+size_t HalFileReadBytes(uint8_t *buffer, size_t length);
+void HalFileClose();
+
+// Reader over the file opened with HalFileOpen(), in the shape ArduinoJson expects
+struct HalFileStream
+{
+    int read()
+    {
+        uint8_t c;
+        return (HalFileReadBytes(&c, 1) == 1) ? c : -1;
+    }
+
+    size_t readBytes(char *buffer, size_t length)
+    {
+        return HalFileReadBytes((uint8_t *)buffer, length);
+    }
+};
+
+#if !defined(ARDUINO)
+// SIMULATION, host only. Expander channels show up as pins from
+// HAL_SIM_EXPANDER_PIN on, 16 per board in address order
+#define HAL_SIM_EXPANDER_PIN 64
+void HalSimAdvance(uint32_t ms);
+void HalSimSetRtc(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
+uint32_t HalSimGetPwm(uint32_t pin);
+void HalSimSetPwmHook(void (*hook)(uint32_t pin, uint32_t value));
+uint32_t HalSimGetTone(uint32_t pin);
+boolean HalSimIsBacklight();
+const char *HalSimGetDisplayRow(uint8_t row);
+uint32_t HalSimGetDisplayBytes();
+uint32_t HalSimGetExpanderWrites();
+#endif
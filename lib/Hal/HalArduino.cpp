@@ -0,0 +1,449 @@
+#if defined(ARDUINO)
+#include "Hal.h"
+#include <Wire.h>
+#include <SPI.h>
+#include <SD.h>
+#include <hd44780.h>
+#include <hd44780ioClass/hd44780_I2Cexp.h>
+#include <I2cBus.h>
+#include <PwmChannel.h>
+
+static File readFile;
+static HardwareSerial serial(PB11, PB10);
+
+#if defined(STM32F1xx)
+// The LCD goes through the interrupt driven bus: display calls queue the
+// expander bytes and return, RTC transfers are slotted in between chunks.
+// PCF8574 backpack wiring: P0 RS, P1 RW, P2 E, P3 backlight, P4..P7 D4..D7
+#define LCD_I2C_ADDRESS   0x27
+#define LCD_RS            0x01
+#define LCD_E             0x04
+#define LCD_BACKLIGHT     0x08
+
+static I2cBus bus;
+static uint8_t lcdBacklight = LCD_BACKLIGHT;
+static const uint8_t lcdRowOffsets[] = {0x00, 0x40, 0x14, 0x54};
+
+// One LCD byte as four expander writes, each nibble latched on the falling edge of E
+static uint8_t *LcdEncode(uint8_t *bytes, uint8_t value, uint8_t rs)
+{
+    uint8_t high = (value & 0xF0) | lcdBacklight | rs;
+    uint8_t low = ((value << 4) & 0xF0) | lcdBacklight | rs;
+
+    *bytes++ = high | LCD_E;
+    *bytes++ = high;
+    *bytes++ = low | LCD_E;
+    *bytes++ = low;
+    return bytes;
+}
+
+static void LcdCommand(uint8_t command)
+{
+    uint8_t bytes[4];
+    LcdEncode(bytes, command, 0);
+    bus.Queue(bytes, sizeof(bytes));
+}
+
+static void LcdNibble(uint8_t nibble)
+{
+    uint8_t bytes[2] = {(uint8_t)((nibble << 4) | lcdBacklight | LCD_E), (uint8_t)((nibble << 4) | lcdBacklight)};
+    bus.Queue(bytes, sizeof(bytes));
+    bus.WaitIdle();
+}
+#else
+static hd44780_I2Cexp lcd;
+#endif
+
+void HalBegin()
+{
+#if defined(STM32F1xx)
+    bus.Begin(LCD_I2C_ADDRESS);
+#else
+    Wire.begin();
+#endif
+    SPI.begin();
+    analogWriteResolution(12);
+
+#if defined(DWT)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+uint32_t HalMillis()
+{
+    return millis();
+}
+
+uint32_t HalMicros()
+{
+    return micros();
+}
+
+void HalDelay(uint32_t ms)
+{
+    delay(ms);
+}
+
+// Cortex-M0 parts have no cycle counter, they count microseconds instead
+uint32_t HalCycles()
+{
+#if defined(DWT)
+    return DWT->CYCCNT;
+#else
+    return micros();
+#endif
+}
+
+uint32_t HalCyclesPerSecond()
+{
+#if defined(DWT)
+    return SystemCoreClock;
+#else
+    return 1000000UL;
+#endif
+}
+
+void HalPinMode(uint32_t pin, uint32_t mode)
+{
+    pinMode(pin, mode);
+}
+
+void HalPwmWrite(uint32_t pin, uint32_t value)
+{
+#if defined(STM32F1xx)
+    // analogWrite() would set the timer up again under the attached channels
+    switch(pin)
+    {
+        case PA0: PwmPA0::Write(value); return;
+        case PA1: PwmPA1::Write(value); return;
+        case PA2: PwmPA2::Write(value); return;
+        case PA3: PwmPA3::Write(value); return;
+        case PA9: PwmPA9::Write(value); return;
+        case PA10: PwmPA10::Write(value); return;
+    }
+#endif
+    analogWrite(pin, value);
+}
+
+#if defined(STM32F1xx)
+// Timer channel up, then the GPIOA pin to alternate function push-pull, 50 MHz
+template <typename Channel>
+static HalPwm PwmAttach(uint32_t pin, uint8_t portPin)
+{
+    volatile uint32_t *config = (portPin < 8) ? &GPIOA->CRL : &GPIOA->CRH;
+    uint8_t shift = (portPin % 8) * 4;
+
+    Channel::Begin();
+    RCC->APB2ENR |= RCC_APB2ENR_IOPAEN;
+    *config = (*config & ~(0x0FUL << shift)) | (0x0BUL << shift);
+    return {pin, Channel::Compare()};
+}
+#endif
+
+HalPwm HalPwmAttach(uint32_t pin)
+{
+#if defined(STM32F1xx)
+    switch(pin)
+    {
+        case PA0: return PwmAttach<PwmPA0>(pin, 0);
+        case PA1: return PwmAttach<PwmPA1>(pin, 1);
+        case PA2: return PwmAttach<PwmPA2>(pin, 2);
+        case PA3: return PwmAttach<PwmPA3>(pin, 3);
+        case PA9: return PwmAttach<PwmPA9>(pin, 9);
+        case PA10: return PwmAttach<PwmPA10>(pin, 10);
+    }
+#endif
+    return {pin, nullptr};
+}
+
+#if !defined(STM32F1xx)
+void HalPwmSet(const HalPwm &pwm, uint32_t value)
+{
+    analogWrite(pwm.pin, value);
+}
+#endif
+
+void HalAttachInterrupt(uint32_t pin, void (*callback)(), uint32_t mode)
+{
+    attachInterrupt(digitalPinToInterrupt(pin), callback, mode);
+}
+
+void HalInterruptsOff()
+{
+    noInterrupts();
+}
+
+void HalInterruptsOn()
+{
+    interrupts();
+}
+
+void HalTone(uint32_t pin, uint32_t frequency)
+{
+    tone(pin, frequency);
+}
+
+void HalNoTone(uint32_t pin)
+{
+    noTone(pin);
+}
+
+boolean HalRtcRead(uint8_t reg, uint8_t *data, uint8_t length)
+{
+#if defined(STM32F1xx)
+    return bus.Transfer(HAL_RTC_ADDRESS, &reg, 1, data, length);
+#else
+    Wire.beginTransmission(HAL_RTC_ADDRESS);
+    Wire.write(reg);
+    if(Wire.endTransmission() != 0)
+    {
+        return false;
+    }
+
+    if(Wire.requestFrom((uint8_t)HAL_RTC_ADDRESS, length) != length)
+    {
+        return false;
+    }
+
+    for(uint8_t i = 0; i < length; i++)
+    {
+        data[i] = Wire.read();
+    }
+
+    return true;
+#endif
+}
+
+boolean HalRtcWrite(uint8_t reg, const uint8_t *data, uint8_t length)
+{
+#if defined(STM32F1xx)
+    // Register pointer and data go out in one transaction
+    uint8_t tx[1 + 0x13];
+    if(length >= sizeof(tx))
+    {
+        return false;
+    }
+
+    tx[0] = reg;
+    memcpy(&tx[1], data, length);
+    return bus.Transfer(HAL_RTC_ADDRESS, tx, length + 1, nullptr, 0);
+#else
+    Wire.beginTransmission(HAL_RTC_ADDRESS);
+    Wire.write(reg);
+    Wire.write(data, length);
+    return Wire.endTransmission() == 0;
+#endif
+}
+
+boolean HalExpanderWrite(uint8_t address, uint8_t reg, const uint8_t *data, uint8_t length)
+{
+#if defined(STM32F1xx)
+    uint8_t tx[1 + HAL_EXPANDER_POST_MAX];
+    if(length >= sizeof(tx))
+    {
+        return false;
+    }
+
+    tx[0] = reg;
+    memcpy(&tx[1], data, length);
+    return bus.Transfer(address, tx, length + 1, nullptr, 0);
+#else
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    Wire.write(data, length);
+    return Wire.endTransmission() == 0;
+#endif
+}
+
+// The Wire fallback has no background transfers and blocks like a write
+boolean HalExpanderPost(uint8_t address, uint8_t reg, const uint8_t *data, uint8_t length)
+{
+#if defined(STM32F1xx)
+    return bus.Post(address, reg, data, length);
+#else
+    return HalExpanderWrite(address, reg, data, length);
+#endif
+}
+
+#if defined(STM32F1xx)
+void HalDisplayBegin(uint8_t cols, uint8_t rows)
+{
+    // Reset by instruction, the LCD may be in 8 or 4 bit mode after power up
+    HalDelay(50);
+    LcdNibble(0x3);
+    HalDelay(5);
+    LcdNibble(0x3);
+    HalDelay(1);
+    LcdNibble(0x3);
+    HalDelay(1);
+    LcdNibble(0x2);
+
+    LcdCommand((rows > 1) ? 0x28 : 0x20);
+    LcdCommand(0x0C);
+    LcdCommand(0x06);
+    HalDisplayClear();
+}
+
+void HalDisplayClear()
+{
+    // Clear takes 1.52 ms in the controller, nothing may follow it sooner
+    LcdCommand(0x01);
+    bus.WaitIdle();
+    HalDelay(2);
+}
+
+void HalDisplayBacklight(boolean isOn)
+{
+    lcdBacklight = isOn ? LCD_BACKLIGHT : 0;
+    bus.Queue(&lcdBacklight, 1);
+}
+
+void HalDisplaySetCursor(uint8_t col, uint8_t row)
+{
+    LcdCommand(0x80 | (col + lcdRowOffsets[row & 0x03]));
+}
+
+void HalDisplayWrite(const char *text)
+{
+    uint8_t bytes[20 * 4];
+
+    while(*text != '\0')
+    {
+        uint8_t *end = bytes;
+        for(uint8_t i = 0; i < 20 && *text != '\0'; i++)
+        {
+            end = LcdEncode(end, *text++, LCD_RS);
+        }
+
+        bus.Queue(bytes, end - bytes);
+    }
+}
+
+void HalDisplayCreateChar(uint8_t location, const uint8_t *bitmap)
+{
+    uint8_t bytes[8 * 4];
+    uint8_t *end = bytes;
+
+    LcdCommand(0x40 | ((location & 0x07) << 3));
+    for(uint8_t i = 0; i < 8; i++)
+    {
+        end = LcdEncode(end, bitmap[i], LCD_RS);
+    }
+
+    bus.Queue(bytes, end - bytes);
+}
+#else
+void HalDisplayBegin(uint8_t cols, uint8_t rows)
+{
+    lcd.begin(cols, rows);
+}
+
+void HalDisplayClear()
+{
+    lcd.clear();
+}
+
+void HalDisplayBacklight(boolean isOn)
+{
+    if(isOn)
+    {
+        lcd.backlight();
+    }
+    else
+    {
+        lcd.noBacklight();
+    }
+}
+
+void HalDisplaySetCursor(uint8_t col, uint8_t row)
+{
+    lcd.setCursor(col, row);
+}
+
+void HalDisplayWrite(const char *text)
+{
+    lcd.print(text);
+}
+
+void HalDisplayCreateChar(uint8_t location, const uint8_t *bitmap)
+{
+    lcd.createChar(location, (uint8_t *)bitmap);
+}
+#endif
+
+boolean HalFileBegin(uint32_t csPin)
+{
+    return SD.begin(csPin);
+}
+
+boolean HalFileRead(const char *name, uint8_t *buffer, size_t size, size_t *length)
+{
+    File file = SD.open(name);
+    if(!file)
+    {
+        return false;
+    }
+
+    *length = file.size();
+    bool isRead = (*length <= size && file.read(buffer, *length) == (int)*length);
+    file.close();
+    return isRead;
+}
+
+boolean HalFileWrite(const char *name, const uint8_t *buffer, size_t length)
+{
+    // FILE_WRITE appends, drop the old copy first
+    SD.remove(name);
+    File file = SD.open(name, FILE_WRITE);
+    if(!file)
+    {
+        return false;
+    }
+
+    size_t written = file.write(buffer, length);
+    file.close();
+    return written == length;
+}
+
+boolean HalFileAppend(const char *name, const uint8_t *buffer, size_t length)
+{
+    File file = SD.open(name, FILE_WRITE);
+    if(!file)
+    {
+        return false;
+    }
+
+    size_t written = file.write(buffer, length);
+    file.close();
+    return written == length;
+}
+
+boolean HalFileOpen(const char *name)
+{
+    readFile = SD.open(name);
+    return (bool)readFile;
+}
+
+size_t HalFileReadBytes(uint8_t *buffer, size_t length)
+{
+    int count = readFile.read(buffer, length);
+    return (count > 0) ? count : 0;
+}
+
+void HalFileClose()
+{
+    readFile.close();
+}
+
+void HalSerialBegin(uint32_t baud)
+{
+    serial.begin(baud);
+}
+
+void HalSerialWrite(const char *text)
+{
+    serial.print(text);
+}
+#endif
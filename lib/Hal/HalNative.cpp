@@ -0,0 +1,484 @@
+#if !defined(ARDUINO)
+#include "Hal.h"
+#include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// Host stand-ins for the board. Time only moves through HalSimAdvance() (or
+// HalDelay()), so a run is fully deterministic. The DS3231 keeps its time
+// as unix seconds and drives every FALLING interrupt as its 1 Hz SQW output.
+// PCA9685 boards are register files, their outputs go through the PWM hook.
+
+#define SIM_DISPLAY_COLS    20
+#define SIM_DISPLAY_ROWS    4
+#define SIM_RTC_REGISTERS   0x13
+#define SIM_RTC_CONTROL     0x0E
+#define SIM_RTC_INTCN       0x04
+#define SIM_FILE_DIR        "sdcard"
+#define SIM_EXPANDER_BOARDS     4
+#define SIM_EXPANDER_CHANNELS   16
+#define SIM_EXPANDER_REGISTERS  256
+#define SIM_EXPANDER_LED0       0x06
+#define SIM_EXPANDER_ALL_LED    0xFA
+#define SIM_EXPANDER_FULL       0x10
+
+static uint64_t simMicros = 0;
+static uint32_t simPwm[HAL_PIN_COUNT];
+static uint32_t simTone[HAL_PIN_COUNT];
+static void (*simCallbacks[HAL_PIN_COUNT])();
+static uint8_t simModes[HAL_PIN_COUNT];
+static void (*simPwmHook)(uint32_t pin, uint32_t value) = nullptr;
+
+static uint8_t rtcRegisters[SIM_RTC_REGISTERS] = {0, 0, 0, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, SIM_RTC_INTCN | 0x18};
+static uint32_t rtcUnixTime = 946684800UL;
+static uint32_t rtcMillis = 0;
+
+static char displayRows[SIM_DISPLAY_ROWS][SIM_DISPLAY_COLS + 1];
+static uint8_t displayCol = 0;
+static uint8_t displayRow = 0;
+static bool displayBacklight = false;
+static uint32_t displayBytes = 0;
+static FILE *readFile = nullptr;
+
+static uint8_t expanderRegisters[SIM_EXPANDER_BOARDS][SIM_EXPANDER_REGISTERS];
+static uint32_t expanderPwm[SIM_EXPANDER_BOARDS * SIM_EXPANDER_CHANNELS];
+static uint32_t expanderWrites = 0;
+
+static uint8_t ToBcd(uint8_t value)
+{
+    return ((value / 10) << 4) | (value % 10);
+}
+
+static uint8_t FromBcd(uint8_t value)
+{
+    return (value >> 4) * 10 + (value & 0x0F);
+}
+
+static int32_t DaysFromCivil(int32_t year, uint8_t month, uint8_t day)
+{
+    year -= (month <= 2);
+    int32_t era = year / 400;
+    uint32_t yearOfEra = year - era * 400;
+    uint32_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + (int32_t)dayOfEra - 719468;
+}
+
+static void RtcToRegisters()
+{
+    int32_t days = rtcUnixTime / 86400UL;
+    uint32_t secondOfDay = rtcUnixTime % 86400UL;
+
+    days += 719468;
+    int32_t era = days / 146097;
+    uint32_t dayOfEra = days - era * 146097;
+    uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    uint32_t monthIndex = (5 * dayOfYear + 2) / 153;
+    uint8_t day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    uint8_t month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int32_t year = yearOfEra + era * 400 + (month <= 2);
+
+    rtcRegisters[0] = ToBcd(secondOfDay % 60);
+    rtcRegisters[1] = ToBcd((secondOfDay / 60) % 60);
+    rtcRegisters[2] = ToBcd(secondOfDay / 3600);
+    rtcRegisters[3] = ((rtcUnixTime / 86400UL + 4) % 7) + 1;
+    rtcRegisters[4] = ToBcd(day);
+    rtcRegisters[5] = ToBcd(month);
+    rtcRegisters[6] = ToBcd(year - 2000);
+}
+
+static void RtcFromRegisters()
+{
+    uint8_t hour = FromBcd(rtcRegisters[2] & 0x3F);
+    int32_t days = DaysFromCivil(2000 + FromBcd(rtcRegisters[6]), FromBcd(rtcRegisters[5] & 0x1F), FromBcd(rtcRegisters[4] & 0x3F));
+    rtcUnixTime = days * 86400UL + hour * 3600UL + FromBcd(rtcRegisters[1] & 0x7F) * 60UL + FromBcd(rtcRegisters[0] & 0x7F);
+}
+
+static void RtcPulse()
+{
+    if(rtcRegisters[SIM_RTC_CONTROL] & SIM_RTC_INTCN)
+        return;
+
+    for(uint8_t pin = 0; pin < HAL_PIN_COUNT; pin++)
+    {
+        if(simCallbacks[pin] != nullptr && simModes[pin] == FALLING)
+        {
+            simCallbacks[pin]();
+        }
+    }
+}
+
+static void FilePath(const char *name, char *path, size_t size)
+{
+    snprintf(path, size, "%s/%s", SIM_FILE_DIR, (name[0] == '/') ? name + 1 : name);
+}
+
+void HalBegin()
+{
+}
+
+uint32_t HalMillis()
+{
+    return (uint32_t)(simMicros / 1000);
+}
+
+uint32_t HalMicros()
+{
+    return (uint32_t)simMicros;
+}
+
+void HalDelay(uint32_t ms)
+{
+    HalSimAdvance(ms);
+}
+
+// Profiling measures the host, not the simulated clock
+uint32_t HalCycles()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+uint32_t HalCyclesPerSecond()
+{
+    return 1000000000UL;
+}
+
+void HalPinMode(uint32_t pin, uint32_t mode)
+{
+}
+
+void HalPwmWrite(uint32_t pin, uint32_t value)
+{
+    if(pin >= HAL_PIN_COUNT || simPwm[pin] == value)
+        return;
+
+    simPwm[pin] = value;
+    if(simPwmHook != nullptr)
+    {
+        simPwmHook(pin, value);
+    }
+}
+
+HalPwm HalPwmAttach(uint32_t pin)
+{
+    return {pin, nullptr};
+}
+
+void HalPwmSet(const HalPwm &pwm, uint32_t value)
+{
+    HalPwmWrite(pwm.pin, value);
+}
+
+void HalAttachInterrupt(uint32_t pin, void (*callback)(), uint32_t mode)
+{
+    if(pin < HAL_PIN_COUNT)
+    {
+        simCallbacks[pin] = callback;
+        simModes[pin] = mode;
+    }
+}
+
+void HalInterruptsOff()
+{
+}
+
+void HalInterruptsOn()
+{
+}
+
+void HalTone(uint32_t pin, uint32_t frequency)
+{
+    if(pin < HAL_PIN_COUNT)
+    {
+        simTone[pin] = frequency;
+    }
+}
+
+void HalNoTone(uint32_t pin)
+{
+    HalTone(pin, 0);
+}
+
+boolean HalRtcRead(uint8_t reg, uint8_t *data, uint8_t length)
+{
+    if(reg + length > SIM_RTC_REGISTERS)
+        return false;
+
+    RtcToRegisters();
+    memcpy(data, &rtcRegisters[reg], length);
+    return true;
+}
+
+boolean HalRtcWrite(uint8_t reg, const uint8_t *data, uint8_t length)
+{
+    if(reg + length > SIM_RTC_REGISTERS)
+        return false;
+
+    RtcToRegisters();
+    memcpy(&rtcRegisters[reg], data, length);
+
+    // Writing the seconds register restarts the countdown, like the real chip
+    if(reg <= 6)
+    {
+        RtcFromRegisters();
+        if(reg == 0)
+        {
+            rtcMillis = 0;
+        }
+    }
+
+    return true;
+}
+
+// High time in counts of one expander channel, 4096 when fully on
+static void ExpanderOutput(uint8_t board, uint8_t channel)
+{
+    const uint8_t *led = &expanderRegisters[board][SIM_EXPANDER_LED0 + channel * 4];
+    uint32_t value;
+    if(led[3] & SIM_EXPANDER_FULL)
+    {
+        value = 0;
+    }
+    else if(led[1] & SIM_EXPANDER_FULL)
+    {
+        value = 4096;
+    }
+    else
+    {
+        value = ((led[2] | (led[3] << 8)) - (led[0] | (led[1] << 8))) & 0xFFF;
+    }
+
+    uint32_t pin = board * SIM_EXPANDER_CHANNELS + channel;
+    if(expanderPwm[pin] == value)
+        return;
+
+    expanderPwm[pin] = value;
+    if(simPwmHook != nullptr)
+    {
+        simPwmHook(HAL_SIM_EXPANDER_PIN + pin, value);
+    }
+}
+
+boolean HalExpanderWrite(uint8_t address, uint8_t reg, const uint8_t *data, uint8_t length)
+{
+    uint8_t board = address - HAL_EXPANDER_ADDRESS;
+    if(board >= SIM_EXPANDER_BOARDS || reg + length > SIM_EXPANDER_REGISTERS || length > HAL_EXPANDER_POST_MAX)
+        return false;
+
+    expanderWrites++;
+    for(uint8_t i = 0; i < length; i++)
+    {
+        uint8_t r = reg + i;
+        expanderRegisters[board][r] = data[i];
+
+        // ALL_LED registers write through to every channel
+        if(r >= SIM_EXPANDER_ALL_LED && r < SIM_EXPANDER_ALL_LED + 4)
+        {
+            for(uint8_t channel = 0; channel < SIM_EXPANDER_CHANNELS; channel++)
+            {
+                expanderRegisters[board][SIM_EXPANDER_LED0 + channel * 4 + r - SIM_EXPANDER_ALL_LED] = data[i];
+            }
+        }
+    }
+
+    for(uint8_t channel = 0; channel < SIM_EXPANDER_CHANNELS; channel++)
+    {
+        ExpanderOutput(board, channel);
+    }
+
+    return true;
+}
+
+boolean HalExpanderPost(uint8_t address, uint8_t reg, const uint8_t *data, uint8_t length)
+{
+    return HalExpanderWrite(address, reg, data, length);
+}
+
+void HalDisplayBegin(uint8_t cols, uint8_t rows)
+{
+    HalDisplayClear();
+}
+
+void HalDisplayClear()
+{
+    for(uint8_t row = 0; row < SIM_DISPLAY_ROWS; row++)
+    {
+        memset(displayRows[row], ' ', SIM_DISPLAY_COLS);
+        displayRows[row][SIM_DISPLAY_COLS] = '\0';
+    }
+
+    displayCol = 0;
+    displayRow = 0;
+    displayBytes++;
+}
+
+void HalDisplayBacklight(boolean isOn)
+{
+    displayBacklight = isOn;
+}
+
+void HalDisplaySetCursor(uint8_t col, uint8_t row)
+{
+    displayCol = col;
+    displayRow = row;
+    displayBytes++;
+}
+
+void HalDisplayWrite(const char *text)
+{
+    while(*text != '\0')
+    {
+        if(displayRow < SIM_DISPLAY_ROWS && displayCol < SIM_DISPLAY_COLS)
+        {
+            displayRows[displayRow][displayCol] = *text;
+        }
+
+        displayCol++;
+        displayBytes++;
+        text++;
+    }
+}
+
+void HalDisplayCreateChar(uint8_t location, const uint8_t *bitmap)
+{
+    displayBytes += 9;
+}
+
+boolean HalFileBegin(uint32_t csPin)
+{
+    mkdir(SIM_FILE_DIR, 0755);
+    struct stat info;
+    return stat(SIM_FILE_DIR, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+boolean HalFileRead(const char *name, uint8_t *buffer, size_t size, size_t *length)
+{
+    char path[64];
+    FilePath(name, path, sizeof(path));
+    FILE *file = fopen(path, "rb");
+    if(file == nullptr)
+        return false;
+
+    *length = fread(buffer, 1, size, file);
+    bool isRead = (fgetc(file) == EOF && !ferror(file));
+    fclose(file);
+    return isRead;
+}
+
+boolean HalFileWrite(const char *name, const uint8_t *buffer, size_t length)
+{
+    char path[64];
+    FilePath(name, path, sizeof(path));
+    FILE *file = fopen(path, "wb");
+    if(file == nullptr)
+        return false;
+
+    size_t written = fwrite(buffer, 1, length, file);
+    return (fclose(file) == 0 && written == length);
+}
+
+boolean HalFileAppend(const char *name, const uint8_t *buffer, size_t length)
+{
+    char path[64];
+    FilePath(name, path, sizeof(path));
+    FILE *file = fopen(path, "ab");
+    if(file == nullptr)
+        return false;
+
+    size_t written = fwrite(buffer, 1, length, file);
+    return (fclose(file) == 0 && written == length);
+}
+
+boolean HalFileOpen(const char *name)
+{
+    char path[64];
+    FilePath(name, path, sizeof(path));
+    HalFileClose();
+    readFile = fopen(path, "rb");
+    return readFile != nullptr;
+}
+
+size_t HalFileReadBytes(uint8_t *buffer, size_t length)
+{
+    return (readFile != nullptr) ? fread(buffer, 1, length, readFile) : 0;
+}
+
+void HalFileClose()
+{
+    if(readFile != nullptr)
+    {
+        fclose(readFile);
+        readFile = nullptr;
+    }
+}
+
+void HalSerialBegin(uint32_t baud)
+{
+}
+
+void HalSerialWrite(const char *text)
+{
+    fputs(text, stdout);
+}
+
+void HalSimAdvance(uint32_t ms)
+{
+    simMicros += (uint64_t)ms * 1000;
+    rtcMillis += ms;
+
+    while(rtcMillis >= 1000)
+    {
+        rtcMillis -= 1000;
+        rtcUnixTime++;
+        RtcPulse();
+    }
+}
+
+void HalSimSetRtc(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+{
+    rtcUnixTime = DaysFromCivil(year, month, day) * 86400UL + hour * 3600UL + minute * 60UL + second;
+    rtcMillis = 0;
+}
+
+uint32_t HalSimGetPwm(uint32_t pin)
+{
+    if(pin >= HAL_SIM_EXPANDER_PIN && pin < HAL_SIM_EXPANDER_PIN + SIM_EXPANDER_BOARDS * SIM_EXPANDER_CHANNELS)
+        return expanderPwm[pin - HAL_SIM_EXPANDER_PIN];
+
+    return (pin < HAL_PIN_COUNT) ? simPwm[pin] : 0;
+}
+
+void HalSimSetPwmHook(void (*hook)(uint32_t pin, uint32_t value))
+{
+    simPwmHook = hook;
+}
+
+uint32_t HalSimGetTone(uint32_t pin)
+{
+    return (pin < HAL_PIN_COUNT) ? simTone[pin] : 0;
+}
+
+boolean HalSimIsBacklight()
+{
+    return displayBacklight;
+}
+
+const char *HalSimGetDisplayRow(uint8_t row)
+{
+    return (row < SIM_DISPLAY_ROWS) ? displayRows[row] : "";
+}
+
+uint32_t HalSimGetDisplayBytes()
+{
+    return displayBytes;
+}
+
+// Transactions to the expanders, a burst counts once
+uint32_t HalSimGetExpanderWrites()
+{
+    return expanderWrites;
+}
+#endif
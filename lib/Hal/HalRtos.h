@@ -0,0 +1,42 @@
+#pragma once
+#include "Hal.h"
+
+// FreeRTOS on target. The host build gets a cooperative stand-in with the
+// calls the firmware uses: a task runs until it blocks, then the scheduler
+// moves the simulated clock to the next task that is due. Equal inputs give
+// equal runs.
+
+#if defined(ARDUINO)
+#include <STM32FreeRTOS.h>
+#else
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef struct HalRtosQueue *QueueHandle_t;
+typedef struct HalRtosQueue *SemaphoreHandle_t;
+typedef struct HalRtosTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              pdTRUE
+#define portMAX_DELAY       0xFFFFFFFFUL
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define tskIDLE_PRIORITY    0
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint16_t stackDepth, void *parameters, UBaseType_t priority, TaskHandle_t *handle);
+void vTaskStartScheduler();
+void vTaskEndScheduler();
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t increment);
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait);
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+// SIMULATION, host only. The hook sees every run of a task until it blocked
+void HalSimSetTaskHook(void (*hook)(const char *name, uint32_t hostMicros));
+#endif
@@ -0,0 +1,275 @@
+#if !defined(ARDUINO)
+#include "HalRtos.h"
+#include <time.h>
+#include <ucontext.h>
+
+// Tasks are ucontext coroutines on heap stacks. The highest priority task
+// that is due runs first; when none is due the clock jumps to the earliest
+// wake up. Blocking calls park the task with a deadline and the object it
+// waits on, a send or give on that object makes it due again.
+
+#define SIM_TASK_COUNT      8
+#define SIM_STACK_SIZE      (256 * 1024)
+
+struct HalRtosTask
+{
+    ucontext_t context;
+    TaskFunction_t code;
+    void *parameters;
+    const char *name;
+    UBaseType_t priority;
+    TickType_t wakeTick;
+    bool isForever;
+    bool isDone;
+    const void *waitObject;
+    uint8_t *stack;
+};
+
+struct HalRtosQueue
+{
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+    HalRtosTask *owner;
+};
+
+static HalRtosTask tasks[SIM_TASK_COUNT];
+static uint8_t taskCount = 0;
+static HalRtosTask *current = nullptr;
+static ucontext_t schedulerContext;
+static bool isRunning = false;
+static void (*taskHook)(const char *name, uint32_t hostMicros) = nullptr;
+
+static bool IsDue(const HalRtosTask *task, TickType_t now)
+{
+    return !task->isDone && !task->isForever && (int32_t)(task->wakeTick - now) <= 0;
+}
+
+static uint64_t HostMicros()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void TaskEntry()
+{
+    current->code(current->parameters);
+    current->isDone = true;
+}
+
+// Parks the running task until ticks have passed or waitObject is signalled
+static void Block(TickType_t ticks, const void *waitObject)
+{
+    current->isForever = (ticks == portMAX_DELAY);
+    current->wakeTick = HalMillis() + (current->isForever ? 0 : ticks);
+    current->waitObject = waitObject;
+    swapcontext(&current->context, &schedulerContext);
+}
+
+static void Signal(const void *object)
+{
+    for(uint8_t i = 0; i < taskCount; i++)
+    {
+        if(tasks[i].waitObject == object)
+        {
+            tasks[i].waitObject = nullptr;
+            tasks[i].isForever = false;
+            tasks[i].wakeTick = HalMillis();
+        }
+    }
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint16_t stackDepth, void *parameters, UBaseType_t priority, TaskHandle_t *handle)
+{
+    if(taskCount >= SIM_TASK_COUNT)
+        return pdFALSE;
+
+    HalRtosTask *task = &tasks[taskCount++];
+    task->code = code;
+    task->parameters = parameters;
+    task->name = name;
+    task->priority = priority;
+    task->wakeTick = HalMillis();
+    task->stack = (uint8_t *)malloc(SIM_STACK_SIZE);
+
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = task->stack;
+    task->context.uc_stack.ss_size = SIM_STACK_SIZE;
+    task->context.uc_link = &schedulerContext;
+    makecontext(&task->context, TaskEntry, 0);
+
+    if(handle != nullptr)
+    {
+        *handle = task;
+    }
+
+    return pdPASS;
+}
+
+void vTaskStartScheduler()
+{
+    isRunning = true;
+
+    while(isRunning)
+    {
+        TickType_t now = HalMillis();
+        HalRtosTask *next = nullptr;
+
+        for(uint8_t i = 0; i < taskCount; i++)
+        {
+            if(IsDue(&tasks[i], now) && (next == nullptr || tasks[i].priority > next->priority))
+            {
+                next = &tasks[i];
+            }
+        }
+
+        if(next == nullptr)
+        {
+            bool isWaiting = false;
+            TickType_t wakeTick = 0;
+
+            for(uint8_t i = 0; i < taskCount; i++)
+            {
+                if(!tasks[i].isDone && !tasks[i].isForever && (!isWaiting || (int32_t)(tasks[i].wakeTick - wakeTick) < 0))
+                {
+                    wakeTick = tasks[i].wakeTick;
+                    isWaiting = true;
+                }
+            }
+
+            // Every task waits forever, nothing can wake them up
+            if(!isWaiting)
+                break;
+
+            HalSimAdvance(wakeTick - now);
+            continue;
+        }
+
+        uint64_t startMicros = HostMicros();
+        current = next;
+        current->waitObject = nullptr;
+        swapcontext(&schedulerContext, &current->context);
+
+        if(taskHook != nullptr)
+        {
+            taskHook(current->name, (uint32_t)(HostMicros() - startMicros));
+        }
+    }
+
+    current = nullptr;
+}
+
+void vTaskEndScheduler()
+{
+    isRunning = false;
+    if(current != nullptr)
+    {
+        Block(portMAX_DELAY, nullptr);
+    }
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return HalMillis();
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    Block(ticks, nullptr);
+}
+
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t increment)
+{
+    *previousWakeTime += increment;
+    int32_t remaining = (int32_t)(*previousWakeTime - HalMillis());
+    Block((remaining > 0) ? remaining : 0, nullptr);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    HalRtosQueue *queue = (HalRtosQueue *)calloc(1, sizeof(HalRtosQueue));
+    queue->items = (uint8_t *)malloc(length * itemSize);
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    TickType_t deadline = HalMillis() + ticksToWait;
+
+    while(queue->count >= queue->length)
+    {
+        int32_t remaining = (int32_t)(deadline - HalMillis());
+        if(ticksToWait == 0 || (ticksToWait != portMAX_DELAY && remaining <= 0))
+            return pdFALSE;
+
+        Block((ticksToWait == portMAX_DELAY) ? portMAX_DELAY : remaining, queue);
+    }
+
+    memcpy(&queue->items[((queue->head + queue->count) % queue->length) * queue->itemSize], item, queue->itemSize);
+    queue->count++;
+    Signal(queue);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait)
+{
+    TickType_t deadline = HalMillis() + ticksToWait;
+
+    while(queue->count == 0)
+    {
+        int32_t remaining = (int32_t)(deadline - HalMillis());
+        if(ticksToWait == 0 || (ticksToWait != portMAX_DELAY && remaining <= 0))
+            return pdFALSE;
+
+        Block((ticksToWait == portMAX_DELAY) ? portMAX_DELAY : remaining, queue);
+    }
+
+    memcpy(buffer, &queue->items[queue->head * queue->itemSize], queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    Signal(queue);
+    return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return (HalRtosQueue *)calloc(1, sizeof(HalRtosQueue));
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+{
+    TickType_t deadline = HalMillis() + ticksToWait;
+
+    while(semaphore->owner != nullptr)
+    {
+        int32_t remaining = (int32_t)(deadline - HalMillis());
+        if(ticksToWait == 0 || (ticksToWait != portMAX_DELAY && remaining <= 0))
+            return pdFALSE;
+
+        Block((ticksToWait == portMAX_DELAY) ? portMAX_DELAY : remaining, semaphore);
+    }
+
+    semaphore->owner = current;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    if(semaphore->owner != current)
+        return pdFALSE;
+
+    semaphore->owner = nullptr;
+    Signal(semaphore);
+    return pdTRUE;
+}
+
+void HalSimSetTaskHook(void (*hook)(const char *name, uint32_t hostMicros))
+{
+    taskHook = hook;
+}
+#endif
@@ -0,0 +1,6 @@
+#pragma once
+#include <Hal.h>
+
+// Counts calls into the allocator. Requires the linker to be run with
+// -Wl,--wrap=malloc -Wl,--wrap=realloc -Wl,--wrap=calloc (see platformio.ini).
+uint32_t GetHeapAllocCount();
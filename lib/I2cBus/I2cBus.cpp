@@ -0,0 +1,380 @@
+#include "I2cBus.h"
+
+// I2C1 with event and error interrupts, no DMA: a chunk is 16 bytes and the
+// receive side needs the byte count tricks of the F1 peripheral anyway.
+// Reception follows the RM0008 sequences for 1, 2 and more than 2 bytes.
+
+#if defined(STM32F1xx)
+static I2cBus *busI2c1 = nullptr;
+#endif
+
+boolean I2cBus::Begin(uint8_t queueAddress)
+{
+#if defined(STM32F1xx)
+    _queueAddress = queueAddress;
+    busI2c1 = this;
+
+    RCC->APB2ENR |= RCC_APB2ENR_IOPBEN;
+    RCC->APB1ENR |= RCC_APB1ENR_I2C1EN;
+
+    // PB6/PB7 alternate function open drain, 50 MHz
+    GPIOB->CRL = (GPIOB->CRL & ~(0xFFUL << 24)) | (0xFFUL << 24);
+
+    Reset();
+
+    NVIC_SetPriority(I2C1_EV_IRQn, 5);
+    NVIC_SetPriority(I2C1_ER_IRQn, 5);
+    NVIC_EnableIRQ(I2C1_EV_IRQn);
+    NVIC_EnableIRQ(I2C1_ER_IRQn);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void I2cBus::Queue(const uint8_t *data, uint16_t length)
+{
+#if defined(STM32F1xx)
+    for(uint16_t i = 0; i < length; i++)
+    {
+        // Full only when a redraw is queued behind another one, then wait for room
+        uint32_t start = HalMillis();
+        while(_queueCount >= I2C_BUS_QUEUE_SIZE)
+        {
+            if(HalMillis() - start >= I2C_BUS_TIMEOUT_MS)
+            {
+                Reset();
+            }
+        }
+
+        HalInterruptsOff();
+        _queue[(_queueHead + _queueCount) % I2C_BUS_QUEUE_SIZE] = data[i];
+        _queueCount++;
+        HalInterruptsOn();
+    }
+
+    HalInterruptsOff();
+    if(!_isBusy)
+    {
+        StartNext();
+    }
+    HalInterruptsOn();
+#endif
+}
+
+void I2cBus::WaitIdle()
+{
+#if defined(STM32F1xx)
+    uint32_t start = HalMillis();
+    while(_isBusy || _queueCount > 0)
+    {
+        if(HalMillis() - start >= I2C_BUS_TIMEOUT_MS * (1 + _queueCount / I2C_BUS_CHUNK))
+        {
+            Reset();
+            return;
+        }
+    }
+#endif
+}
+
+boolean I2cBus::Transfer(uint8_t address, const uint8_t *tx, uint8_t txLength, uint8_t *rx, uint8_t rxLength)
+{
+#if defined(STM32F1xx)
+    if(!WaitTransfer())
+    {
+        return false;
+    }
+
+    _address = address;
+    _tx = tx;
+    _txLength = txLength;
+    _rx = rx;
+    _rxLength = rxLength;
+    _isTransferDone = false;
+    _isTransferFailed = false;
+
+    HalInterruptsOff();
+    _isTransferPending = true;
+    if(!_isBusy)
+    {
+        StartNext();
+    }
+    HalInterruptsOn();
+
+    uint32_t start = HalMillis();
+    while(!_isTransferDone)
+    {
+        if(HalMillis() - start >= I2C_BUS_TIMEOUT_MS)
+        {
+            Reset();
+            return false;
+        }
+    }
+
+    return !_isTransferFailed;
+#else
+    return false;
+#endif
+}
+
+// Register pointer and data copied into the post buffer, true once queued.
+// A NACK on the way is not reported, the caller writes the state again later
+boolean I2cBus::Post(uint8_t address, uint8_t reg, const uint8_t *data, uint8_t length)
+{
+#if defined(STM32F1xx)
+    if(length >= I2C_BUS_POST_SIZE || !WaitTransfer())
+    {
+        return false;
+    }
+
+    _post[0] = reg;
+    memcpy(&_post[1], data, length);
+    _address = address;
+    _tx = _post;
+    _txLength = length + 1;
+    _rx = nullptr;
+    _rxLength = 0;
+    _isTransferDone = false;
+    _isTransferFailed = false;
+
+    HalInterruptsOff();
+    _isTransferPending = true;
+    if(!_isBusy)
+    {
+        StartNext();
+    }
+    HalInterruptsOn();
+    return true;
+#else
+    return false;
+#endif
+}
+
+// A posted write still on the bus holds the transfer slot and its buffer
+bool I2cBus::WaitTransfer()
+{
+#if defined(STM32F1xx)
+    uint32_t start = HalMillis();
+    while(_isTransferPending)
+    {
+        if(HalMillis() - start >= I2C_BUS_TIMEOUT_MS)
+        {
+            Reset();
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+
+// Called with interrupts off or from the interrupt
+void I2cBus::StartNext()
+{
+#if defined(STM32F1xx)
+    bool isQueue = (_queueCount > 0);
+    bool isTransfer = _isTransferPending;
+
+    // Take turns while both wait, so neither side waits for more than one job of the other
+    if(isQueue && isTransfer)
+    {
+        isQueue = !_isLastQueue;
+    }
+
+    if(!isQueue && !isTransfer)
+    {
+        _isBusy = false;
+        return;
+    }
+
+    _isBusy = true;
+    _isQueueJob = isQueue;
+    _isLastQueue = isQueue;
+    _index = 0;
+    _isReading = (!isQueue && _txLength == 0);
+    if(isQueue)
+    {
+        _chunkLength = (_queueCount < I2C_BUS_CHUNK) ? _queueCount : I2C_BUS_CHUNK;
+    }
+
+    // The peripheral ignores START until the previous STOP is out
+    while(I2C1->CR1 & I2C_CR1_STOP) {}
+
+    I2C1->CR1 |= I2C_CR1_ACK;
+    I2C1->CR1 &= ~I2C_CR1_POS;
+    I2C1->CR2 |= I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN | I2C_CR2_ITERREN;
+    I2C1->CR1 |= I2C_CR1_START;
+#endif
+}
+
+void I2cBus::Finish(bool isFailed)
+{
+#if defined(STM32F1xx)
+    if(_isQueueJob)
+    {
+        // A failed chunk is dropped, the next flush redraws what changed anyway
+        _queueHead = (_queueHead + _chunkLength) % I2C_BUS_QUEUE_SIZE;
+        _queueCount -= _chunkLength;
+    }
+    else
+    {
+        _isTransferPending = false;
+        _isTransferFailed = isFailed;
+        _isTransferDone = true;
+    }
+
+    StartNext();
+#endif
+}
+
+void I2cBus::Reset()
+{
+#if defined(STM32F1xx)
+    HalInterruptsOff();
+    I2C1->CR1 = I2C_CR1_SWRST;
+    I2C1->CR1 = 0;
+
+    // APB1 runs at half the core clock, 36 MHz at 72 MHz
+    I2C1->CR2 = (SystemCoreClock / 2) / 1000000;
+    I2C1->CCR = (SystemCoreClock / 2) / (2 * I2C_BUS_SPEED_HZ);
+    I2C1->TRISE = (SystemCoreClock / 2) / 1000000 + 1;
+    I2C1->CR1 = I2C_CR1_PE;
+
+    _queueHead = 0;
+    _queueCount = 0;
+    if(_isTransferPending)
+    {
+        _isTransferPending = false;
+        _isTransferFailed = true;
+        _isTransferDone = true;
+    }
+    _isBusy = false;
+    HalInterruptsOn();
+#endif
+}
+
+void I2cBus::HandleEventIrq()
+{
+#if defined(STM32F1xx)
+    uint32_t sr1 = I2C1->SR1;
+
+    if(sr1 & I2C_SR1_SB)
+    {
+        uint8_t address = _isQueueJob ? _queueAddress : _address;
+        I2C1->DR = (address << 1) | (_isReading ? 1 : 0);
+        return;
+    }
+
+    if(sr1 & I2C_SR1_ADDR)
+    {
+        if(_isReading && _rxLength == 1)
+        {
+            I2C1->CR1 &= ~I2C_CR1_ACK;
+            (void)I2C1->SR2;
+            I2C1->CR1 |= I2C_CR1_STOP;
+        }
+        else if(_isReading && _rxLength == 2)
+        {
+            I2C1->CR1 &= ~I2C_CR1_ACK;
+            I2C1->CR1 |= I2C_CR1_POS;
+            (void)I2C1->SR2;
+            I2C1->CR2 &= ~I2C_CR2_ITBUFEN;
+        }
+        else
+        {
+            (void)I2C1->SR2;
+            if(_isReading && _rxLength == 3)
+            {
+                I2C1->CR2 &= ~I2C_CR2_ITBUFEN;
+            }
+        }
+        return;
+    }
+
+    if(_isReading)
+    {
+        uint8_t remaining = _rxLength - _index;
+
+        if(remaining == 1 && (sr1 & I2C_SR1_RXNE))
+        {
+            _rx[_index++] = I2C1->DR;
+            Finish(false);
+        }
+        else if(remaining == 2 && (sr1 & I2C_SR1_BTF))
+        {
+            I2C1->CR1 |= I2C_CR1_STOP;
+            _rx[_index++] = I2C1->DR;
+            _rx[_index++] = I2C1->DR;
+            Finish(false);
+        }
+        else if(remaining == 3 && (sr1 & I2C_SR1_BTF))
+        {
+            // Byte N-2 in DR and N-1 in the shift register: NACK the last one
+            I2C1->CR1 &= ~I2C_CR1_ACK;
+            _rx[_index++] = I2C1->DR;
+            I2C1->CR1 |= I2C_CR1_STOP;
+            _rx[_index++] = I2C1->DR;
+            I2C1->CR2 |= I2C_CR2_ITBUFEN;
+        }
+        else if(remaining > 3 && (sr1 & I2C_SR1_RXNE))
+        {
+            _rx[_index++] = I2C1->DR;
+            if(remaining == 4)
+            {
+                I2C1->CR2 &= ~I2C_CR2_ITBUFEN;
+            }
+        }
+        return;
+    }
+
+    uint16_t length = _isQueueJob ? _chunkLength : _txLength;
+    if((sr1 & (I2C_SR1_TXE | I2C_SR1_BTF)) && _index < length)
+    {
+        I2C1->DR = _isQueueJob ? _queue[(_queueHead + _index) % I2C_BUS_QUEUE_SIZE] : _tx[_index];
+        _index++;
+        if(_index == length)
+        {
+            I2C1->CR2 &= ~I2C_CR2_ITBUFEN;
+        }
+    }
+    else if(sr1 & I2C_SR1_BTF)
+    {
+        if(!_isQueueJob && _rxLength > 0)
+        {
+            // Register pointer sent, read back with a repeated start
+            _isReading = true;
+            _index = 0;
+            I2C1->CR2 |= I2C_CR2_ITBUFEN;
+            I2C1->CR1 |= I2C_CR1_START;
+        }
+        else
+        {
+            I2C1->CR1 |= I2C_CR1_STOP;
+            Finish(false);
+        }
+    }
+#endif
+}
+
+void I2cBus::HandleErrorIrq()
+{
+#if defined(STM32F1xx)
+    // NACK, lost arbitration or bus error: release the bus and move on
+    I2C1->SR1 &= ~(I2C_SR1_AF | I2C_SR1_ARLO | I2C_SR1_BERR | I2C_SR1_OVR);
+    I2C1->CR1 |= I2C_CR1_STOP;
+    Finish(true);
+#endif
+}
+
+#if defined(STM32F1xx)
+extern "C" void I2C1_EV_IRQHandler(void)
+{
+    if(busI2c1 != nullptr)
+        busI2c1->HandleEventIrq();
+}
+
+extern "C" void I2C1_ER_IRQHandler(void)
+{
+    if(busI2c1 != nullptr)
+        busI2c1->HandleErrorIrq();
+}
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+#include <Hal.h>
+
+// Interrupt driven master on I2C1 (PB6 SCL, PB7 SDA) for two clients: a
+// queue of bytes for one write-only device (the LCD expander) that drains
+// in the background, and blocking register transfers (the RTC). Transfers
+// wait for at most the chunk in flight, then the bus alternates between the
+// two while both have work. Transfer() takes one caller at a time.
+//
+// Post() is a register write that does not wait for the bus: the bytes are
+// copied and go out in the transfer slot while the caller carries on (the
+// PWM expanders). The next Post() or Transfer() waits for it.
+
+#define I2C_BUS_QUEUE_SIZE  512
+#define I2C_BUS_CHUNK       16
+#define I2C_BUS_SPEED_HZ    100000
+#define I2C_BUS_TIMEOUT_MS  10UL
+#define I2C_BUS_POST_SIZE   65
+
+class I2cBus
+{
+private:
+    uint8_t _queue[I2C_BUS_QUEUE_SIZE];
+    volatile uint16_t _queueHead = 0;
+    volatile uint16_t _queueCount = 0;
+    uint8_t _queueAddress;
+    uint16_t _chunkLength;
+
+    // Register transfer, one at a time
+    volatile bool _isTransferPending = false;
+    volatile bool _isTransferDone = false;
+    volatile bool _isTransferFailed = false;
+    uint8_t _address;
+    const uint8_t *_tx;
+    uint8_t _txLength;
+    uint8_t *_rx;
+    uint8_t _rxLength;
+    uint8_t _post[I2C_BUS_POST_SIZE];
+
+    // Transaction on the wire
+    volatile bool _isBusy = false;
+    bool _isQueueJob;
+    bool _isReading;
+    uint16_t _index;
+    bool _isLastQueue = false;
+    void StartNext();
+    void Finish(bool isFailed);
+    void Reset();
+    bool WaitTransfer();
+
+public:
+    boolean Begin(uint8_t queueAddress);
+    void Queue(const uint8_t *data, uint16_t length);
+    void WaitIdle();
+    boolean Transfer(uint8_t address, const uint8_t *tx, uint8_t txLength, uint8_t *rx, uint8_t rxLength);
+    boolean Post(uint8_t address, uint8_t reg, const uint8_t *data, uint8_t length);
+    void HandleEventIrq();
+    void HandleErrorIrq();
+};
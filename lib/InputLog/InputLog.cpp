@@ -0,0 +1,47 @@
+#include "InputLog.h"
+
+void InputLog::Record(uint8_t type, int8_t value, uint32_t unixTime)
+{
+    HalInterruptsOff();
+    InputRecord *record = &_records[_head];
+    record->millis = HalMillis();
+    record->unixTime = unixTime;
+    record->type = type;
+    record->value = value;
+    record->reserved = 0;
+    _head = (_head + 1) % INPUT_LOG_SIZE;
+    _total++;
+    HalInterruptsOn();
+}
+
+void InputLog::Clear()
+{
+    HalInterruptsOff();
+    _head = 0;
+    _total = 0;
+    HalInterruptsOn();
+}
+
+uint16_t InputLog::GetCount()
+{
+    return (_total < INPUT_LOG_SIZE) ? _total : INPUT_LOG_SIZE;
+}
+
+uint32_t InputLog::GetDropped()
+{
+    return _total - GetCount();
+}
+
+boolean InputLog::Save(const char *name)
+{
+    // The ring is written as is, in two parts once it has wrapped. Inputs
+    // arriving during the write can replace the oldest records.
+    uint16_t count = GetCount();
+    uint16_t first = (count < INPUT_LOG_SIZE) ? 0 : _head;
+    uint16_t firstCount = count - first;
+
+    if(!HalFileWrite(name, (const uint8_t *)&_records[first], firstCount * sizeof(InputRecord)))
+        return false;
+
+    return (first == 0 || HalFileAppend(name, (const uint8_t *)_records, first * sizeof(InputRecord)));
+}
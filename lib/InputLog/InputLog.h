@@ -0,0 +1,41 @@
+#pragma once
+#include <Hal.h>
+
+// Ring of the last decoded inputs, stamped with the uptime and the RTC time.
+// Safe to record from interrupts. The records are also the layout of the
+// exported log file, oldest first.
+
+#define INPUT_LOG_SIZE 64
+
+enum inputEventType
+{
+    INPUT_ENCODER,
+    INPUT_CLICK,
+    INPUT_DOUBLE_CLICK,
+    INPUT_LONG_PRESS_START,
+    INPUT_LONG_PRESS_STOP
+};
+
+struct InputRecord
+{
+    uint32_t millis;
+    uint32_t unixTime;
+    uint8_t type;
+    int8_t value;
+    uint16_t reserved;
+};
+
+class InputLog
+{
+private:
+    InputRecord _records[INPUT_LOG_SIZE];
+    volatile uint16_t _head = 0;
+    volatile uint32_t _total = 0;
+
+public:
+    void Record(uint8_t type, int8_t value, uint32_t unixTime);
+    void Clear();
+    uint16_t GetCount();
+    uint32_t GetDropped();
+    boolean Save(const char *name);
+};
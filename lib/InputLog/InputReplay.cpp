@@ -0,0 +1,120 @@
+#if !defined(ARDUINO)
+#include "InputReplay.h"
+
+static RotaryEncoder *replayEncoder = nullptr;
+static OneButton *replayButton = nullptr;
+
+RotaryEncoder::RotaryEncoder(int pin1, int pin2, LatchMode mode)
+{
+    replayEncoder = this;
+}
+
+void RotaryEncoder::tick()
+{
+}
+
+long RotaryEncoder::getPosition()
+{
+    return _position;
+}
+
+RotaryEncoder::Direction RotaryEncoder::getDirection()
+{
+    Direction direction = Direction::NOROTATION;
+    if(_position > _positionPrev)
+    {
+        direction = Direction::CLOCKWISE;
+    }
+    else if(_position < _positionPrev)
+    {
+        direction = Direction::COUNTERCLOCKWISE;
+    }
+
+    _positionPrev = _position;
+    return direction;
+}
+
+void RotaryEncoder::setPosition(long newPosition)
+{
+    _position = newPosition;
+    _positionPrev = newPosition;
+}
+
+void RotaryEncoder::Feed(int8_t steps)
+{
+    _position += steps;
+}
+
+OneButton::OneButton(int pin, bool activeLow, bool pullupActive)
+{
+    replayButton = this;
+}
+
+void OneButton::attachClick(void (*callback)())
+{
+    _clickFunc = callback;
+}
+
+void OneButton::attachDoubleClick(void (*callback)())
+{
+    _doubleClickFunc = callback;
+}
+
+void OneButton::attachLongPressStart(void (*callback)())
+{
+    _longPressStartFunc = callback;
+}
+
+void OneButton::attachLongPressStop(void (*callback)())
+{
+    _longPressStopFunc = callback;
+}
+
+void OneButton::tick()
+{
+    while(_count > 0)
+    {
+        uint8_t type = _pending[_head];
+        _head = (_head + 1) % INPUT_REPLAY_QUEUE;
+        _count--;
+
+        void (*callback)() = nullptr;
+        switch (type)
+        {
+            case INPUT_CLICK: callback = _clickFunc; break;
+            case INPUT_DOUBLE_CLICK: callback = _doubleClickFunc; break;
+            case INPUT_LONG_PRESS_START: callback = _longPressStartFunc; break;
+            case INPUT_LONG_PRESS_STOP: callback = _longPressStopFunc; break;
+        }
+
+        if(callback != nullptr)
+        {
+            callback();
+        }
+    }
+}
+
+void OneButton::Feed(uint8_t type)
+{
+    if(_count >= INPUT_REPLAY_QUEUE)
+        return;
+
+    _pending[(_head + _count) % INPUT_REPLAY_QUEUE] = type;
+    _count++;
+}
+
+void ReplayInput(const InputRecord &record)
+{
+    if(record.type == INPUT_ENCODER)
+    {
+        if(replayEncoder != nullptr)
+        {
+            replayEncoder->Feed(record.value);
+        }
+    }
+    else if(replayButton != nullptr)
+    {
+        replayButton->Feed(record.type);
+    }
+}
+#endif
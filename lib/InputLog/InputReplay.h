@@ -0,0 +1,62 @@
+#pragma once
+#include "InputLog.h"
+
+// Host stand-ins for the OneButton and RotaryEncoder libraries, driven by
+// ReplayInput() instead of the pins. Button callbacks fire from tick() like
+// in the real library, so the menus see each event at the same point.
+
+#if !defined(ARDUINO)
+#define INPUT_REPLAY_QUEUE 16
+
+class RotaryEncoder
+{
+private:
+    volatile long _position = 0;
+    long _positionPrev = 0;
+
+public:
+    enum class Direction
+    {
+        NOROTATION = 0,
+        CLOCKWISE = 1,
+        COUNTERCLOCKWISE = -1
+    };
+
+    enum class LatchMode
+    {
+        FOUR3 = 1,
+        FOUR0 = 2,
+        TWO03 = 3
+    };
+
+    RotaryEncoder(int pin1, int pin2, LatchMode mode = LatchMode::FOUR0);
+    void tick();
+    long getPosition();
+    Direction getDirection();
+    void setPosition(long newPosition);
+    void Feed(int8_t steps);
+};
+
+class OneButton
+{
+private:
+    void (*_clickFunc)() = nullptr;
+    void (*_doubleClickFunc)() = nullptr;
+    void (*_longPressStartFunc)() = nullptr;
+    void (*_longPressStopFunc)() = nullptr;
+    uint8_t _pending[INPUT_REPLAY_QUEUE];
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+
+public:
+    OneButton(int pin, bool activeLow = true, bool pullupActive = true);
+    void attachClick(void (*callback)());
+    void attachDoubleClick(void (*callback)());
+    void attachLongPressStart(void (*callback)());
+    void attachLongPressStop(void (*callback)());
+    void tick();
+    void Feed(uint8_t type);
+};
+
+void ReplayInput(const InputRecord &record);
+#endif
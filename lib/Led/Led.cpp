@@ -1,97 +1,151 @@
 #include "Led.h"
 
-Led::Led(int pin)
+Led::Led(int pin, const uint16_t *curve)
 {
-    _pin = pin;
-    pinMode(_pin, OUTPUT);
+    _curve = curve;
+    HalPinMode(pin, OUTPUT);
+    _pwm = HalPwmAttach(pin);
+    Disable();
+}
+
+// Writes land in the board's shadow, the owner flushes it once per frame
+Led::Led(Pca9685 *expander, uint8_t channel, const uint16_t *curve)
+{
+    _curve = curve;
+    _expander = expander;
+    _expanderChannel = channel;
+    _pwm = {0, nullptr};
     Disable();
 }
 
 void Led::Tick()
 {
-    if(_start)
+    if(_isDmaRamp)
+    {
+        _currentAnalog = _dma->GetCurrentAnalog();
+        _currentDuty = _currentAnalog * 100 / HAL_PWM_MAX;
+        if(_dma->IsRunning())
+            return;
+
+        _isDmaRamp = false;
+        _currentAnalog = _rampTo;
+        _isEnable = _start;
+        _start = false;
+        _stop = false;
+        return;
+    }
+
+    if(!_start && !_stop)
+        return;
+
+    uint32_t elapsed = HalMillis() - _rampStartMillis;
+    int analog = _rampTo;
+    if(elapsed < _rampMillis)
     {
-        if(millis() - _prevMillis >= _everyMillisStart)
-        {
-            _currentAnalog++;
-            if(_currentAnalog > _duty)
-            {
-                _isEnable = true;
-                _start = false;
-                _prevMillis = 0;
-                return;
-            }
-
-            analogWrite(_pin, _currentAnalog);
-            _currentDuty = (uint8_t)(_currentAnalog / 40.95F);
-            _prevMillis = millis();
-        }
+        uint32_t step = (uint32_t)abs(_rampTo - _rampFrom) * (elapsed >> _rampShift) / (_rampMillis >> _rampShift);
+        analog = (_rampTo >= _rampFrom) ? _rampFrom + (int)step : _rampFrom - (int)step;
     }
-    else if (_stop)
+    else
     {
-        if(millis() - _prevMillis >= _everyMillisStop)
-        {
-            _currentAnalog--;
-            if(_currentAnalog < 0)
-            {
-                _isEnable = false;
-                _stop = false;
-                _prevMillis = 0;
-                return;
-            }
-
-            analogWrite(_pin, _currentAnalog);
-            _currentDuty = (uint8_t)(_currentAnalog / 40.95F);
-            _prevMillis = millis();
-        }
+        _isEnable = _start;
+        _start = false;
+        _stop = false;
     }
+
+    if(analog == _currentAnalog)
+        return;
+
+    _currentAnalog = analog;
+    Write(_currentAnalog);
+    _currentDuty = _currentAnalog * 100 / HAL_PWM_MAX;
+}
+
+void Led::SetDma(LedDma *dma)
+{
+    _dma = dma;
+    _dma->SetCurve(_curve);
+}
+
+// Takes over from the DMA ramps, both write the same compare registers
+void Led::SetDither(LedDither *dither, uint8_t channel)
+{
+    _dither = dither;
+    _ditherChannel = channel;
 }
 
 void Led::SetParameters(int duty, int rampUp, int rampDown)
 {
-    _duty = (int)(40.95F * duty);
+    _duty = duty * HAL_PWM_MAX / 100;
     _rampUp = rampUp * 60;
     _rampDown = rampDown * 60;
-
-    _everyMillisStart = ((float)_rampUp / _duty) * 1000;
-    _everyMillisStop = ((float)_rampDown / _duty) * 1000;
 }
 
 void Led::Enable()
 {
     _isEnable = true;
-    for(_currentAnalog = 0; _currentAnalog <= _duty;)
-    {
-        if(millis() - _prevMillis >= 5)
-        {
-            _currentAnalog++;
-            if(_currentAnalog > _duty)
-            {
-                _prevMillis = 0;
-                return;
-            }
-
-            analogWrite(_pin, _currentAnalog);
-            _currentDuty = (uint8_t)(_currentAnalog / 40.95F);
-            _prevMillis = millis();
-        }
-    }
+    Ramp(true, _currentAnalog, _duty, 5UL * abs(_duty - _currentAnalog));
 }
 
 void Led::Disable()
 {
+    StopDma();
     _isEnable = false;
-    analogWrite(_pin, 0);
+    _start = false;
+    _stop = false;
+    _currentAnalog = 0;
+    _currentDuty = 0;
+    Write(0);
 }
 
 void Led::Start()
 {
-    _start = true;
+    Ramp(true, _currentAnalog, _duty, GetRampMillis(_rampUp, _currentAnalog, _duty), 0, true);
 }
 
 void Led::Stop()
 {
-    _stop = true;
+    Ramp(false, _currentAnalog, 0, GetRampMillis(_rampDown, _currentAnalog, 0), 0, true);
+}
+
+// The scheduled ramp as if it had begun elapsedSeconds ago, at the level it
+// would have reached by now. Used after a reboot or a clock change
+void Led::Resume(boolean isUp, uint32_t elapsedSeconds)
+{
+    if(isUp)
+    {
+        _isEnable = true;
+        Ramp(true, 0, _duty, GetRampMillis(_rampUp, 0, _duty), elapsedSeconds * 1000UL, true);
+    }
+    else
+    {
+        Ramp(false, _duty, 0, GetRampMillis(_rampDown, _duty, 0), elapsedSeconds * 1000UL, true);
+    }
+}
+
+// Profile mode, the level comes from outside every tick. It is also what
+// Enable() and Manual() fade to, and it waits while the LED is off or fading
+void Led::SetLevel(int analog)
+{
+    _duty = analog;
+    if(!_isEnable || _start || _stop || _isDmaRamp || analog == _currentAnalog)
+        return;
+
+    _currentAnalog = analog;
+    Write(_currentAnalog);
+    _currentDuty = _currentAnalog * 100 / HAL_PWM_MAX;
+}
+
+// Weather on top of whatever the level is doing, a Q12 scale and a floor for
+// lightning. A DMA ramp cannot follow it, its rest runs from Tick()
+void Led::SetEffect(uint16_t scale, int flash)
+{
+    if(scale == _effectScale && flash == _effectFlash)
+        return;
+
+    _effectScale = scale;
+    _effectFlash = flash;
+    StopDma();
+    Write(_currentAnalog);
 }
 
 void Led::UpdateDuty(int duty)
@@ -99,10 +153,11 @@ void Led::UpdateDuty(int duty)
     if(!_isEnable)
         return; 
 
-    _duty = (int)(40.95F * duty);
+    StopDma();
+    _duty = duty * HAL_PWM_MAX / 100;
     _currentAnalog = _duty;
     _currentDuty = duty;
-    analogWrite(_pin, _duty);
+    Write(_duty);
 }
 
 void Led::Manual()
@@ -110,25 +165,11 @@ void Led::Manual()
     if(!_isEnable)
     {
         _isEnable = true;
-        for(int i = 0; i <= _duty; i++)
-        {
-            _currentAnalog = i;
-            analogWrite(_pin, _currentAnalog);
-            _currentDuty = (uint8_t)(_currentAnalog / 40.95F);
-            delay(1);
-        }
+        Ramp(true, _currentAnalog, _duty, 1UL * abs(_duty - _currentAnalog));
     }
     else
     {
-        for(int i = _duty; i >= 0; i--)
-        {
-            _currentAnalog = i;
-            analogWrite(_pin, _currentAnalog);
-            _currentDuty = (uint8_t)(_currentAnalog / 40.95F);
-            delay(2);
-        }
-
-        _isEnable = false;
+        Ramp(false, _currentAnalog, 0, 2UL * _currentAnalog);
     }
 }
 
@@ -137,7 +178,71 @@ boolean Led::IsEnable()
     return _isEnable;
 }
 
+boolean Led::IsRamping()
+{
+    return _start || _stop || _isDmaRamp;
+}
+
 uint8_t Led::GetCurrentDuty()
 {
     return _currentDuty;
-}
\ No newline at end of file
+}
+
+void Led::Ramp(bool up, int from, int to, uint32_t rampMillis, uint32_t elapsedMillis, bool isScheduled)
+{
+    StopDma();
+    _start = up;
+    _stop = !up;
+    _rampFrom = from;
+    _rampTo = to;
+    _rampMillis = (rampMillis > 0) ? rampMillis : 1;
+    if(elapsedMillis > _rampMillis)
+        elapsedMillis = _rampMillis;
+
+    _rampStartMillis = HalMillis() - elapsedMillis;
+    _rampShift = 0;
+    while((_rampMillis >> _rampShift) >= (1UL << LED_RAMP_SPAN_BITS))
+    {
+        _rampShift++;
+    }
+
+    if(isScheduled && _dma != nullptr && _effectScale == LED_EFFECT_ONE && _effectFlash == 0 && elapsedMillis < _rampMillis)
+    {
+        // The stream continues from the level reached so far
+        Tick();
+        _isDmaRamp = _dma->Start(_currentAnalog, to, _rampMillis - elapsedMillis);
+    }
+}
+
+// Full scale, 0 to the duty, takes rampSeconds, a shorter distance its share of it
+uint32_t Led::GetRampMillis(int rampSeconds, int from, int to)
+{
+    if(_duty <= 0)
+        return 1;
+
+    return (uint32_t)((uint64_t)rampSeconds * 1000 * abs(to - from) / _duty);
+}
+
+void Led::Write(int analog)
+{
+    analog = (analog * _effectScale) >> LED_EFFECT_BITS;
+    if(_isEnable && analog < _effectFlash)
+        analog = _effectFlash;
+
+    if(_dither != nullptr)
+        _dither->Set(_ditherChannel, _curve[analog]);
+    else if(_expander != nullptr)
+        _expander->Set(_expanderChannel, LedCurve_Counts(_curve[analog]));
+    else
+        HalPwmSet(_pwm, LedCurve_Counts(_curve[analog]));
+}
+
+void Led::StopDma()
+{
+    if(!_isDmaRamp)
+        return;
+
+    _dma->Stop();
+    _currentAnalog = _dma->GetCurrentAnalog();
+    _isDmaRamp = false;
+}
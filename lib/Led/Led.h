@@ -1,9 +1,29 @@
-#include <Arduino.h>
+#pragma once
+#include <Hal.h>
+#include <LedDma.h>
+#include <LedCurve.h>
+#include <LedDither.h>
+#include <Pca9685.h>
+
+// Ramps are evaluated from the time since they began, so a late or missed
+// Tick() never shifts the end. Elapsed and ramp times are shifted down to
+// LED_RAMP_SPAN_BITS for the interpolation, the PWM range times that still
+// fits 32 bits. A 4 hour ramp resolves to 16 ms.
+//
+// Levels are perceived brightness, every PWM write goes through the
+// channel's LedCurve table. The output is a timer pin or a channel of a
+// Pca9685 board, ramps and the schedule work the same on both.
+#define LED_RAMP_SPAN_BITS 20
+
+// Effects scale the level in Q12 on its way to the curve
+#define LED_EFFECT_BITS    12
+#define LED_EFFECT_ONE     (1 << LED_EFFECT_BITS)
 
 class Led
 {
 private:
-    int _pin;
+    HalPwm _pwm;
+    const uint16_t *_curve;
     int _duty;
     uint8_t _currentDuty = 0;
     int _currentAnalog = 0;
@@ -12,20 +32,41 @@ private:
     bool _isEnable;
     bool _start = false;
     bool _stop = false;
-    unsigned long _everyMillisStart;
-    unsigned long _everyMillisStop;
-    unsigned long _prevMillis = 0;
-    
+    int _rampFrom = 0;
+    int _rampTo = 0;
+    uint32_t _rampStartMillis = 0;
+    uint32_t _rampMillis = 1;
+    uint8_t _rampShift = 0;
+    LedDma *_dma = nullptr;
+    bool _isDmaRamp = false;
+    LedDither *_dither = nullptr;
+    uint8_t _ditherChannel = 0;
+    Pca9685 *_expander = nullptr;
+    uint8_t _expanderChannel = 0;
+    uint16_t _effectScale = LED_EFFECT_ONE;
+    int _effectFlash = 0;
+    void Ramp(bool up, int from, int to, uint32_t rampMillis, uint32_t elapsedMillis = 0, bool isScheduled = false);
+    uint32_t GetRampMillis(int rampSeconds, int from, int to);
+    void StopDma();
+    void Write(int analog);
+
 public:
-    Led(int pin);
+    Led(int pin, const uint16_t *curve = LedCurve<>::Get());
+    Led(Pca9685 *expander, uint8_t channel, const uint16_t *curve = LedCurve<>::Get());
     void Tick();
+    void SetDma(LedDma *dma);
+    void SetDither(LedDither *dither, uint8_t channel);
     void SetParameters(int duty, int rampUp, int rampDown);
     void Enable();
     void Disable();
     void Start();
     void Stop();
+    void Resume(boolean isUp, uint32_t elapsedSeconds);
+    void SetLevel(int analog);
+    void SetEffect(uint16_t scale, int flash);
     void UpdateDuty(int duty);
     void Manual();
     boolean IsEnable();
+    boolean IsRamping();
     uint8_t GetCurrentDuty();
 };
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+#include <Hal.h>
+
+// Perceived brightness to PWM duty. Led levels and ramps move in even steps
+// of brightness, 0..HAL_PWM_MAX, and the table gives the duty that looks
+// like that step to the eye: CIE 1931 lightness by default, or a power curve
+// with the gamma in hundredths (220 is 2.2). The compiler builds the tables
+// into flash, only the curves that are used are linked, and a lookup is one
+// halfword load.
+//
+// Entries are duty in 1/16 PWM counts. LedDither spreads the fraction over
+// PWM periods, without it LedCurve_Counts() rounds to whole counts.
+#define LED_CURVE_SIZE            (HAL_PWM_MAX + 1)
+#define LED_CURVE_CIE             0
+#define LED_CURVE_FRACTION_BITS   4
+#define LED_CURVE_ONE             (1 << LED_CURVE_FRACTION_BITS)
+
+// Curve of each channel, can be set from build_flags, e.g. -DLED_COLOR_GAMMA=220
+#ifndef LED_WHITE_GAMMA
+#define LED_WHITE_GAMMA LED_CURVE_CIE
+#endif
+
+#ifndef LED_COLOR_GAMMA
+#define LED_COLOR_GAMMA LED_CURVE_CIE
+#endif
+
+template <uint16_t Gamma>
+struct LedCurveTable
+{
+    uint16_t duty[LED_CURVE_SIZE];
+
+    constexpr LedCurveTable() : duty()
+    {
+        for(uint32_t i = 0; i < LED_CURVE_SIZE; i++)
+        {
+            duty[i] = (uint16_t)(Luminance((double)i / HAL_PWM_MAX) * HAL_PWM_MAX * LED_CURVE_ONE + 0.5);
+        }
+    }
+
+    // Relative luminance 0..1 of a brightness 0..1
+    static constexpr double Luminance(double brightness)
+    {
+        return (Gamma == LED_CURVE_CIE) ? Lightness(brightness * 100) : Power(brightness, Gamma / 100.0);
+    }
+
+    // Inverse of L*, linear below 8 and a cube above
+    static constexpr double Lightness(double lightness)
+    {
+        return (lightness <= 8) ? lightness / 903.3 : ((lightness + 16) / 116) * ((lightness + 16) / 116) * ((lightness + 16) / 116);
+    }
+
+    static constexpr double Power(double x, double y)
+    {
+        return (x <= 0) ? 0 : Exp(y * Log(x));
+    }
+
+    // ln x = k ln 2 + 2 atanh((m - 1) / (m + 1)) with m in [1, 2)
+    static constexpr double Log(double x)
+    {
+        int k = 0;
+        while(x < 1) {x *= 2; k--;}
+        while(x >= 2) {x /= 2; k++;}
+
+        double t = (x - 1) / (x + 1);
+        double term = t;
+        double sum = 0;
+        for(int n = 1; n < 40; n += 2)
+        {
+            sum += term / n;
+            term *= t * t;
+        }
+
+        return k * 0.693147180559945309 + 2 * sum;
+    }
+
+    // Only called with x <= 0, halved until the series converges and squared back
+    static constexpr double Exp(double x)
+    {
+        int halvings = 0;
+        while(x < -0.5) {x /= 2; halvings++;}
+
+        double term = 1;
+        double sum = 1;
+        for(int n = 1; n < 20; n++)
+        {
+            term *= x / n;
+            sum += term;
+        }
+
+        while(halvings-- > 0) {sum *= sum;}
+        return sum;
+    }
+};
+
+template <uint16_t Gamma = LED_CURVE_CIE>
+class LedCurve
+{
+private:
+    static constexpr LedCurveTable<Gamma> _table{};
+
+public:
+    static const uint16_t *Get() {return _table.duty;}
+};
+
+template <uint16_t Gamma>
+constexpr LedCurveTable<Gamma> LedCurve<Gamma>::_table;
+
+inline uint16_t LedCurve_Counts(uint16_t duty)
+{
+    return (duty + LED_CURVE_ONE / 2) >> LED_CURVE_FRACTION_BITS;
+}
@@ -0,0 +1,94 @@
+#include "LedDither.h"
+#include <Profiler.h>
+
+#if defined(STM32F1xx)
+static LedDither *ditherChannel5 = nullptr;
+
+// Channel 5 flags start at bit 16 of DMA1 ISR/IFCR
+#define LED_DITHER_FLAG_SHIFT 16
+#endif
+
+boolean LedDither::Begin()
+{
+#if defined(STM32F1xx)
+    ditherChannel5 = this;
+    Fill(0);
+    Fill(1);
+
+    RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+
+    // Burst of two transfers through DMAR, starting at CCR2
+    TIM1->DCR = TIM_DCR_DBL_0 | (uint32_t)(&TIM1->CCR2 - &TIM1->CR1);
+
+    DMA1_Channel5->CCR = 0;
+    DMA1_Channel5->CPAR = (uintptr_t)&TIM1->DMAR;
+    DMA1_Channel5->CMAR = (uintptr_t)_buffer;
+    DMA1_Channel5->CNDTR = LED_DITHER_HALF_SIZE * 2;
+    DMA1_Channel5->CCR = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_CIRC | DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0 | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_PL_1;
+    DMA1_Channel5->CCR |= DMA_CCR_EN;
+
+    NVIC_SetPriority(DMA1_Channel5_IRQn, 6);
+    NVIC_EnableIRQ(DMA1_Channel5_IRQn);
+    TIM1->DIER |= TIM_DIER_UDE;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Duty in 1/16 counts, picked up by the next buffer half
+void LedDither::Set(uint8_t channel, uint16_t level)
+{
+    _level[channel] = level;
+}
+
+void LedDither::HandleIrq()
+{
+#if defined(STM32F1xx)
+    PROFILER.Start(PROFILE_DITHER);
+    uint32_t flags = DMA1->ISR >> LED_DITHER_FLAG_SHIFT;
+
+    if(flags & DMA_ISR_HTIF1)
+    {
+        DMA1->IFCR = (DMA_IFCR_CHTIF1 << LED_DITHER_FLAG_SHIFT);
+        Fill(0);
+    }
+
+    if(flags & DMA_ISR_TCIF1)
+    {
+        DMA1->IFCR = (DMA_IFCR_CTCIF1 << LED_DITHER_FLAG_SHIFT);
+        Fill(1);
+    }
+
+    PROFILER.Stop(PROFILE_DITHER);
+#endif
+}
+
+void LedDither::Fill(uint8_t half)
+{
+    uint16_t *sample = &_buffer[half * LED_DITHER_HALF_SIZE];
+
+    for(uint8_t channel = 0; channel < LED_DITHER_CHANNELS; channel++)
+    {
+        uint32_t level = _level[channel];
+        uint32_t error = _error[channel];
+
+        for(uint8_t i = channel; i < LED_DITHER_HALF_SIZE; i += LED_DITHER_CHANNELS)
+        {
+            error += level;
+            sample[i] = (uint16_t)(error >> LED_CURVE_FRACTION_BITS);
+            error &= LED_CURVE_ONE - 1;
+        }
+
+        _error[channel] = (uint16_t)error;
+    }
+}
+
+#if defined(STM32F1xx)
+extern "C" void DMA1_Channel5_IRQHandler(void)
+{
+    if(ditherChannel5 != nullptr)
+        ditherChannel5->HandleIrq();
+}
+#endif
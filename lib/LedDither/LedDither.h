@@ -0,0 +1,43 @@
+#pragma once
+#include <Hal.h>
+#include <LedCurve.h>
+
+// First order sigma-delta on the LED compare registers. Each PWM period
+// outputs the whole counts of level + carried error and keeps the fraction,
+// so over 16 periods the average duty has the 1/16 count resolution of the
+// LedCurve tables: 16 bit brightness, and levels below one count for
+// moonlight.
+//
+// TIM1 update events request DMA1 channel 5, which writes CCR2 (white) and
+// CCR3 (color) in one burst from a circular buffer. The accumulators run in
+// its half and full transfer interrupt, LED_DITHER_PERIODS periods for both
+// channels at a time, so the cost is fixed whatever the levels are. It shows
+// as the "Dth" section of the profiler.
+//
+// The core owns the TIM1 interrupt handlers, hence the DMA interrupt as the
+// timer tick. Optional, set LED_DITHER to 1 in build_flags to use it in
+// place of the LedDma ramps, which need the same compare registers.
+
+#ifndef LED_DITHER
+#define LED_DITHER 0
+#endif
+
+#define LED_DITHER_WHITE     0
+#define LED_DITHER_COLOR     1
+#define LED_DITHER_CHANNELS  2
+#define LED_DITHER_PERIODS   16
+#define LED_DITHER_HALF_SIZE (LED_DITHER_PERIODS * LED_DITHER_CHANNELS)
+
+class LedDither
+{
+private:
+    uint16_t _buffer[LED_DITHER_HALF_SIZE * 2];
+    volatile uint16_t _level[LED_DITHER_CHANNELS] = {};
+    uint16_t _error[LED_DITHER_CHANNELS] = {};
+    void Fill(uint8_t half);
+
+public:
+    boolean Begin();
+    void Set(uint8_t channel, uint16_t level);
+    void HandleIrq();
+};
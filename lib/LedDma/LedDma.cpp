@@ -0,0 +1,225 @@
+#include "LedDma.h"
+
+// PA9/PA10 are TIM1_CH2/TIM1_CH3. TIM3 is taken by tone() and TIM2 by the
+// pumps, so TIM4 paces both streams: its CC1 and CC2 events request DMA1
+// channel 1 (white) and channel 4 (color) once per LED_DMA_SAMPLE_MS.
+
+#if defined(STM32F1xx)
+static LedDma *dmaChannel1 = nullptr;
+static LedDma *dmaChannel4 = nullptr;
+static uint8_t runningCount = 0;
+#endif
+
+LedDma::LedDma(uint32_t pin)
+{
+    _pin = pin;
+}
+
+boolean LedDma::Begin()
+{
+#if defined(STM32F1xx)
+    if(_pin == PA9)
+    {
+        _channel = DMA1_Channel1;
+        _ccr = &TIM1->CCR2;
+        _flagShift = 0;
+        _irq = DMA1_Channel1_IRQn;
+        dmaChannel1 = this;
+    }
+    else if(_pin == PA10)
+    {
+        _channel = DMA1_Channel4;
+        _ccr = &TIM1->CCR3;
+        _flagShift = 12;
+        _irq = DMA1_Channel4_IRQn;
+        dmaChannel4 = this;
+    }
+    else
+    {
+        return false;
+    }
+
+    RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+    RCC->APB1ENR |= RCC_APB1ENR_TIM4EN;
+
+    TIM4->PSC = (SystemCoreClock / 10000) - 1;
+    TIM4->ARR = (LED_DMA_SAMPLE_MS * 10) - 1;
+    TIM4->CCR1 = 0;
+    TIM4->CCR2 = 0;
+    TIM4->DIER |= (_pin == PA9) ? TIM_DIER_CC1DE : TIM_DIER_CC2DE;
+    TIM4->EGR = TIM_EGR_UG;
+
+    NVIC_SetPriority(_irq, 6);
+    NVIC_EnableIRQ(_irq);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Ramps are streamed in brightness steps, each sample is the curve's duty
+void LedDma::SetCurve(const uint16_t *curve)
+{
+    _curve = curve;
+}
+
+boolean LedDma::Start(int from, int to, unsigned long rampMillis)
+{
+#if defined(STM32F1xx)
+    if(_channel == nullptr)
+        return false;
+
+    Stop();
+
+    uint32_t delta = abs(to - from);
+    _value = from;
+    _to = to;
+    _dir = (to >= from) ? 1 : -1;
+    _rampMillis = (rampMillis > 0) ? rampMillis : 1;
+    _stepWhole = (delta * LED_DMA_SAMPLE_MS) / _rampMillis;
+    _stepFrac = (delta * LED_DMA_SAMPLE_MS) % _rampMillis;
+    _acc = 0;
+    _scale = TIM1->ARR + 1;
+    _filledSamples = 0;
+    _outputSamples = 0;
+    _isFinal = false;
+
+    Fill(0);
+    Fill(1);
+
+    _channel->CPAR = (uintptr_t)_ccr;
+    _channel->CMAR = (uintptr_t)_buffer;
+    _channel->CNDTR = LED_DMA_HALF_SIZE * 2;
+    _channel->CCR = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_CIRC | DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0 | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_PL_1;
+    _channel->CCR |= DMA_CCR_EN;
+
+    _isRunning = true;
+    if(runningCount++ == 0)
+    {
+        TIM4->CNT = 0;
+        TIM4->CR1 |= TIM_CR1_CEN;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void LedDma::Stop()
+{
+#if defined(STM32F1xx)
+    noInterrupts();
+    if(_isRunning)
+    {
+        _channel->CCR &= ~DMA_CCR_EN;
+        DMA1->IFCR = (0x0FUL << _flagShift);
+        _isRunning = false;
+
+        if(--runningCount == 0)
+        {
+            TIM4->CR1 &= ~TIM_CR1_CEN;
+        }
+    }
+    interrupts();
+#endif
+}
+
+boolean LedDma::IsRunning()
+{
+    return _isRunning;
+}
+
+int LedDma::GetCurrentAnalog()
+{
+#if defined(STM32F1xx)
+    if(_channel == nullptr)
+        return 0;
+
+    // Lowest brightness with the duty on the pin, the curve never falls
+    uint32_t duty = ((*_ccr << 12) + _scale - 1) / _scale;
+    int low = 0;
+    int high = HAL_PWM_MAX;
+    while(low < high)
+    {
+        int middle = (low + high) / 2;
+        if(LedCurve_Counts(_curve[middle]) < duty)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+#else
+    return 0;
+#endif
+}
+
+void LedDma::HandleIrq()
+{
+#if defined(STM32F1xx)
+    uint32_t flags = DMA1->ISR >> _flagShift;
+
+    if(flags & DMA_ISR_HTIF1)
+    {
+        DMA1->IFCR = (DMA_IFCR_CHTIF1 << _flagShift);
+        _outputSamples += LED_DMA_HALF_SIZE;
+        Fill(0);
+    }
+
+    if(flags & DMA_ISR_TCIF1)
+    {
+        DMA1->IFCR = (DMA_IFCR_CTCIF1 << _flagShift);
+        _outputSamples += LED_DMA_HALF_SIZE;
+        Fill(1);
+    }
+
+    if(_isFinal && _outputSamples > _finalSample)
+    {
+        Stop();
+    }
+#endif
+}
+
+void LedDma::Fill(uint8_t half)
+{
+    uint16_t *sample = &_buffer[half * LED_DMA_HALF_SIZE];
+
+    for(uint8_t i = 0; i < LED_DMA_HALF_SIZE; i++)
+    {
+        if(!_isFinal)
+        {
+            _value += _dir * (int)_stepWhole;
+            _acc += _stepFrac;
+            if(_acc >= _rampMillis)
+            {
+                _acc -= _rampMillis;
+                _value += _dir;
+            }
+
+            if((_dir > 0 && _value >= _to) || (_dir < 0 && _value <= _to))
+            {
+                _value = _to;
+                _isFinal = true;
+                _finalSample = _filledSamples;
+            }
+        }
+
+        sample[i] = (uint16_t)(((uint32_t)LedCurve_Counts(_curve[_value]) * _scale) >> 12);
+        _filledSamples++;
+    }
+}
+
+#if defined(STM32F1xx)
+extern "C" void DMA1_Channel1_IRQHandler(void)
+{
+    if(dmaChannel1 != nullptr)
+        dmaChannel1->HandleIrq();
+}
+
+extern "C" void DMA1_Channel4_IRQHandler(void)
+{
+    if(dmaChannel4 != nullptr)
+        dmaChannel4->HandleIrq();
+}
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+#include <Hal.h>
+#include <LedCurve.h>
+
+#define LED_DMA_SAMPLE_MS 20
+#define LED_DMA_HALF_SIZE 32
+
+class LedDma
+{
+private:
+    uint32_t _pin;
+    const uint16_t *_curve = LedCurve<>::Get();
+    uint16_t _buffer[LED_DMA_HALF_SIZE * 2];
+    volatile bool _isRunning = false;
+    int _value;
+    int _to;
+    int _dir;
+    uint32_t _rampMillis;
+    uint32_t _stepWhole;
+    uint32_t _stepFrac;
+    uint32_t _acc;
+    uint32_t _scale;
+    uint32_t _filledSamples;
+    uint32_t _finalSample;
+    bool _isFinal;
+    volatile uint32_t _outputSamples;
+#if defined(STM32F1xx)
+    DMA_Channel_TypeDef *_channel = nullptr;
+    volatile uint32_t *_ccr;
+    uint8_t _flagShift;
+    IRQn_Type _irq;
+#endif
+    void Fill(uint8_t half);
+
+public:
+    LedDma(uint32_t pin);
+    boolean Begin();
+    void SetCurve(const uint16_t *curve);
+    boolean Start(int from, int to, unsigned long rampMillis);
+    void Stop();
+    boolean IsRunning();
+    int GetCurrentAnalog();
+    void HandleIrq();
+};
@@ -0,0 +1,128 @@
+#include "LightProfile.h"
+
+void LightProfile::Clear()
+{
+    _count = 0;
+    _segmentLength = 0;
+}
+
+// Unused words are skipped, levels are kept as 12 bit duty
+boolean LightProfile::Add(uint32_t word)
+{
+    uint8_t hour, minute, level, easing;
+    if(_count >= LIGHT_PROFILE_MAX_FRAMES || !Unpack(word, &hour, &minute, &level, &easing))
+        return false;
+
+    _frames[_count].millis = ((uint32_t)hour * 60 + minute) * 60000UL;
+    _frames[_count].level = (uint16_t)level * HAL_PWM_MAX / 100;
+    _frames[_count].easing = easing;
+    _count++;
+    _segmentLength = 0;
+    return true;
+}
+
+void LightProfile::Build()
+{
+    // Insertion sort, frames of the same minute stay in the order they were added
+    for(uint8_t i = 1; i < _count; i++)
+    {
+        LightKeyframe frame = _frames[i];
+        int8_t j = i - 1;
+
+        while(j >= 0 && _frames[j].millis > frame.millis)
+        {
+            _frames[j + 1] = _frames[j];
+            j--;
+        }
+
+        _frames[j + 1] = frame;
+    }
+
+    _segmentLength = 0;
+}
+
+boolean LightProfile::IsActive()
+{
+    return _count > 0;
+}
+
+uint16_t LightProfile::GetLevel(uint32_t millisOfDay)
+{
+    if(_count == 0)
+        return 0;
+
+    uint32_t elapsed = (millisOfDay >= _segmentStart) ? millisOfDay - _segmentStart : millisOfDay + LIGHT_PROFILE_DAY_MS - _segmentStart;
+    if(elapsed >= _segmentLength)
+    {
+        SetSegment(Find(millisOfDay));
+        elapsed = (millisOfDay >= _segmentStart) ? millisOfDay - _segmentStart : millisOfDay + LIGHT_PROFILE_DAY_MS - _segmentStart;
+    }
+
+    const LightKeyframe &from = _frames[_segment];
+    const LightKeyframe &to = _frames[(_segment + 1) % _count];
+    if(from.easing == EASING_STEP)
+        return from.level;
+
+    int32_t fraction = ((elapsed >> _segmentShift) << LIGHT_PROFILE_FRACTION_BITS) / (_segmentLength >> _segmentShift);
+    if(from.easing == EASING_SMOOTH)
+    {
+        // Smoothstep 3f^2 - 2f^3, flat at both frames
+        int32_t square = (fraction * fraction) >> LIGHT_PROFILE_FRACTION_BITS;
+        fraction = (square * ((3 << LIGHT_PROFILE_FRACTION_BITS) - 2 * fraction)) >> LIGHT_PROFILE_FRACTION_BITS;
+    }
+
+    return from.level + (((int32_t)to.level - from.level) * fraction) / (1 << LIGHT_PROFILE_FRACTION_BITS);
+}
+
+// Last frame at or before the time, before the first frame it is the last one of the previous day
+uint8_t LightProfile::Find(uint32_t millisOfDay)
+{
+    uint8_t low = 0;
+    uint8_t high = _count;
+
+    while(low < high)
+    {
+        uint8_t middle = (low + high) / 2;
+        if(_frames[middle].millis <= millisOfDay)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return (low > 0) ? low - 1 : _count - 1;
+}
+
+void LightProfile::SetSegment(uint8_t index)
+{
+    uint32_t start = _frames[index].millis;
+    uint32_t end = _frames[(index + 1) % _count].millis;
+
+    _segment = index;
+    _segmentStart = start;
+    _segmentLength = (end > start) ? end - start : end + LIGHT_PROFILE_DAY_MS - start;
+    _segmentShift = 0;
+    while((_segmentLength >> _segmentShift) >= (1UL << LIGHT_PROFILE_SPAN_BITS))
+    {
+        _segmentShift++;
+    }
+}
+
+uint32_t LightProfile::Pack(uint8_t hour, uint8_t minute, uint8_t level, uint8_t easing)
+{
+    uint32_t minuteOfDay = (uint32_t)(hour % 24) * 60 + minute % 60;
+    return LIGHT_FRAME_USED | minuteOfDay | ((uint32_t)(level > 100 ? 100 : level) << 11) | ((uint32_t)(easing % EASING_COUNT) << 18);
+}
+
+boolean LightProfile::Unpack(uint32_t word, uint8_t *hour, uint8_t *minute, uint8_t *level, uint8_t *easing)
+{
+    uint32_t minuteOfDay = (word & 0x7FF) % 1440;
+
+    *hour = minuteOfDay / 60;
+    *minute = minuteOfDay % 60;
+    *level = (word >> 11) & 0x7F;
+    *easing = ((word >> 18) & 0x03) % EASING_COUNT;
+    if(*level > 100)
+        *level = 100;
+
+    return (word & LIGHT_FRAME_USED) != 0;
+}
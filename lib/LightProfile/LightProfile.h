@@ -0,0 +1,58 @@
+#pragma once
+#include <Hal.h>
+
+// Daily light curve of one LED channel from up to 16 keyframes. Every frame
+// holds its level until the next one (step) or moves towards it (linear,
+// smooth); the last frame runs on into the first one of the next day.
+// GetLevel() keeps the segment it found last and only searches the sorted
+// table again once the time has left it, so a tick costs one compare and
+// one interpolation.
+
+#define LIGHT_PROFILE_MAX_FRAMES    16
+#define LIGHT_PROFILE_DAY_MS        86400000UL
+
+// Fractions of a segment are Q12, the segment length is shifted below
+// LIGHT_PROFILE_SPAN_BITS so the elapsed part still fits 32 bits after << 12
+#define LIGHT_PROFILE_FRACTION_BITS 12
+#define LIGHT_PROFILE_SPAN_BITS     19
+
+// Config word of a keyframe, 0 is an unused slot: bit 31 in use, minute of
+// the day in bits 0..10, level in percent in bits 11..17, easing in 18..19
+#define LIGHT_FRAME_USED            (1UL << 31)
+
+enum lightEasing
+{
+    EASING_STEP,
+    EASING_LINEAR,
+    EASING_SMOOTH,
+    EASING_COUNT
+};
+
+struct LightKeyframe
+{
+    uint32_t millis;
+    uint16_t level;
+    uint8_t easing;
+};
+
+class LightProfile
+{
+private:
+    LightKeyframe _frames[LIGHT_PROFILE_MAX_FRAMES];
+    uint8_t _count = 0;
+    uint8_t _segment = 0;
+    uint32_t _segmentStart = 0;
+    uint32_t _segmentLength = 0;
+    uint8_t _segmentShift = 0;
+    uint8_t Find(uint32_t millisOfDay);
+    void SetSegment(uint8_t index);
+
+public:
+    void Clear();
+    boolean Add(uint32_t word);
+    void Build();
+    boolean IsActive();
+    uint16_t GetLevel(uint32_t millisOfDay);
+    static uint32_t Pack(uint8_t hour, uint8_t minute, uint8_t level, uint8_t easing);
+    static boolean Unpack(uint32_t word, uint8_t *hour, uint8_t *minute, uint8_t *level, uint8_t *easing);
+};
@@ -0,0 +1,212 @@
+#include "MsgPack.h"
+
+MsgPackWriter::MsgPackWriter(uint8_t *buffer, size_t size)
+{
+    _buffer = buffer;
+    _size = size;
+}
+
+void MsgPackWriter::WriteMapHeader(uint16_t count)
+{
+    if(count < 16)
+    {
+        Put(0x80 | count);
+        return;
+    }
+
+    Put(0xDE);
+    PutBigEndian(count, 2);
+}
+
+void MsgPackWriter::WriteUint(uint32_t value)
+{
+    if(value < 128)
+    {
+        Put(value);
+    }
+    else if(value <= 0xFF)
+    {
+        Put(0xCC);
+        Put(value);
+    }
+    else if(value <= 0xFFFF)
+    {
+        Put(0xCD);
+        PutBigEndian(value, 2);
+    }
+    else
+    {
+        Put(0xCE);
+        PutBigEndian(value, 4);
+    }
+}
+
+void MsgPackWriter::WriteFloat(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    Put(0xCA);
+    PutBigEndian(bits, 4);
+}
+
+void MsgPackWriter::WriteBool(bool value)
+{
+    Put(value ? 0xC3 : 0xC2);
+}
+
+size_t MsgPackWriter::GetLength()
+{
+    return _length;
+}
+
+boolean MsgPackWriter::IsOverflow()
+{
+    return _isOverflow;
+}
+
+void MsgPackWriter::Put(uint8_t value)
+{
+    if(_length >= _size)
+    {
+        _isOverflow = true;
+        return;
+    }
+
+    _buffer[_length++] = value;
+}
+
+void MsgPackWriter::PutBigEndian(uint32_t value, uint8_t bytes)
+{
+    while(bytes > 0)
+    {
+        bytes--;
+        Put(value >> (bytes * 8));
+    }
+}
+
+MsgPackReader::MsgPackReader(const uint8_t *buffer, size_t length)
+{
+    _buffer = buffer;
+    _length = length;
+}
+
+boolean MsgPackReader::ReadMapHeader(uint16_t *count)
+{
+    uint8_t tag = Get();
+
+    if((tag & 0xF0) == 0x80)
+    {
+        *count = tag & 0x0F;
+    }
+    else if(tag == 0xDE)
+    {
+        *count = GetBigEndian(2);
+    }
+    else
+    {
+        _isError = true;
+    }
+
+    return !_isError;
+}
+
+boolean MsgPackReader::ReadValue(MsgPackValue *value)
+{
+    uint8_t tag = Get();
+    uint32_t bits;
+
+    value->type = MSGPACK_UINT;
+
+    if(tag < 0x80)
+    {
+        value->u = tag;
+    }
+    else if(tag >= 0xE0)
+    {
+        value->type = MSGPACK_INT;
+        value->i = (int8_t)tag;
+    }
+    else
+    {
+        switch (tag)
+        {
+        case 0xC0:
+            value->type = MSGPACK_NIL;
+            break;
+
+        case 0xC2:
+        case 0xC3:
+            value->type = MSGPACK_BOOL;
+            value->b = (tag == 0xC3);
+            break;
+
+        case 0xCC:
+            value->u = GetBigEndian(1);
+            break;
+
+        case 0xCD:
+            value->u = GetBigEndian(2);
+            break;
+
+        case 0xCE:
+            value->u = GetBigEndian(4);
+            break;
+
+        case 0xD0:
+            value->type = MSGPACK_INT;
+            value->i = (int8_t)GetBigEndian(1);
+            break;
+
+        case 0xD1:
+            value->type = MSGPACK_INT;
+            value->i = (int16_t)GetBigEndian(2);
+            break;
+
+        case 0xD2:
+            value->type = MSGPACK_INT;
+            value->i = (int32_t)GetBigEndian(4);
+            break;
+
+        case 0xCA:
+            value->type = MSGPACK_FLOAT;
+            bits = GetBigEndian(4);
+            memcpy(&value->f, &bits, sizeof(bits));
+            break;
+
+        default:
+            _isError = true;
+            break;
+        }
+    }
+
+    return !_isError;
+}
+
+boolean MsgPackReader::IsError()
+{
+    return _isError;
+}
+
+uint8_t MsgPackReader::Get()
+{
+    if(_position >= _length)
+    {
+        _isError = true;
+        return 0;
+    }
+
+    return _buffer[_position++];
+}
+
+uint32_t MsgPackReader::GetBigEndian(uint8_t bytes)
+{
+    uint32_t value = 0;
+
+    while(bytes > 0)
+    {
+        value = (value << 8) | Get();
+        bytes--;
+    }
+
+    return value;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <Hal.h>
+
+// Minimal MessagePack codec over a caller owned buffer. Only the types the
+// config needs are supported: maps, unsigned/signed integers, float and bool.
+
+enum msgPackType
+{
+    MSGPACK_NIL,
+    MSGPACK_BOOL,
+    MSGPACK_UINT,
+    MSGPACK_INT,
+    MSGPACK_FLOAT
+};
+
+struct MsgPackValue
+{
+    uint8_t type;
+    uint32_t u;
+    int32_t i;
+    float f;
+    bool b;
+};
+
+class MsgPackWriter
+{
+private:
+    uint8_t *_buffer;
+    size_t _size;
+    size_t _length = 0;
+    bool _isOverflow = false;
+    void Put(uint8_t value);
+    void PutBigEndian(uint32_t value, uint8_t bytes);
+
+public:
+    MsgPackWriter(uint8_t *buffer, size_t size);
+    void WriteMapHeader(uint16_t count);
+    void WriteUint(uint32_t value);
+    void WriteFloat(float value);
+    void WriteBool(bool value);
+    size_t GetLength();
+    boolean IsOverflow();
+};
+
+class MsgPackReader
+{
+private:
+    const uint8_t *_buffer;
+    size_t _length;
+    size_t _position = 0;
+    bool _isError = false;
+    uint8_t Get();
+    uint32_t GetBigEndian(uint8_t bytes);
+
+public:
+    MsgPackReader(const uint8_t *buffer, size_t length);
+    boolean ReadMapHeader(uint16_t *count);
+    boolean ReadValue(MsgPackValue *value);
+    boolean IsError();
+};
@@ -0,0 +1,66 @@
+#include "Pca9685.h"
+
+// False when the board does not answer, its channels are then never flushed
+boolean Pca9685::Begin(uint8_t address)
+{
+    _address = address;
+    uint8_t sleep = PCA9685_MODE1_SLEEP | PCA9685_MODE1_AI;
+    uint8_t prescale = PCA9685_PRESCALE;
+    uint8_t off = PCA9685_FULL;
+    uint8_t modes[2] = {PCA9685_MODE1_AI, PCA9685_MODE2_OUTDRV};
+
+    // The prescaler only takes a write while the oscillator sleeps
+    _isReady = HalExpanderWrite(_address, PCA9685_MODE1, &sleep, 1)
+            && HalExpanderWrite(_address, PCA9685_PRE_SCALE, &prescale, 1)
+            && HalExpanderWrite(_address, PCA9685_ALL_LED_OFF_H, &off, 1)
+            && HalExpanderWrite(_address, PCA9685_MODE1, modes, 2);
+
+    // The first flush writes the shadow whatever it holds
+    _dirty = (1UL << PCA9685_CHANNELS) - 1;
+    return _isReady;
+}
+
+// Duty in counts, 0..HAL_PWM_MAX
+void Pca9685::Set(uint8_t channel, uint16_t duty)
+{
+    if(_duty[channel] == duty)
+        return;
+
+    _duty[channel] = duty;
+    _dirty |= (1 << channel);
+}
+
+boolean Pca9685::IsDirty()
+{
+    return _isReady && _dirty != 0;
+}
+
+// Channels between two changed ones are sent again, four bytes each are
+// cheaper than a second START, address and register pointer
+boolean Pca9685::Flush()
+{
+    if(!IsDirty())
+        return false;
+
+    uint8_t first = 0;
+    while(!(_dirty & (1 << first))) {first++;}
+    uint8_t last = PCA9685_CHANNELS - 1;
+    while(!(_dirty & (1 << last))) {last--;}
+
+    // ON at count 0 and OFF at the duty, 0 as the full off bit
+    uint8_t data[PCA9685_CHANNELS * 4];
+    uint8_t *byte = data;
+    for(uint8_t i = first; i <= last; i++)
+    {
+        *byte++ = 0;
+        *byte++ = 0;
+        *byte++ = _duty[i] & 0xFF;
+        *byte++ = (_duty[i] == 0) ? PCA9685_FULL : (_duty[i] >> 8);
+    }
+
+    if(!HalExpanderPost(_address, PCA9685_LED0_ON_L + first * 4, data, byte - data))
+        return false;
+
+    _dirty = 0;
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <Hal.h>
+
+// PCA9685 16 channel, 12 bit PWM board on the I2C bus. Set() only changes a
+// shadow of the duties and marks the channel, Flush() sends the marked span
+// as one auto-increment write from the first to the last changed channel.
+// Flushed once per frame, any number of ramping channels cost one
+// transaction per board. The write is posted, the bus sends it in the
+// background between the LCD chunks.
+//
+// Boards take consecutive addresses from HAL_EXPANDER_ADDRESS. Set
+// PCA9685_BOARDS in build_flags to the number of boards fitted, their
+// channels follow the white and color schedules (see src/main.cpp).
+
+#ifndef PCA9685_BOARDS
+#define PCA9685_BOARDS 0
+#endif
+
+// Channels of each board on the color schedule, the others are white
+#ifndef PCA9685_COLOR_CHANNELS
+#define PCA9685_COLOR_CHANNELS 0xFF00
+#endif
+
+#define PCA9685_CHANNELS        16
+#define PCA9685_MODE1           0x00
+#define PCA9685_MODE2           0x01
+#define PCA9685_LED0_ON_L       0x06
+#define PCA9685_ALL_LED_OFF_H   0xFD
+#define PCA9685_PRE_SCALE       0xFE
+#define PCA9685_MODE1_SLEEP     0x10
+#define PCA9685_MODE1_AI        0x20
+#define PCA9685_MODE2_OUTDRV    0x04
+#define PCA9685_FULL            0x10    // bit 4 of LEDn_ON_H and LEDn_OFF_H
+
+// 25 MHz / (4096 * (5 + 1)) = 1017 Hz, about the timer PWM of the board channels
+#define PCA9685_PRESCALE        5
+
+class Pca9685
+{
+private:
+    uint8_t _address = HAL_EXPANDER_ADDRESS;
+    uint16_t _duty[PCA9685_CHANNELS] = {};
+    uint16_t _dirty = 0;
+    bool _isReady = false;
+
+public:
+    boolean Begin(uint8_t address);
+    void Set(uint8_t channel, uint16_t duty);
+    boolean IsDirty();
+    boolean Flush();
+};
@@ -0,0 +1,122 @@
+#include "Profiler.h"
+
+Profiler_Class PROFILER;
+
+// Lower edge of each overrun bin in tenths of the period
+static const uint8_t overrunTenths[PROFILE_OVERRUN_BINS] = {12, 15, 20, 40, 80};
+static const char *sectionNames[PROFILE_SECTION_COUNT] = {"Rtc", "Led", "Pmp", "Sch", "Lcd", "Btn", "SD ", "Dth"};
+
+void Profiler_Class::Begin(uint16_t periodMs)
+{
+    _periodMs = periodMs;
+    _budgetCycles = (HalCyclesPerSecond() / 1000) * periodMs;
+    Reset();
+}
+
+// Locked like Stop(), the DMA interrupt starts and stops its section in
+// between and a task level read-modify-write would drop its bit
+void Profiler_Class::Start(uint8_t section)
+{
+    HalInterruptsOff();
+    _nestedAtStart[section] = _nestedCycles;
+    _startCycles[section] = HalCycles();
+    _runningMask |= (1 << section);
+    HalInterruptsOn();
+}
+
+void Profiler_Class::Stop(uint8_t section)
+{
+    uint32_t now = HalCycles();
+
+    HalInterruptsOff();
+    if(_runningMask & (1 << section))
+    {
+        _runningMask &= ~(1 << section);
+        uint32_t cycles = (now - _startCycles[section]) - (_nestedCycles - _nestedAtStart[section]);
+        _nestedCycles += cycles;
+        _cycles[section] += cycles;
+        if(cycles > _maxCycles[section])
+        {
+            _maxCycles[section] = cycles;
+        }
+    }
+    HalInterruptsOn();
+}
+
+void Profiler_Class::MarkPeriod()
+{
+    uint32_t now = HalCycles();
+    uint32_t period = now - _lastMark;
+    _lastMark = now;
+
+    if(!_isMarked)
+    {
+        _isMarked = true;
+        return;
+    }
+
+    _totalCycles += period;
+    _periods++;
+
+    for(int8_t bin = PROFILE_OVERRUN_BINS - 1; bin >= 0; bin--)
+    {
+        if(period >= (uint64_t)_budgetCycles * overrunTenths[bin] / 10)
+        {
+            _overruns[bin]++;
+            break;
+        }
+    }
+}
+
+void Profiler_Class::Reset()
+{
+    HalInterruptsOff();
+    for(uint8_t i = 0; i < PROFILE_SECTION_COUNT; i++)
+    {
+        _cycles[i] = 0;
+        _maxCycles[i] = 0;
+    }
+
+    for(uint8_t i = 0; i < PROFILE_OVERRUN_BINS; i++)
+    {
+        _overruns[i] = 0;
+    }
+
+    _totalCycles = 0;
+    _periods = 0;
+    _isMarked = false;
+    HalInterruptsOn();
+}
+
+uint16_t Profiler_Class::GetLoadPermille(uint8_t section)
+{
+    if(_totalCycles == 0)
+        return 0;
+
+    return (uint16_t)(_cycles[section] * 1000 / _totalCycles);
+}
+
+uint32_t Profiler_Class::GetMaxMicros(uint8_t section)
+{
+    return _maxCycles[section] / (HalCyclesPerSecond() / 1000000);
+}
+
+uint32_t Profiler_Class::GetPeriods()
+{
+    return _periods;
+}
+
+uint32_t Profiler_Class::GetOverruns(uint8_t bin)
+{
+    return _overruns[bin];
+}
+
+uint16_t Profiler_Class::GetOverrunMs(uint8_t bin)
+{
+    return _periodMs * overrunTenths[bin] / 10;
+}
+
+const char *Profiler_Class::GetSectionName(uint8_t section)
+{
+    return sectionNames[section];
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <Hal.h>
+
+// Always-on cycle accounting for the control and UI loops. Sections are
+// exclusive: time spent in a section that starts inside another one, or in
+// a task that preempts it, is not charged to the outer section. The control
+// loop marks each period, late periods are counted per bin of the budget.
+
+enum profileSection
+{
+    PROFILE_RTC,
+    PROFILE_LED,
+    PROFILE_PUMP,
+    PROFILE_SCHEDULE,
+    PROFILE_LCD,
+    PROFILE_BUTTON,
+    PROFILE_SD,
+    PROFILE_DITHER,
+    PROFILE_SECTION_COUNT
+};
+
+#define PROFILE_OVERRUN_BINS 5
+
+class Profiler_Class
+{
+private:
+    uint64_t _cycles[PROFILE_SECTION_COUNT];
+    uint32_t _maxCycles[PROFILE_SECTION_COUNT];
+    uint32_t _startCycles[PROFILE_SECTION_COUNT];
+    uint32_t _nestedAtStart[PROFILE_SECTION_COUNT];
+    uint8_t _runningMask = 0;
+    uint32_t _nestedCycles = 0;
+    uint64_t _totalCycles = 0;
+    uint32_t _budgetCycles = 0;
+    uint32_t _lastMark = 0;
+    bool _isMarked = false;
+    uint32_t _periods = 0;
+    uint32_t _overruns[PROFILE_OVERRUN_BINS];
+    uint16_t _periodMs = 0;
+
+public:
+    void Begin(uint16_t periodMs);
+    void Start(uint8_t section);
+    void Stop(uint8_t section);
+    void MarkPeriod();
+    void Reset();
+    uint16_t GetLoadPermille(uint8_t section);
+    uint32_t GetMaxMicros(uint8_t section);
+    uint32_t GetPeriods();
+    uint32_t GetOverruns(uint8_t bin);
+    uint16_t GetOverrunMs(uint8_t bin);
+    const char *GetSectionName(uint8_t section);
+};
+
+extern Profiler_Class PROFILER;
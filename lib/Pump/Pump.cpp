@@ -2,14 +2,14 @@
 
 Pump::Pump(int pin)
 {
-    _pin = pin;
-    pinMode(_pin, OUTPUT);
+    HalPinMode(pin, OUTPUT);
+    _pwm = HalPwmAttach(pin);
     Disable();
 }
 
 void Pump::Tick()
 {
-    if(_isEnable && (millis() - _startMillis >= _pumpOnTime))
+    if(_isEnable && _isTimed && (HalMillis() - _startMillis >= _pumpOnTime))
     {
         Pump::Disable();
         _isCycleComplete = true;
@@ -19,36 +19,40 @@ void Pump::Tick()
     _isCycleComplete = false;
 }
 
-void Pump::SetParameters(int duty, float volume, float calibrationOffset)
-{   
-    _duty = (int)(40.95F * duty);
-    _pumpOnTime = volume * 1000;
+void Pump::SetParameters(int duty, int32_t volume, int32_t calibrationOffset)
+{
+    _duty = duty * HAL_PWM_MAX / 100;
 
-    if(calibrationOffset > 0.0F)
+    // Volumes are thousandths of a ml. Uncalibrated pumps count as 1 ml/s, so
+    // the volume is the run time in ms; a calibrated one delivered
+    // calibrationOffset in 5 s. 50 ml * 5000 ms still fits 32 bits
+    _pumpOnTime = volume;
+    if(calibrationOffset > 0)
     {
-        float value = 5 / calibrationOffset;
-        _pumpOnTime = long(value * volume) * 1000;
+        _pumpOnTime = (uint32_t)volume * 5000UL / (uint32_t)calibrationOffset;
     }
 }
 
 void Pump::Enable()
 {
     _isEnable = true;
-    analogWrite(_pin, _duty);
+    _isTimed = false;
+    HalPwmSet(_pwm, _duty);
 }
 
 void Pump::Disable()
 {
     _isEnable = false;
-    analogWrite(_pin, 0);
+    HalPwmSet(_pwm, 0);
 }
 
 void Pump::Start()
 {
     _isEnable = true;
+    _isTimed = true;
     _isCycleComplete = false;
-    _startMillis = millis();
-    analogWrite(_pin, _duty);
+    _startMillis = HalMillis();
+    HalPwmSet(_pwm, _duty);
 }
 
 boolean Pump::IsEnable()
@@ -1,12 +1,14 @@
-#include <Arduino.h>
+#pragma once
+#include <Hal.h>
 
 class Pump
 {
 private:
-    int _pin;
+    HalPwm _pwm;
     int _duty;
     unsigned long _pumpOnTime;
     bool _isEnable = false;
+    bool _isTimed = false;
     unsigned long _startMillis;
     bool _isCycleComplete = false;
 
@@ -16,7 +18,7 @@ public:
     void Enable();
     void Disable();
     void Start();
-    void SetParameters(int duty, float volume, float calibrationOffset);
+    void SetParameters(int duty, int32_t volume, int32_t calibrationOffset);
     boolean IsEnable();
     boolean IsCycleComplete();
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+#include <Hal.h>
+
+// Timer channels behind the board's PWM pins, resolved at compile time so a
+// duty update is one store to the compare register. analogWrite() looks the
+// pin up in the core's PinMap and may reinitialise the timer on every call.
+//
+//   PA0..PA3  TIM2_CH1..CH4  (pumps)
+//   PA9/PA10  TIM1_CH2/CH3   (LEDs, also fed by LedDma)
+//
+// Both timers count 0..4095 at about 1 kHz, so a 12 bit duty goes straight
+// into CCRx. Compare registers are preloaded and change on the next update
+// event, a write never cuts a period short.
+
+#if defined(STM32F1xx)
+#define PWM_CHANNEL_TOP        HAL_PWM_MAX
+#define PWM_CHANNEL_FREQUENCY  1000
+
+template <uint8_t Timer>
+struct PwmTimer;
+
+template <>
+struct PwmTimer<1>
+{
+    static TIM_TypeDef *Get() {return TIM1;}
+    static void EnableClock() {RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;}
+    static const bool isAdvanced = true;
+};
+
+template <>
+struct PwmTimer<2>
+{
+    static TIM_TypeDef *Get() {return TIM2;}
+    static void EnableClock() {RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;}
+    static const bool isAdvanced = false;
+};
+
+template <uint8_t Timer, uint8_t Channel>
+class PwmChannel
+{
+    static_assert(Channel >= 1 && Channel <= 4, "timer channels are 1..4");
+
+public:
+    // The timer base is shared by its channels, setting it again also undoes
+    // an analogWrite() on one of the pins
+    static void Begin()
+    {
+        TIM_TypeDef *timer = PwmTimer<Timer>::Get();
+
+        PwmTimer<Timer>::EnableClock();
+        timer->PSC = SystemCoreClock / ((PWM_CHANNEL_TOP + 1UL) * PWM_CHANNEL_FREQUENCY) - 1;
+        timer->ARR = PWM_CHANNEL_TOP;
+        timer->EGR = TIM_EGR_UG;
+        timer->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+
+        // PWM mode 1 with preload, CCMR1 holds channels 1/2 and CCMR2 channels 3/4
+        volatile uint32_t *ccmr = (Channel <= 2) ? &timer->CCMR1 : &timer->CCMR2;
+        uint8_t shift = ((Channel - 1) & 1) * 8;
+        *ccmr = (*ccmr & ~(0xFFUL << shift)) | ((TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1PE) << shift);
+        *Compare() = 0;
+        timer->CCER |= TIM_CCER_CC1E << ((Channel - 1) * 4);
+
+        if(PwmTimer<Timer>::isAdvanced)
+        {
+            timer->BDTR |= TIM_BDTR_MOE;
+        }
+    }
+
+    static volatile uint32_t *Compare()
+    {
+        return &PwmTimer<Timer>::Get()->CCR1 + (Channel - 1);
+    }
+
+    static void Write(uint32_t value)
+    {
+        *Compare() = value;
+    }
+};
+
+typedef PwmChannel<2, 1> PwmPA0;
+typedef PwmChannel<2, 2> PwmPA1;
+typedef PwmChannel<2, 3> PwmPA2;
+typedef PwmChannel<2, 4> PwmPA3;
+typedef PwmChannel<1, 2> PwmPA9;
+typedef PwmChannel<1, 3> PwmPA10;
+#endif
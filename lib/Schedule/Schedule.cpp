@@ -0,0 +1,111 @@
+#include "Schedule.h"
+
+void Schedule::Clear()
+{
+    _count = 0;
+    _cursor = 0;
+    _due = 0;
+    _isSynced = false;
+}
+
+boolean Schedule::Add(uint32_t second, uint8_t id)
+{
+    if(_count >= SCHEDULE_MAX_EVENTS)
+        return false;
+
+    _events[_count].second = second % SECONDS_PER_DAY;
+    _events[_count].id = id;
+    _count++;
+    _isSynced = false;
+    return true;
+}
+
+void Schedule::Build()
+{
+    // Insertion sort keeps events of the same second in the order they were added
+    for(uint8_t i = 1; i < _count; i++)
+    {
+        ScheduleEvent event = _events[i];
+        int8_t j = i - 1;
+
+        while(j >= 0 && _events[j].second > event.second)
+        {
+            _events[j + 1] = _events[j];
+            j--;
+        }
+
+        _events[j + 1] = event;
+    }
+
+    _isSynced = false;
+}
+
+boolean Schedule::Sync(uint32_t secondOfDay)
+{
+    if(_isSynced && secondOfDay == _lastSecond)
+        return false;
+
+    uint32_t elapsed = (secondOfDay + SECONDS_PER_DAY - _lastSecond) % SECONDS_PER_DAY;
+    if(!_isSynced || elapsed > SCHEDULE_MAX_CATCHUP)
+    {
+        Seek(secondOfDay);
+        return true;
+    }
+
+    while(_due < _count && GetDistance(_events[(_cursor + _due) % _count].second) <= elapsed)
+    {
+        _due++;
+    }
+
+    _lastSecond = secondOfDay;
+    return false;
+}
+
+boolean Schedule::Next(uint8_t *id)
+{
+    if(_due == 0)
+        return false;
+
+    *id = _events[_cursor].id;
+    _cursor = (_cursor + 1) % _count;
+    _due--;
+    return true;
+}
+
+void Schedule::Seek(uint32_t secondOfDay)
+{
+    _cursor = 0;
+    while(_cursor < _count && _events[_cursor].second <= secondOfDay)
+    {
+        _cursor++;
+    }
+
+    if(_cursor >= _count)
+        _cursor = 0;
+
+    _due = 0;
+    _lastSecond = secondOfDay;
+    _isSynced = true;
+}
+
+uint32_t Schedule::GetDistance(uint32_t second)
+{
+    uint32_t distance = (second + SECONDS_PER_DAY - _lastSecond) % SECONDS_PER_DAY;
+    if(distance == 0)
+        return SECONDS_PER_DAY;
+
+    return distance;
+}
+
+uint32_t Schedule::SecondOfDay(uint8_t hour, uint8_t minute, uint8_t second)
+{
+    return (uint32_t)hour * 3600 + (uint32_t)minute * 60 + second;
+}
+
+boolean Schedule::IsInWindow(uint32_t start, uint32_t stop, uint32_t secondOfDay)
+{
+    if(start <= stop)
+        return (secondOfDay > start && secondOfDay < stop);
+
+    return (secondOfDay > start || secondOfDay < stop);
+}
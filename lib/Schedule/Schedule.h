@@ -0,0 +1,34 @@
+#pragma once
+#include <Hal.h>
+
+#define SCHEDULE_MAX_EVENTS 16
+#define SCHEDULE_MAX_CATCHUP 60
+#define SECONDS_PER_DAY 86400UL
+
+struct ScheduleEvent
+{
+    uint32_t second;
+    uint8_t id;
+};
+
+class Schedule
+{
+private:
+    ScheduleEvent _events[SCHEDULE_MAX_EVENTS];
+    uint8_t _count = 0;
+    uint8_t _cursor = 0;
+    uint8_t _due = 0;
+    uint32_t _lastSecond = 0;
+    bool _isSynced = false;
+    void Seek(uint32_t secondOfDay);
+    uint32_t GetDistance(uint32_t second);
+
+public:
+    void Clear();
+    boolean Add(uint32_t second, uint8_t id);
+    void Build();
+    boolean Sync(uint32_t secondOfDay);
+    boolean Next(uint8_t *id);
+    static uint32_t SecondOfDay(uint8_t hour, uint8_t minute, uint8_t second);
+    static boolean IsInWindow(uint32_t start, uint32_t stop, uint32_t secondOfDay);
+};
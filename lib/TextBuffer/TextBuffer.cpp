@@ -0,0 +1,134 @@
+#include "TextBuffer.h"
+
+TextBuffer::TextBuffer()
+{
+    Clear();
+}
+
+TextBuffer &TextBuffer::Clear()
+{
+    _length = 0;
+    _text[0] = '\0';
+    return *this;
+}
+
+TextBuffer &TextBuffer::Append(const char *text)
+{
+    while(*text != '\0' && _length < TEXT_BUFFER_SIZE - 1)
+    {
+        _text[_length++] = *text++;
+    }
+
+    _text[_length] = '\0';
+    return *this;
+}
+
+TextBuffer &TextBuffer::Append(const __FlashStringHelper *text)
+{
+    return Append(reinterpret_cast<const char *>(text));
+}
+
+TextBuffer &TextBuffer::AppendChars(uint8_t count, char c)
+{
+    while(count > 0 && _length < TEXT_BUFFER_SIZE - 1)
+    {
+        _text[_length++] = c;
+        count--;
+    }
+
+    _text[_length] = '\0';
+    return *this;
+}
+
+TextBuffer &TextBuffer::AppendUint(uint32_t value, uint8_t width, char c, boolean isRight)
+{
+    char digits[10];
+    uint8_t length = 0;
+
+    do
+    {
+        digits[sizeof(digits) - 1 - length] = '0' + (value % 10);
+        value /= 10;
+        length++;
+    } while(value > 0);
+
+    return AppendPadded(&digits[sizeof(digits) - length], length, width, c, isRight);
+}
+
+TextBuffer &TextBuffer::AppendFixed(int32_t value, uint8_t decimals, uint8_t width, char c, boolean isRight)
+{
+    char digits[12];
+    uint8_t length = 0;
+    bool isNegative = (value < 0);
+    uint32_t magnitude = isNegative ? -(uint32_t)value : (uint32_t)value;
+
+    do
+    {
+        if(length == decimals && decimals > 0)
+        {
+            digits[sizeof(digits) - 1 - length++] = '.';
+        }
+
+        digits[sizeof(digits) - 1 - length++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while(magnitude > 0 || length <= decimals);
+
+    if(isNegative)
+    {
+        digits[sizeof(digits) - 1 - length++] = '-';
+    }
+
+    return AppendPadded(&digits[sizeof(digits) - length], length, width, c, isRight);
+}
+
+TextBuffer &TextBuffer::AppendFloat(float value, uint8_t decimals, uint8_t width, char c, boolean isRight)
+{
+    int32_t scale = 1;
+    for(uint8_t i = 0; i < decimals; i++)
+    {
+        scale *= 10;
+    }
+
+    return AppendFixed((int32_t)(value * scale + (value < 0 ? -0.5F : 0.5F)), decimals, width, c, isRight);
+}
+
+TextBuffer &TextBuffer::AppendTime(uint8_t hour, uint8_t minute)
+{
+    AppendUint(hour);
+    Append(":");
+    return AppendUint(minute, 2, '0');
+}
+
+const char *TextBuffer::GetText()
+{
+    return _text;
+}
+
+uint8_t TextBuffer::GetLength()
+{
+    return _length;
+}
+
+TextBuffer &TextBuffer::AppendPadded(const char *text, uint8_t length, uint8_t width, char c, boolean isRight)
+{
+    uint8_t fillCnt = (width > length) ? width - length : 0;
+
+    if(isRight)
+    {
+        AppendChars(fillCnt, c);
+    }
+
+    for(uint8_t i = 0; i < length && _length < TEXT_BUFFER_SIZE - 1; i++)
+    {
+        _text[_length++] = text[i];
+    }
+
+    _text[_length] = '\0';
+
+    if(!isRight)
+    {
+        AppendChars(fillCnt, c);
+    }
+
+    return *this;
+}
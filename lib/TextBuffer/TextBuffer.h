@@ -0,0 +1,25 @@
+#pragma once
+#include <Hal.h>
+
+#define TEXT_BUFFER_SIZE 24
+
+class TextBuffer
+{
+private:
+    char _text[TEXT_BUFFER_SIZE];
+    uint8_t _length = 0;
+    TextBuffer &AppendPadded(const char *text, uint8_t length, uint8_t width, char c, boolean isRight);
+
+public:
+    TextBuffer();
+    TextBuffer &Clear();
+    TextBuffer &Append(const char *text);
+    TextBuffer &Append(const __FlashStringHelper *text);
+    TextBuffer &AppendChars(uint8_t count, char c);
+    TextBuffer &AppendUint(uint32_t value, uint8_t width = 0, char c = ' ', boolean isRight = true);
+    TextBuffer &AppendFixed(int32_t value, uint8_t decimals, uint8_t width = 0, char c = ' ', boolean isRight = true);
+    TextBuffer &AppendFloat(float value, uint8_t decimals, uint8_t width = 0, char c = ' ', boolean isRight = true);
+    TextBuffer &AppendTime(uint8_t hour, uint8_t minute);
+    const char *GetText();
+    uint8_t GetLength();
+};
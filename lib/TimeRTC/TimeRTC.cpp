@@ -1,85 +1,207 @@
 #include "TimeRTC.h"
 
-void TimeRTC::Tick()
+volatile uint8_t TimeRTC::_pulses = 0;
+
+void TimeRTC::Begin(uint32_t sqwPin)
+{
+  // Control register: oscillator on, INTCN cleared, RS2:RS1 = 0 -> 1 Hz square wave
+  uint8_t control = 0x00;
+  if(!HalRtcWrite(0x0E, &control, 1))
+  {
+    return;
+  }
+
+  HalPinMode(sqwPin, INPUT_PULLUP);
+  HalAttachInterrupt(sqwPin, OnPulse, FALLING);
+  _isSqw = true;
+  _isSyncRequired = true;
+  _lastPulseMillis = HalMillis();
+}
+
+// Without isReadAllowed only the square wave pulses are counted, which needs
+// no bus. A read that is due waits for a Tick() that may use the bus
+void TimeRTC::Tick(boolean isReadAllowed)
 {
-  _dt = DateTime(_rtc.getYear(), _rtc.getMonth(_century), _rtc.getDate(), _rtc.getHour(_h12, _pm), _rtc.getMinute(), _rtc.getSecond());
-  _second = _dt.second();
+  uint32_t lastUnixTime = _unixTime;
 
-  if(_lastSecond != _second)
+  if(_isSqw)
   {
-    _lastSecond = _second;
-    _isTimeUpdated = true;
+    HalInterruptsOff();
+    uint8_t pulses = _pulses;
+    _pulses = 0;
+    HalInterruptsOn();
+
+    if(pulses > 0)
+    {
+      _lastPulseMillis = HalMillis();
+      _unixTime += pulses;
+      _secondsSinceSync += pulses;
+      if(_secondsSinceSync >= RTC_RESYNC_SECONDS)
+      {
+        _isSyncRequired = true;
+      }
+    }
+    else if(HalMillis() - _lastPulseMillis >= RTC_SQW_TIMEOUT_MS)
+    {
+      // Square wave lost, fall back to one bus read per second
+      _lastPulseMillis += 1000;
+      _isSyncRequired = true;
+    }
   }
-  else
+
+  if(isReadAllowed && (IsPollDue() || _isSyncRequired))
+  {
+    _lastReadMillis = HalMillis();
+
+    // Pulses since the count above are in the registers the read returns,
+    // only those are dropped. One during or after the read is counted next
+    HalInterruptsOff();
+    uint8_t pending = _pulses;
+    HalInterruptsOn();
+
+    if(ReadBurst())
+    {
+      HalInterruptsOff();
+      _pulses -= pending;
+      HalInterruptsOn();
+      _isSyncRequired = false;
+      _secondsSinceSync = 0;
+    }
+  }
+  else if(_unixTime != lastUnixTime)
+  {
+    _dt = FromUnixTime(_unixTime);
+  }
+
+  _isTimeUpdated = (_unixTime != lastUnixTime);
+  if(_isTimeUpdated)
   {
-    _isTimeUpdated = false;
+    _secondOfDay = _unixTime % 86400UL;
   }
 }
 
-String TimeRTC::GetCurrentTimeStr()
+boolean TimeRTC::IsSyncRequired()
+{
+  return (IsPollDue() || _isSyncRequired || _secondsSinceSync + _pulses >= RTC_RESYNC_SECONDS || HalMillis() - _lastPulseMillis >= RTC_SQW_TIMEOUT_MS);
+}
+
+// Without the square wave (the control register write failed) the time
+// comes from one burst read per second
+bool TimeRTC::IsPollDue()
 {
-  _year = _dt.year();
-  _month = _dt.month();
-  _day = _dt.day();
-  _hour = _dt.hour();
-  _minute = _dt.minute();
+  return !_isSqw && HalMillis() - _lastReadMillis >= RTC_POLL_MS;
+}
 
-  String stringMinute;
-  if(_minute < 10)
-  {
-    stringMinute = "0" + String(_minute);
-  }
-  else
+bool TimeRTC::ReadBurst()
+{
+  uint8_t regs[7];
+
+  if(!HalRtcRead(0x00, regs, 7))
   {
-    stringMinute = String(_minute);
+    return false;
   }
 
-  String stringSecond;
-  if(_second < 10)
+  uint8_t hour;
+  if(regs[2] & 0x40)
   {
-    stringSecond = "0" + String(_second);
+    hour = FromBcd(regs[2] & 0x1F) % 12;
+    if(regs[2] & 0x20)
+    {
+      hour += 12;
+    }
   }
   else
   {
-    stringSecond = String(_second);
+    hour = FromBcd(regs[2] & 0x3F);
   }
 
-  _timeString = String(_year) + "/" + String(_month) + "/" + String(_day) + " " + String(_hour) + ":" + stringMinute + ":" + stringSecond;
+  _dt = {(uint16_t)(2000 + FromBcd(regs[6])), FromBcd(regs[5] & 0x1F), FromBcd(regs[4] & 0x3F), hour, FromBcd(regs[1] & 0x7F), FromBcd(regs[0] & 0x7F)};
+  _unixTime = ToUnixTime(_dt);
+  return true;
+}
+
+uint8_t TimeRTC::FromBcd(uint8_t value)
+{
+  return (value >> 4) * 10 + (value & 0x0F);
+}
+
+uint8_t TimeRTC::ToBcd(uint8_t value)
+{
+  return ((value / 10) << 4) | (value % 10);
+}
+
+void TimeRTC::OnPulse()
+{
+  _pulses++;
+}
+
+const char *TimeRTC::GetCurrentTimeStr()
+{
+  _timeText.Clear().AppendUint(_dt.year).Append("/").AppendUint(_dt.month).Append("/").AppendUint(_dt.day).Append(" ");
+  _timeText.AppendTime(_dt.hour, _dt.minute).Append(":").AppendUint(_dt.second, 2, '0');
 
-  return _timeString;
+  return _timeText.GetText();
 }
 
-void TimeRTC::SetTime(DateTime dt)
+void TimeRTC::SetTime(RtcDateTime dt)
 {
-  _rtc.setYear(dt.year() - 2000);
-  _rtc.setMonth(dt.month());
-  _rtc.setDate(dt.day());
-  _rtc.setHour(dt.hour());
-  _rtc.setMinute(dt.minute());
-  _rtc.setSecond(0);
+  dt.second = 0;
+
+  // Seconds through year in one burst, day of week 1..7 counted from Sunday
+  uint8_t regs[7] = {ToBcd(dt.second), ToBcd(dt.minute), ToBcd(dt.hour), (uint8_t)((ToUnixTime(dt) / 86400UL + 4) % 7 + 1),
+                     ToBcd(dt.day), ToBcd(dt.month), ToBcd(dt.year - 2000)};
+  HalRtcWrite(0x00, regs, 7);
+  _isSyncRequired = true;
 }
 
-DateTime TimeRTC::GetDateTime()
+RtcDateTime TimeRTC::GetDateTime()
 {
   return _dt;
 }
 
+uint32_t TimeRTC::GetSecondOfDay()
+{
+  return _secondOfDay;
+}
+
+uint32_t TimeRTC::GetUnixTime()
+{
+  return _unixTime;
+}
+
 boolean TimeRTC::IsTimeUpdated()
 {
   return _isTimeUpdated;
 }
 
-boolean TimeRTC::IsTime(DateTime dt)
+uint32_t TimeRTC::ToUnixTime(RtcDateTime dt)
 {
-  return (dt.unixtime() == _dt.unixtime());
+  // Days from civil, shifted so the year starts in March and the leap day is last
+  int32_t year = dt.year - (dt.month <= 2);
+  uint32_t yearOfEra = year % 400;
+  uint32_t dayOfYear = (153 * (dt.month + (dt.month > 2 ? -3 : 9)) + 2) / 5 + dt.day - 1;
+  uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  uint32_t days = (year / 400) * 146097 + dayOfEra - 719468;
+
+  return days * 86400UL + dt.hour * 3600UL + dt.minute * 60UL + dt.second;
 }
 
-boolean TimeRTC::IsTimeGreater(DateTime dt)
+RtcDateTime TimeRTC::FromUnixTime(uint32_t unixTime)
 {
-  return (dt.unixtime() < _dt.unixtime());
+  uint32_t days = unixTime / 86400UL + 719468;
+  uint32_t secondOfDay = unixTime % 86400UL;
+  uint32_t era = days / 146097;
+  uint32_t dayOfEra = days - era * 146097;
+  uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  uint32_t monthIndex = (5 * dayOfYear + 2) / 153;
+  RtcDateTime dt;
+
+  dt.day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+  dt.month = (monthIndex < 10) ? monthIndex + 3 : monthIndex - 9;
+  dt.year = yearOfEra + era * 400 + (dt.month <= 2);
+  dt.hour = secondOfDay / 3600;
+  dt.minute = (secondOfDay / 60) % 60;
+  dt.second = secondOfDay % 60;
+  return dt;
 }
- 
-boolean TimeRTC::IsTimeLower(DateTime dt)
-{
-  return (dt.unixtime() > _dt.unixtime());
-}
\ No newline at end of file
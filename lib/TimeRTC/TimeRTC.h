@@ -1,25 +1,51 @@
-#include <Arduino.h>
-#include <DS3231.h>
+#pragma once
+#include <Hal.h>
+#include <TextBuffer.h>
+
+#define RTC_RESYNC_SECONDS 60
+#define RTC_SQW_TIMEOUT_MS 1500
+#define RTC_POLL_MS        1000
+
+struct RtcDateTime
+{
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+};
 
 class TimeRTC
 {
 private:
-    DS3231 _rtc;
-    DateTime _dt;
-    bool _century, _h12, _pm;
+    RtcDateTime _dt = {2000, 1, 1, 0, 0, 0};
     bool _isTimeUpdated;
-    uint16_t _year;
-    uint8_t _month, _day, _hour, _minute, _second;
-    uint8_t _lastSecond = -1;
-    String _timeString;
+    bool _isSqw = false;
+    bool _isSyncRequired = true;
+    uint8_t _secondsSinceSync = 0;
+    uint32_t _unixTime = 0;
+    uint32_t _secondOfDay;
+    unsigned long _lastPulseMillis;
+    unsigned long _lastReadMillis = 0;
+    TextBuffer _timeText;
+    static volatile uint8_t _pulses;
+    static void OnPulse();
+    bool ReadBurst();
+    bool IsPollDue();
+    static uint8_t FromBcd(uint8_t value);
+    static uint8_t ToBcd(uint8_t value);
 
 public:
-    void Tick();
-    String GetCurrentTimeStr();
-    void SetTime(DateTime dt);
-    DateTime GetDateTime();
+    void Begin(uint32_t sqwPin);
+    void Tick(boolean isReadAllowed = true);
+    boolean IsSyncRequired();
+    const char *GetCurrentTimeStr();
+    void SetTime(RtcDateTime dt);
+    RtcDateTime GetDateTime();
+    uint32_t GetSecondOfDay();
+    uint32_t GetUnixTime();
     boolean IsTimeUpdated();
-    boolean IsTime(DateTime dt);
-    boolean IsTimeGreater(DateTime dt);
-    boolean IsTimeLower(DateTime dt);
+    static uint32_t ToUnixTime(RtcDateTime dt);
+    static RtcDateTime FromUnixTime(uint32_t unixTime);
 };
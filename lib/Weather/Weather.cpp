@@ -0,0 +1,101 @@
+#include "Weather.h"
+
+// Depth is the dip under full cover in percent, storms start below lighter skies
+void Weather::SetMode(uint8_t mode, uint8_t depth)
+{
+    _mode = (mode < WEATHER_MODE_COUNT) ? mode : (uint8_t)WEATHER_OFF;
+    _depth = (int32_t)((depth > 100) ? 100 : depth) * WEATHER_ONE / 100;
+    _threshold = (_mode == WEATHER_STORM) ? WEATHER_ONE / 4 : WEATHER_ONE / 2;
+    _step = UINT32_MAX;
+    _slow.lattice = UINT32_MAX;
+    _fast.lattice = UINT32_MAX;
+    _scale = WEATHER_ONE;
+    _isFlash = false;
+}
+
+boolean Weather::IsActive()
+{
+    return _mode != WEATHER_OFF;
+}
+
+// True when the outputs were computed for a new step
+boolean Weather::Update(uint32_t seed, uint32_t millisOfDay)
+{
+    uint32_t step = millisOfDay / WEATHER_STEP_MS;
+    if(_mode == WEATHER_OFF || (step == _step && seed == _seed))
+        return false;
+
+    if(seed != _seed)
+    {
+        _seed = seed;
+        _slow.lattice = UINT32_MAX;
+        _fast.lattice = UINT32_MAX;
+    }
+
+    _step = step;
+
+    // 0..4095, mostly the slow octave so clouds come and go in groups
+    int32_t noise = (3 * Noise(step, WEATHER_SLOW_SHIFT, 0, &_slow) + Noise(step, WEATHER_FAST_SHIFT, 1, &_fast)) / 4;
+    int32_t cover = (noise > _threshold) ? (noise - _threshold) * WEATHER_ONE / (WEATHER_ONE - _threshold) : 0;
+
+    _scale = (uint16_t)(WEATHER_ONE - ((cover * _depth) >> WEATHER_FRACTION_BITS));
+    _isFlash = (_mode == WEATHER_STORM && cover > WEATHER_ONE / 2 && IsStrike(step));
+    return true;
+}
+
+// Q12 factor for the LED levels
+uint16_t Weather::GetScale()
+{
+    return _scale;
+}
+
+boolean Weather::IsFlash()
+{
+    return _isFlash;
+}
+
+// Lowbias32 over index and seed, any lattice point without walking a sequence
+uint32_t Weather::Hash(uint32_t x)
+{
+    x += _seed * 0x9E3779B9UL;
+    x ^= x >> 16;
+    x *= 0x7FEB352DUL;
+    x ^= x >> 15;
+    x *= 0x846CA68BUL;
+    x ^= x >> 16;
+    return x;
+}
+
+int32_t Weather::Noise(uint32_t step, uint8_t shift, uint8_t salt, WeatherOctave *octave)
+{
+    uint32_t lattice = step >> shift;
+    if(lattice != octave->lattice)
+    {
+        // Walking forward the next point is the only new one
+        octave->from = (octave->lattice != UINT32_MAX && lattice == octave->lattice + 1) ? octave->to : (int32_t)(Hash((lattice << 1) | salt) >> 20);
+        octave->to = (int32_t)(Hash(((lattice + 1) << 1) | salt) >> 20);
+        octave->lattice = lattice;
+    }
+
+    int32_t fraction = (int32_t)(step & ((1UL << shift) - 1)) << (WEATHER_FRACTION_BITS - shift);
+    int32_t square = (fraction * fraction) >> WEATHER_FRACTION_BITS;
+    fraction = (square * ((3 << WEATHER_FRACTION_BITS) - 2 * fraction)) >> WEATHER_FRACTION_BITS;
+
+    return octave->from + (((octave->to - octave->from) * fraction) >> WEATHER_FRACTION_BITS);
+}
+
+// A strike within the last WEATHER_FLASH_STEPS steps lights this one if its
+// flicker bit is set, the first step of a strike always is
+bool Weather::IsStrike(uint32_t step)
+{
+    for(uint8_t age = 0; age < WEATHER_FLASH_STEPS && age <= step; age++)
+    {
+        uint32_t hash = Hash(~(step - age));
+        if((hash & 0xFFFF) < WEATHER_STRIKE_CHANCE)
+        {
+            return age == 0 || ((hash >> (16 + age)) & 1);
+        }
+    }
+
+    return false;
+}
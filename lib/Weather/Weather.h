@@ -0,0 +1,62 @@
+#pragma once
+#include <Hal.h>
+
+// Passing clouds and thunderstorms on top of the LED levels. The sky is a
+// pure function of a seed and the time of day, so the same day always plays
+// the same weather, a reboot picks it up where it was and the host sim can
+// check it against a trace.
+//
+// Every WEATHER_STEP_MS two octaves of value noise are sampled: a slow one
+// for how cloudy it is and a fast one for the edges of single clouds. Lattice
+// points come from an integer hash of their index, the two around the
+// current step are cached and the segment between them is smoothstepped in
+// Q12, so a step costs a handful of multiplies and Update() between steps
+// only one compare. Storms add lightning under heavy cover: a strike is a
+// hash hit on a step, its flicker the next bits of the same hash.
+
+enum weatherMode
+{
+    WEATHER_OFF,
+    WEATHER_CLOUDS,
+    WEATHER_STORM,
+    WEATHER_MODE_COUNT
+};
+
+#define WEATHER_STEP_MS         40
+#define WEATHER_ONE             4096
+#define WEATHER_FRACTION_BITS   12
+#define WEATHER_FAST_SHIFT      5       // detail lattice every 32 steps, 1.3 s
+#define WEATHER_SLOW_SHIFT      9       // cover lattice every 512 steps, 20 s
+#define WEATHER_STRIKE_CHANCE   40      // per 65536 steps under heavy cover, about one a minute
+#define WEATHER_FLASH_STEPS     4
+
+struct WeatherOctave
+{
+    uint32_t lattice;
+    int32_t from;
+    int32_t to;
+};
+
+class Weather
+{
+private:
+    uint8_t _mode = WEATHER_OFF;
+    int32_t _depth = 0;
+    int32_t _threshold = WEATHER_ONE / 2;
+    uint32_t _seed = 0;
+    uint32_t _step = UINT32_MAX;
+    uint16_t _scale = WEATHER_ONE;
+    bool _isFlash = false;
+    WeatherOctave _slow = {UINT32_MAX, 0, 0};
+    WeatherOctave _fast = {UINT32_MAX, 0, 0};
+    uint32_t Hash(uint32_t x);
+    int32_t Noise(uint32_t step, uint8_t shift, uint8_t salt, WeatherOctave *octave);
+    bool IsStrike(uint32_t step);
+
+public:
+    void SetMode(uint8_t mode, uint8_t depth);
+    boolean IsActive();
+    boolean Update(uint32_t seed, uint32_t millisOfDay);
+    uint16_t GetScale();
+    boolean IsFlash();
+};
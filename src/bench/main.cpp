@@ -0,0 +1,400 @@
+//##############################//
+//        Aqua Controller       //
+//          Benchmarks          //
+//##############################//
+
+// Built with -DBENCH ([env:bench] on target, [env:bench_native] on the host),
+// setup() brings the board up as usual and runs Bench_Run() instead of the
+// scheduler. Each case is timed with HalCycles() (DWT CYCCNT on target, host
+// nanoseconds on the host) and reported on the serial port, stdout on the
+// host, as one line per case:
+//
+//   bench,<name>,<runs>,<min>,<median>,<max>,<cycles per second>,<calls>
+//
+// A run times <calls> calls, doubled from 1 until a run takes BENCH_RUN_US,
+// and min, median and max are cycles per call. A single call of a few
+// hundred ns is down at the resolution of the host clock, a run of 100 us
+// is not. On the host the cases run BENCH_ROUNDS times, half a second apart,
+// and each case keeps the lowest min and median and the highest max of its
+// rounds: a shared host has slow phases of a second or more, the best round
+// is the code and not the neighbours. Compare min and median between
+// builds, max only shows the spread. Nothing the user set up is touched: pump and
+// LED cases run a controller of their own on a copy of the config, with a
+// pump at 0% duty and a LED that writes into a Pca9685 shadow, and sd_save
+// writes BENCH_SD_FILE instead of the config slots. On the host a previous
+// output can be used as a gate:
+//
+//   bench_native [-g baseline.csv] [-p percent]
+//
+//   -g  fail when a case got more than percent slower than there
+//   -p  allowed growth, default BENCH_GATE_PERCENT
+//
+// The gate compares the min per call, the run nothing else got into. The
+// default passes an unchanged tree on a shared single core host, a quiet
+// machine can gate tighter with -p. The SD cases wait on the file system and
+// are left out of the gate.
+
+#include <Hal.h>
+#include <TimeRTC.h>
+#include <Pump.h>
+#include <Led.h>
+#include <Config.h>
+#include <Controller.h>
+#include <TextBuffer.h>
+#include <Display.h>
+#include <PwmChannel.h>
+#include <Weather.h>
+#include <Pca9685.h>
+
+#if defined(BENCH)
+#include <stdio.h>
+#include <unistd.h>
+
+#define BENCH_RUNS        65
+#define BENCH_SD_RUNS     9
+#define BENCH_PWM_WRITES  64
+#define BENCH_RUN_US      100
+#define BENCH_MAX_CALLS   16384
+#define BENCH_GATE_PERCENT 25
+#if defined(ARDUINO)
+#define BENCH_ROUNDS      1
+#else
+#define BENCH_ROUNDS      10
+#define BENCH_ROUND_PAUSE_US 500000
+#endif
+#define BENCH_UNGATED_PREFIX "sd_"
+#define BENCH_SERIAL_BAUD 115200
+#define BENCH_SD_FILE     "/bench.bin"
+#define PACING_MS         10
+
+struct BenchCase
+{
+  const char *name;
+  uint16_t runs;
+  void (*prepare)();
+  void (*run)();
+};
+
+struct BenchResult
+{
+  const char *name;
+  uint16_t runs;
+  uint32_t min;
+  uint32_t median;
+  uint32_t max;
+  uint16_t calls;
+};
+
+extern TimeRTC timeRTC;
+extern Display lcd;
+extern bool updateAllItems;
+bool MenuHome_Render();
+bool SD_Begin();
+bool SD_Load();
+bool SD_WriteConfig(const char *name, uint32_t sequence);
+int8_t SD_FindSlot(Configuration *config, uint32_t *sequence);
+
+uint32_t benchSamples[BENCH_RUNS];
+HalPwm benchPwm;
+Weather benchWeather;
+uint32_t benchWeatherMillis = 0;
+Pca9685 benchBoard;
+uint16_t benchBoardDuty = 0;
+
+// Stand-ins with the real write paths: the pump is on the PA0 timer channel
+// but never above 0%, the LED writes channel 0 of the board shadow
+Configuration benchConfig;
+Pump benchPump(PA0);
+Led benchLed(&benchBoard, 0);
+Pump *benchPumps[] = {&benchPump, &benchPump, &benchPump, &benchPump};
+Controller benchController(&benchConfig, &timeRTC, benchPumps, &benchLed, &benchLed);
+
+// CASES -------------------------------------
+void Bench_Pacing() {HalDelay(PACING_MS);}
+void Bench_PumpReset() {benchConfig.pump1_volume_bottle = BOTTLE_VOLUME_FULL; benchPump.Disable();}
+void Bench_FullRedraw() {updateAllItems = true;}
+// The ramp starts over once done, so every run is a tick of a ramping LED
+void Bench_LedPacing()
+{
+  HalDelay(PACING_MS);
+  if(!benchLed.IsRamping()) {benchLed.Disable(); benchLed.Start();}
+}
+void Bench_LedTick() {benchLed.Tick();}
+void Bench_RtcTick() {timeRTC.Tick();}
+void Bench_CheckPumpOn() {benchController.CheckPumpOn(EVENT_PUMP_1);}
+void Bench_HomeRender() {MenuHome_Render(); lcd.Flush();}
+// SD_Save() with its slot lookup, written to the scratch file
+void Bench_SdSave()
+{
+  Configuration config;
+  uint32_t sequence = 0;
+  SD_FindSlot(&config, &sequence);
+  SD_WriteConfig(BENCH_SD_FILE, sequence + 1);
+}
+void Bench_SdLoad() {SD_Load();}
+// Every run is a new weather step, the worst case of a control tick
+void Bench_WeatherStep() {benchWeather.Update(1, benchWeatherMillis += WEATHER_STEP_MS);}
+
+// A frame with all 16 channels of a board changed. The pacing lets the last
+// burst leave the bus, so the run is what the control loop pays to post it
+void Bench_BoardChange()
+{
+  HalDelay(PACING_MS);
+  benchBoardDuty = (benchBoardDuty + 1) & HAL_PWM_MAX;
+  for(uint8_t i = 0; i < PCA9685_CHANNELS; i++) {benchBoard.Set(i, benchBoardDuty);}
+}
+void Bench_BoardFlush() {benchBoard.Flush();}
+
+// PWM cases write BENCH_PWM_WRITES duties to the white LED pin per run
+#if defined(ARDUINO)
+void Bench_PwmAnalogWrite() {for(uint32_t i = 0; i < BENCH_PWM_WRITES; i++) {analogWrite(PA9, i);}}
+#endif
+void Bench_PwmWrite() {for(uint32_t i = 0; i < BENCH_PWM_WRITES; i++) {HalPwmWrite(PA9, i);}}
+void Bench_PwmSet() {for(uint32_t i = 0; i < BENCH_PWM_WRITES; i++) {HalPwmSet(benchPwm, i);}}
+#if defined(STM32F1xx)
+void Bench_PwmCompare() {for(uint32_t i = 0; i < BENCH_PWM_WRITES; i++) {PwmPA9::Write(i);}}
+#endif
+
+const BenchCase benchCases[] = {
+  {"led_tick", BENCH_RUNS, Bench_LedPacing, Bench_LedTick},
+  {"rtc_tick", BENCH_RUNS, Bench_Pacing, Bench_RtcTick},
+  {"check_pump_on", BENCH_RUNS, Bench_PumpReset, Bench_CheckPumpOn},
+  {"home_render", BENCH_RUNS, Bench_FullRedraw, Bench_HomeRender},
+  {"weather_step", BENCH_RUNS, nullptr, Bench_WeatherStep},
+  {"board_flush_16", BENCH_RUNS, Bench_BoardChange, Bench_BoardFlush},
+#if defined(ARDUINO)
+  {"pwm_analog_write_64", BENCH_RUNS, nullptr, Bench_PwmAnalogWrite},
+#endif
+  {"pwm_write_64", BENCH_RUNS, nullptr, Bench_PwmWrite},
+  {"pwm_set_64", BENCH_RUNS, nullptr, Bench_PwmSet},
+#if defined(STM32F1xx)
+  {"pwm_compare_64", BENCH_RUNS, nullptr, Bench_PwmCompare},
+#endif
+  {"sd_save", BENCH_SD_RUNS, nullptr, Bench_SdSave},
+  {"sd_load", BENCH_SD_RUNS, nullptr, Bench_SdLoad}
+};
+
+#define BENCH_CASE_COUNT (sizeof(benchCases) / sizeof(benchCases[0]))
+
+BenchResult benchResults[BENCH_CASE_COUNT];
+uint8_t benchResultCount = 0;
+
+// RUN -------------------------------------
+void Bench_Print(const BenchResult &result)
+{
+  TextBuffer text;
+
+  HalSerialWrite("bench,");
+  HalSerialWrite(result.name);
+  HalSerialWrite(text.Clear().Append(",").AppendUint(result.runs).Append(",").AppendUint(result.min).GetText());
+  HalSerialWrite(text.Clear().Append(",").AppendUint(result.median).Append(",").AppendUint(result.max).GetText());
+  HalSerialWrite(text.Clear().Append(",").AppendUint(HalCyclesPerSecond()).Append(",").AppendUint(result.calls).Append("\n").GetText());
+}
+
+// Cycles of one run. A prepare step stays outside the timing, those calls
+// are timed one by one and summed
+uint32_t Bench_Time(const BenchCase &benchCase, uint16_t calls)
+{
+  uint32_t cycles = 0;
+
+  if(benchCase.prepare == nullptr)
+  {
+    uint32_t start = HalCycles();
+    for(uint16_t i = 0; i < calls; i++) {benchCase.run();}
+    return HalCycles() - start;
+  }
+
+  for(uint16_t i = 0; i < calls; i++)
+  {
+    benchCase.prepare();
+    uint32_t start = HalCycles();
+    benchCase.run();
+    cycles += HalCycles() - start;
+  }
+
+  return cycles;
+}
+
+BenchResult Bench_Measure(const BenchCase &benchCase)
+{
+  // The calibration runs are untimed, so the results do not include the cold start
+  uint32_t runCycles = HalCyclesPerSecond() / 1000000 * BENCH_RUN_US;
+  uint16_t calls = 1;
+  while(calls < BENCH_MAX_CALLS && Bench_Time(benchCase, calls) < runCycles)
+  {
+    calls *= 2;
+  }
+
+  for(uint16_t i = 0; i < benchCase.runs; i++)
+  {
+    uint32_t cycles = Bench_Time(benchCase, calls) / calls;
+
+    // Insertion keeps the samples sorted for the median
+    uint16_t j = i;
+    for(; j > 0 && benchSamples[j - 1] > cycles; j--)
+    {
+      benchSamples[j] = benchSamples[j - 1];
+    }
+    benchSamples[j] = cycles;
+  }
+
+  return {benchCase.name, benchCase.runs, benchSamples[0], benchSamples[benchCase.runs / 2], benchSamples[benchCase.runs - 1], calls};
+}
+
+// The best round of a case, its worst run
+void Bench_Keep(BenchResult *kept, const BenchResult &result, bool isFirst)
+{
+  if(isFirst)
+  {
+    *kept = result;
+    return;
+  }
+
+  if(result.min < kept->min) {kept->min = result.min;}
+  if(result.median < kept->median) {kept->median = result.median;}
+  if(result.max > kept->max) {kept->max = result.max;}
+}
+
+void Bench_Run()
+{
+  Configuration config = _config;
+  bool isSd = SD_Begin();
+  bool isBoard = benchBoard.Begin(HAL_EXPANDER_ADDRESS);
+
+  HalSerialBegin(BENCH_SERIAL_BAUD);
+  benchPwm = HalPwmAttach(PA9);
+  benchWeather.SetMode(WEATHER_STORM, 100);
+  benchConfig = _config;
+  benchPump.SetParameters(0, _config.pump1_volume, 0);
+  benchLed.SetParameters(_config.whiteLed_maxDuty, _config.whiteLed_rampUp, _config.whiteLed_rampDown);
+  benchLed.Start();
+
+  for(uint8_t round = 0; round < BENCH_ROUNDS; round++)
+  {
+    benchResultCount = 0;
+
+    for(uint8_t i = 0; i < BENCH_CASE_COUNT; i++)
+    {
+      if(benchCases[i].run == Bench_SdSave && !isSd)
+      {
+        if(round == 0) {HalSerialWrite("bench,no sd card, sd_save and sd_load skipped\n");}
+        break;
+      }
+
+      if(benchCases[i].run == Bench_BoardFlush && !isBoard)
+      {
+        if(round == 0) {HalSerialWrite("bench,no expander board, board_flush_16 skipped\n");}
+        continue;
+      }
+
+      Bench_Keep(&benchResults[benchResultCount++], Bench_Measure(benchCases[i]), round == 0);
+
+#if defined(ARDUINO)
+      // analogWrite() left TIM1 set up its own way
+      if(benchCases[i].run == Bench_PwmAnalogWrite) {HalPwmAttach(PA9);}
+#endif
+    }
+
+#if !defined(ARDUINO)
+    if(round + 1 < BENCH_ROUNDS) {usleep(BENCH_ROUND_PAUSE_US);}
+#endif
+  }
+
+  for(uint8_t i = 0; i < benchResultCount; i++)
+  {
+    Bench_Print(benchResults[i]);
+  }
+
+  // Leave the outputs and the config as they were before the run
+  benchPump.Disable();
+  HalPwmSet(benchPwm, 0);
+  _config = config;
+  HalSerialWrite("bench,done\n");
+}
+
+#if !defined(ARDUINO)
+void setup();
+
+// GATE -------------------------------------
+const BenchResult *Bench_Find(const BenchResult *results, uint8_t count, const char *name)
+{
+  for(uint8_t i = 0; i < count; i++)
+  {
+    if(strcmp(results[i].name, name) == 0) {return &results[i];}
+  }
+
+  return nullptr;
+}
+
+int Bench_Gate(const char *name, uint32_t percent)
+{
+  FILE *file = fopen(name, "r");
+  if(file == nullptr)
+  {
+    fprintf(stderr, "cannot open baseline %s\n", name);
+    return 1;
+  }
+
+  BenchResult baseline[BENCH_CASE_COUNT];
+  char baselineNames[BENCH_CASE_COUNT][32];
+  uint8_t baselineCount = 0;
+  char line[128];
+  while(baselineCount < BENCH_CASE_COUNT && fgets(line, sizeof(line), file) != nullptr)
+  {
+    unsigned runs, min;
+    if(sscanf(line, "bench,%31[^,],%u,%u", baselineNames[baselineCount], &runs, &min) != 3)
+    {
+      continue;
+    }
+
+    baseline[baselineCount] = {baselineNames[baselineCount], (uint16_t)runs, min, 0, 0, 0};
+    baselineCount++;
+  }
+  fclose(file);
+
+  int failures = 0;
+  for(uint8_t i = 0; i < benchResultCount; i++)
+  {
+    const BenchResult *result = &benchResults[i];
+    const BenchResult *previous = Bench_Find(baseline, baselineCount, result->name);
+    if(previous == nullptr || strncmp(result->name, BENCH_UNGATED_PREFIX, strlen(BENCH_UNGATED_PREFIX)) == 0)
+    {
+      continue;
+    }
+
+    if((uint64_t)result->min * 100 > (uint64_t)previous->min * (100 + percent))
+    {
+      fprintf(stderr, "%s: min %u, baseline %u (+%u%% allowed)\n", result->name, result->min, previous->min, percent);
+      failures++;
+    }
+  }
+
+  return failures > 0 ? 1 : 0;
+}
+
+// =======================================================================//
+//                                  MAIN                                  //
+// =======================================================================//
+int main(int argc, char **argv)
+{
+  const char *baselineName = nullptr;
+  uint32_t percent = BENCH_GATE_PERCENT;
+  int option;
+
+  while((option = getopt(argc, argv, "g:p:")) != -1)
+  {
+    switch (option)
+    {
+      case 'g': baselineName = optarg; break;
+      case 'p': percent = strtoul(optarg, nullptr, 10); break;
+      default:
+        fprintf(stderr, "usage: %s [-g baseline.csv] [-p percent]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  setup();
+  return (baselineName != nullptr) ? Bench_Gate(baselineName, percent) : 0;
+}
+#endif
+#endif
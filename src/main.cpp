@@ -4,35 +4,63 @@
 //            By Paul           //
 //##############################//
 
-#include <Arduino.h>
-#include <Wire.h>
-#include <hd44780.h>
-#include <hd44780ioClass/hd44780_I2Cexp.h>
+#include <Hal.h>
+#include <HalRtos.h>
+#include <Display.h>
 #include <TimeRTC.h>
 #include <Pump.h>
 #include <ArduinoJson.h>
-#include <SD.h>
-#include <RotaryEncoder.h>
 #include <Buzzer.h>
 #include <Led.h>
+#include <LedDma.h>
+#include <LedDither.h>
+#include <Pca9685.h>
+#include <TextBuffer.h>
+#include <HeapStats.h>
+#include <FlashKv.h>
+#include <ArenaAllocator.h>
+#include <Config.h>
+#include <Controller.h>
+#include <LightProfile.h>
+#include <Weather.h>
+#include <InputLog.h>
+#include <Profiler.h>
+#if defined(ARDUINO)
+#include <RotaryEncoder.h>
 #include <OneButton.h>
-#include <SPI.h>
+#else
+#include <InputReplay.h>
+#endif
 
 #define SD_PIN            PA4
 #define ENCODER_A         PA12
 #define ENCODER_B         PA11
 #define RESERVED_OUTPUT   PB0
 #define BUZZER_PIN        PA8
+#define RTC_SQW_PIN       PB1
+#define LED_BOARD_FRAME_MS 40
 
 RotaryEncoder *encoder = nullptr;
 TimeRTC timeRTC;
+FlashKv flashKv;
+InputLog inputLog;
 OneButton btnOk(PA15);
 Pump pump_1(PA0);
 Pump pump_2(PA1);
 Pump pump_3(PA2);
 Pump pump_4(PA3);
-Led whiteLed(PA9);
-Led colorLed(PA10);
+Led whiteLed(PA9, LedCurve<LED_WHITE_GAMMA>::Get());
+Led colorLed(PA10, LedCurve<LED_COLOR_GAMMA>::Get());
+LedDma whiteLedDma(PA9);
+LedDma colorLedDma(PA10);
+LedDither ledDither;
+#if PCA9685_BOARDS > 0
+Pca9685 ledBoards[PCA9685_BOARDS];
+uint8_t ledBoardNext = 0;
+uint32_t ledBoardMillis = 0;
+#endif
+Pump *pumps[] = {&pump_1, &pump_2, &pump_3, &pump_4};
+Controller controller(&_config, &timeRTC, pumps, &whiteLed, &colorLed);
 
 #define DISP_ITEM_ROWS 3
 #define DISP_CHAR_WIDTH 20
@@ -40,6 +68,7 @@ Led colorLed(PA10);
 #define FLASH_RST_CNT 10
 #define WAKEUP 150
 #define BACKLIGHT 300
+#define PUMP_COUNT 4
 
 enum pageType
 {
@@ -47,6 +76,7 @@ enum pageType
   MENU_MAIN,
   MENU_LED_WHITE,
   MENU_LED_COLOR,
+  MENU_LED_PROFILE,
   MENU_PUMP_1,
   MENU_PUMP_1_CALIBRATION,
   MENU_PUMP_2,
@@ -55,14 +85,43 @@ enum pageType
   MENU_PUMP_3_CALIBRATION,
   MENU_PUMP_4,
   MENU_PUMP_4_CALIBRATION,
-  MENU_SETTINGS
+  MENU_SETTINGS,
+  MENU_DIAGNOSTICS
+};
+
+enum storageCommandType
+{
+  STORAGE_SAVE,
+  STORAGE_SET_DEFAULTS,
+  STORAGE_IMPORT,
+  STORAGE_EXPORT
+};
+
+enum uiMessageType
+{
+  UI_STORAGE_SAVED,
+  UI_STORAGE_FAILED,
+  UI_DEFAULTS_SET,
+  UI_SD_IMPORTED,
+  UI_SD_EXPORTED,
+  UI_SD_FAILED,
+  UI_PUMP_CYCLE_COMPLETE
+};
+
+struct UiMessage
+{
+  uint8_t type;
+  uint8_t index;
 };
 
 enum pageType currPage = MENU_HOME;
 void Page_MenuHome();
+bool MenuHome_Render();
 void Page_MenuMain();
 void Page_MenuLedWhite();
 void Page_MenuLedColor();
+void Page_MenuLedProfile();
+bool IsProfileUsed(const uint32_t *keyframes);
 void Page_Pump_1();
 void Page_Pump_1_Calibration();
 void Page_Pump_2();
@@ -72,22 +131,50 @@ void Page_Pump_3_Calibration();
 void Page_Pump_4();
 void Page_Pump_4_Calibration();
 void Page_MenuSettings();
+void Page_MenuDiagnostics();
+
+// TASKS ----------------------------------------------
+#define CONTROL_TASK_STACK  256
+#define UI_TASK_STACK       384
+#define STORAGE_TASK_STACK  512
+#define CONTROL_TASK_PRIORITY   (tskIDLE_PRIORITY + 3)
+#define UI_TASK_PRIORITY        (tskIDLE_PRIORITY + 2)
+#define STORAGE_TASK_PRIORITY   (tskIDLE_PRIORITY + 1)
+#define STORAGE_POLL_MS         500
+
+QueueHandle_t controlQueue;
+QueueHandle_t storageQueue;
+QueueHandle_t uiQueue;
+SemaphoreHandle_t i2cMutex;
+// _config is edited by Ui, read and counted down by Control and saved or
+// replaced by Storage, each under configMutex. Storage saves a snapshot, so
+// flash and SD writes never hold the other tasks up. Single fields read for
+// the display are not locked, a load redraws the page anyway
+SemaphoreHandle_t configMutex;
+
+void ControlTask(void *parameters);
+void UiTask(void *parameters);
+void StorageTask(void *parameters);
+#if defined(BENCH)
+void Bench_Run();
+#endif
+void SendControl(uint8_t type, uint8_t index, uint8_t duty = 0, int32_t value = 0);
+void SendStorage(uint8_t type);
+void SendUi(uint8_t type, uint8_t index);
+void ReceiveUiMessages();
 
 // VARIABLES ------------------------------------------
-DateTime currDateTime;
-bool pump1EnableOn = true;
-bool pump2EnableOn = true;
-bool pump3EnableOn = true;
-bool pump4EnableOn = true;
-bool whiteLedOn = true;
-bool colorLedOn = true;
+RtcDateTime currDateTime;
 bool wakeUp = true;
 bool noBacklight = false;
 unsigned long wakeUpMillis;
-bool warningVolumeBottle = false;
+bool pumpCycleComplete[PUMP_COUNT];
+uint32_t shownSecond;
+uint32_t renderHeapAllocs = 0;
 
 // MENU INTERNALS -------------------------------------
-uint32_t loopStartMs;
+TickType_t loopStartTick;
+TextBuffer text;
 bool updateAllItems;
 bool updateItemValue;
 bool updateValues;
@@ -104,13 +191,16 @@ uint8_t step = 1;
 bool isLongPress = false;
 bool isDoubleClick = false;
 bool isClick = false;
+uint8_t profileLed = 0;
+const char *easingNames[EASING_COUNT] = {"Step  ", "Linear", "Smooth"};
+const char *weatherNames[WEATHER_MODE_COUNT] = {"Off   ", "Clouds", "Storm "};
 
-void InitMenuPage(String title, uint8_t itemCount);
+void InitMenuPage(const char *title, uint8_t itemCount);
 void CaptureButtonDownStates();
 void AdjustBoolean(boolean *v);
 void AdjustUint8_t(uint8_t *v, uint8_t min, uint8_t max);
 void AdjustUint16_t(uint16_t *v, uint16_t min, uint16_t max);
-void AdjustFloat(float *v, float min, float max);
+void AdjustMilli(int32_t *v, int32_t min, int32_t max);
 void AdjustTime(byte *hour, byte *minute);
 void DoPointerNavigation();
 bool IsFlashChanged();
@@ -122,123 +212,77 @@ void IsLongPressStop();
 void IsDoubleClick();
 void IsClick();
 void Functions();
-void CheckPumpOn();
-void CheckLedOn();
-void CheckLedRepeatOn();
+void LedBoards_Init();
+void LedBoards_Flush();
 void WakeUp();
-void VolumeBottle(float *volumeBottle, float volume);
 
 // PRINT TOOLS -------------------------------------
 void PrintPointer();
 void PrintEditPoint();
 void PrintOnOff(bool val);
-void PrintChars(uint8_t cnt, char c);
-uint8_t GetUint32_tCharCnt(uint32_t value);
-uint8_t GetFloatCharCnt(float value);
-String GetTimeString(byte hour, byte minute);
-void PrintUint8_tAtWidth(uint32_t value, uint8_t width, char c, boolean isRight);
-void PrintFloatAtWidth(float value, uint8_t width, char c, boolean isRight);
+void PrintText(TextBuffer &text);
 void PrintTimeString(byte hour, byte minute);
 
-// SETTINGS -------------------------------------
-struct Configuration
-{
-  // WHITE LED
-  uint8_t whiteLed_onTimeHour = 12;
-  uint8_t whiteLed_onTimeMinute = 0;
-  uint8_t whiteLed_offTimeHour = 20;
-  uint8_t whiteLed_offTimeMinute = 0;
-  uint8_t whiteLed_rampUp = 30;
-  uint8_t whiteLed_rampDown = 30;
-  uint8_t whiteLed_maxDuty = 100;
-
-  // COLOR LED
-  uint8_t colorLed_onTimeHour = 12;
-  uint8_t colorLed_onTimeMinute = 0;
-  uint8_t colorLed_offTimeHour = 20;
-  uint8_t colorLed_offTimeMinute = 0;
-  uint8_t colorLed_rampUp = 30;
-  uint8_t colorLed_rampDown = 30;
-  uint8_t colorLed_maxDuty = 100;
-
-  // PUMP 1
-  String pump1_name = "------FE-------";
-  uint8_t pump1_onTimeHour = 12;
-  uint8_t pump1_onTimeMinute = 0;
-  uint8_t pump1_duty = 100;
-  float pump1_volume_bottle = 450;
-  float pump1_volume = 5;
-  float pump1_calibrationOffset = 0;
-  bool pump1_enable = false;
-
-  // PUMP 2
-  String pump2_name = "-----Tropica-------";
-  uint8_t pump2_onTimeHour = 12;
-  uint8_t pump2_onTimeMinute = 0;
-  uint8_t pump2_duty = 100;
-  float pump2_volume_bottle = 450;
-  float pump2_volume = 5;
-  float pump2_calibrationOffset = 0;
-  bool pump2_enable = false;
-
-  // PUMP 3
-  String pump3_name = "-------------------";
-  uint8_t pump3_onTimeHour = 12;
-  uint8_t pump3_onTimeMinute = 0;
-  uint8_t pump3_duty = 100;
-  float pump3_volume_bottle = 450;
-  float pump3_volume = 5;
-  float pump3_calibrationOffset = 0;
-  bool pump3_enable = false;
-
-  // PUMP 4
-  String pump4_name = "--------CO2--------";
-  uint8_t pump4_onTimeHour = 12;
-  uint8_t pump4_onTimeMinute = 0;
-  uint8_t pump4_duty = 100;
-  float pump4_volume_bottle = 450;
-  float pump4_volume = 5;
-  float pump4_calibrationOffset = 0;
-  bool pump4_enable = false;
-
-  // RTC
-  uint16_t years = 2024;
-  uint8_t months = 1;
-  uint8_t days = 1;
-  uint8_t hours = 0;
-  uint8_t minutes = 0;
-};
-
-Configuration _config;
-const char* fileName = "/config.txt";
-void Set_Defaults();
+// CONFIG STORAGE -------------------------------------
+#define CONFIG_BUFFER_SIZE    512
+#define CONFIG_JSON_ARENA_SIZE 3072
+#define CONFIG_SLOT_COUNT     2
+
+const char* slotFileNames[CONFIG_SLOT_COUNT] = {"/config_a.bin", "/config_b.bin"};
+const char* legacyFileName = "/config.bin";
+const char* jsonFileName = "/config.txt";
+const char* inputLogFileName = "/inputs.bin";
+uint8_t configBuffer[CONFIG_BUFFER_SIZE];
+Configuration configSnapshot;
+uint32_t configLoadMicros = 0;
+uint32_t configSaveMicros = 0;
+uint32_t configImportMicros = 0;
+uint16_t configImportPeakBytes = 0;
+uint16_t configSaveBytes = 0;
+bool sdAvailable = false;
+
+// AUTOSAVE -------------------------------------
+#define CONFIG_AUTOSAVE_DELAY_MS  5000
+
+bool Set_Defaults();
+void Storage_Init();
+bool Flash_Load();
+bool Flash_Save();
+bool Flash_SaveDirty();
 void SD_Init();
-void SD_Load();
-void SD_Save();
+bool SD_Begin();
+bool SD_Load();
+bool SD_Save();
+bool SD_WriteConfig(const char *name, uint32_t sequence);
+bool SD_ImportJson(Configuration *config);
+bool SD_ReadJson(Configuration *config, ArenaAllocator *arena);
+bool SD_ReadConfig(const char *name, Configuration *config, uint32_t *sequence);
+int8_t SD_FindSlot(Configuration *config, uint32_t *sequence);
+void Config_SyncTime();
 
 // DISPLAY -------------------------------------
-hd44780_I2Cexp lcd;
+Display lcd;
 byte arrowSymbol[] = 
 {
-  B00000,
-  B00100,
-  B00110,
-  B11111,
-  B00110,
-  B00100,
-  B00000,
-  B00000
+  0b00000,
+  0b00100,
+  0b00110,
+  0b11111,
+  0b00110,
+  0b00100,
+  0b00000,
+  0b00000
  };
 byte editSymbol[] = 
 {
-  B00000,
-  B01110,
-  B10001,
-  B10101,
-  B10001,
-  B01110,
-  B00000,
-  B00000
+  0b00000,
+  0b01110,
+  0b10001,
+  0b10101,
+  0b10001,
+  0b01110,
+  0b00000,
+  0b00000
 };
 
 void LCD_Init();
@@ -248,13 +292,24 @@ void LCD_Init();
 // =======================================================================//
 void setup() 
 {
-  Wire.begin();
-  SPI.begin();
+  HalBegin();
+  PROFILER.Begin(PACING_MS);
   BUZZER.InitBuzzer(BUZZER_PIN);
 
   LCD_Init();
-  SD_Init();
-  analogWriteResolution(12);
+  configMutex = xSemaphoreCreateMutex();
+  Storage_Init();
+  if(LED_DITHER && ledDither.Begin())
+  {
+    whiteLed.SetDither(&ledDither, LED_DITHER_WHITE);
+    colorLed.SetDither(&ledDither, LED_DITHER_COLOR);
+  }
+  else
+  {
+    if(whiteLedDma.Begin()) {whiteLed.SetDma(&whiteLedDma);}
+    if(colorLedDma.Begin()) {colorLed.SetDma(&colorLedDma);}
+  }
+  LedBoards_Init();
 
   btnOk.attachClick(IsClick);
   btnOk.attachDoubleClick(IsDoubleClick);
@@ -262,18 +317,28 @@ void setup()
   btnOk.attachLongPressStop(IsLongPressStop);
 
   encoder = new RotaryEncoder(ENCODER_A, ENCODER_B, RotaryEncoder::LatchMode::TWO03);
-  attachInterrupt(digitalPinToInterrupt(ENCODER_A), CheckPositionEncoder, CHANGE);
-  attachInterrupt(digitalPinToInterrupt(ENCODER_B), CheckPositionEncoder, CHANGE);
+  HalAttachInterrupt(ENCODER_A, CheckPositionEncoder, CHANGE);
+  HalAttachInterrupt(ENCODER_B, CheckPositionEncoder, CHANGE);
 
-  colorLed.SetParameters(_config.colorLed_maxDuty, _config.colorLed_rampUp, _config.colorLed_rampDown);
-  whiteLed.SetParameters(_config.whiteLed_maxDuty, _config.whiteLed_rampUp, _config.whiteLed_rampDown);
-  pump_1.SetParameters(_config.pump1_duty, _config.pump1_volume, _config.pump1_calibrationOffset);
-  pump_2.SetParameters(_config.pump2_duty, _config.pump2_volume, _config.pump2_calibrationOffset);
-  pump_3.SetParameters(_config.pump3_duty, _config.pump3_volume, _config.pump3_calibrationOffset);
-  pump_4.SetParameters(_config.pump4_duty, _config.pump4_volume, _config.pump4_calibrationOffset);
+  controller.ApplyConfig();
 
+  timeRTC.Begin(RTC_SQW_PIN);
   timeRTC.Tick();
-  CheckLedRepeatOn();
+  controller.CheckLedRepeatOn();
+
+#if defined(BENCH)
+  Bench_Run();
+#else
+  controlQueue = xQueueCreate(8, sizeof(ControlCommand));
+  storageQueue = xQueueCreate(4, sizeof(uint8_t));
+  uiQueue = xQueueCreate(8, sizeof(UiMessage));
+  i2cMutex = xSemaphoreCreateMutex();
+
+  xTaskCreate(ControlTask, "Control", CONTROL_TASK_STACK, NULL, CONTROL_TASK_PRIORITY, NULL);
+  xTaskCreate(UiTask, "Ui", UI_TASK_STACK, NULL, UI_TASK_PRIORITY, NULL);
+  xTaskCreate(StorageTask, "Storage", STORAGE_TASK_STACK, NULL, STORAGE_TASK_PRIORITY, NULL);
+  vTaskStartScheduler();
+#endif
 }
 
 // =======================================================================//
@@ -282,175 +347,276 @@ void setup()
 
 void IsLongPressStart()
 {
+  inputLog.Record(INPUT_LONG_PRESS_START, 0, timeRTC.GetUnixTime());
   isLongPress = true;
   wakeUp = true;
 }
 
 void IsLongPressStop()
 {
+  inputLog.Record(INPUT_LONG_PRESS_STOP, 0, timeRTC.GetUnixTime());
   isLongPress = false;
   wakeUp = true;
 }
 
 void IsDoubleClick()
 {
+  inputLog.Record(INPUT_DOUBLE_CLICK, 0, timeRTC.GetUnixTime());
   isDoubleClick = true;
   wakeUp = true;
 }
 
 void IsClick()
 {
+  inputLog.Record(INPUT_CLICK, 0, timeRTC.GetUnixTime());
   isClick = true;
   wakeUp = true;
 }
 
 // =======================================================================//
-//                                  LOOP                                  //
+//                                  TASKS                                 //
 // =======================================================================//
-void loop() 
+void ControlTask(void *parameters)
 {
-  switch (currPage)
+  TickType_t lastWakeTick = xTaskGetTickCount();
+  ControlCommand command;
+
+  while (true)
   {
-    case MENU_HOME: Page_MenuHome(); break;
-    case MENU_MAIN: Page_MenuMain(); break;
-    case MENU_LED_WHITE: Page_MenuLedWhite(); break;
-    case MENU_LED_COLOR: Page_MenuLedColor(); break;
-    case MENU_PUMP_1: Page_Pump_1(); break;
-    case MENU_PUMP_1_CALIBRATION: Page_Pump_1_Calibration(); break;
-    case MENU_PUMP_2: Page_Pump_2(); break;
-    case MENU_PUMP_2_CALIBRATION: Page_Pump_2_Calibration(); break;
-    case MENU_PUMP_3: Page_Pump_3(); break;
-    case MENU_PUMP_3_CALIBRATION: Page_Pump_3_Calibration(); break;
-    case MENU_PUMP_4: Page_Pump_4(); break;
-    case MENU_PUMP_4_CALIBRATION: Page_Pump_4_Calibration(); break;
-    case MENU_SETTINGS: Page_MenuSettings(); break;
+    PROFILER.MarkPeriod();
+
+    xSemaphoreTake(configMutex, portMAX_DELAY);
+    while(xQueueReceive(controlQueue, &command, 0) == pdTRUE)
+    {
+      controller.DoCommand(command);
+    }
+    xSemaphoreGive(configMutex);
+
+    Functions();
+    BUZZER.Tick();
+    vTaskDelayUntil(&lastWakeTick, pdMS_TO_TICKS(PACING_MS));
   }
 }
 
-// =======================================================================//
-//                                FUNCTIONS                               //
-// =======================================================================//
-void Functions()
+void UiTask(void *parameters)
 {
-  timeRTC.Tick();
-  currDateTime = timeRTC.GetDateTime();
-  whiteLed.Tick();
-  colorLed.Tick();
-  pump_1.Tick();
-  pump_2.Tick();
-  pump_3.Tick();
-  pump_4.Tick();
+  PROFILER.Start(PROFILE_LCD);
 
-  CheckPumpOn();
-  CheckLedOn();
-  CheckLedRepeatOn();
+  while (true)
+  {
+    switch (currPage)
+    {
+      case MENU_HOME: Page_MenuHome(); break;
+      case MENU_MAIN: Page_MenuMain(); break;
+      case MENU_LED_WHITE: Page_MenuLedWhite(); break;
+      case MENU_LED_COLOR: Page_MenuLedColor(); break;
+      case MENU_LED_PROFILE: Page_MenuLedProfile(); break;
+      case MENU_PUMP_1: Page_Pump_1(); break;
+      case MENU_PUMP_1_CALIBRATION: Page_Pump_1_Calibration(); break;
+      case MENU_PUMP_2: Page_Pump_2(); break;
+      case MENU_PUMP_2_CALIBRATION: Page_Pump_2_Calibration(); break;
+      case MENU_PUMP_3: Page_Pump_3(); break;
+      case MENU_PUMP_3_CALIBRATION: Page_Pump_3_Calibration(); break;
+      case MENU_PUMP_4: Page_Pump_4(); break;
+      case MENU_PUMP_4_CALIBRATION: Page_Pump_4_Calibration(); break;
+      case MENU_SETTINGS: Page_MenuSettings(); break;
+      case MENU_DIAGNOSTICS: Page_MenuDiagnostics(); break;
+    }
+  }
 }
 
-void CheckPumpOn()
+void StorageTask(void *parameters)
 {
-  // PUMP 1 CHECK START
-  if(_config.pump1_enable && pump1EnableOn && timeRTC.IsTime(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.pump1_onTimeHour, _config.pump1_onTimeMinute, 0)))
-  {
-    pump1EnableOn = false;
-    pump_1.Start();
-    VolumeBottle(&_config.pump1_volume_bottle, _config.pump1_volume);
-  }
-  else if(!pump1EnableOn && timeRTC.IsTimeLower(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.pump1_onTimeHour, _config.pump1_onTimeMinute, 0)))
-  {
-    pump1EnableOn = true;
-  }
+  uint8_t command;
+  bool isDone;
 
-  // PUMP 2 CHECK START
-  if(_config.pump2_enable && pump2EnableOn && timeRTC.IsTime(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.pump2_onTimeHour, _config.pump2_onTimeMinute, 0)))
-  {
-    pump2EnableOn = false;
-    pump_2.Start();
-    VolumeBottle(&_config.pump2_volume_bottle, _config.pump2_volume);
-  }
-  else if(!pump2EnableOn && timeRTC.IsTimeLower(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.pump2_onTimeHour, _config.pump2_onTimeMinute, 0)))
+  while (true)
   {
-    pump2EnableOn = true;
-  }
+    if(xQueueReceive(storageQueue, &command, pdMS_TO_TICKS(STORAGE_POLL_MS)) != pdTRUE)
+    {
+      // Autosave once the edits have settled
+      if(Config_IsDirty() && HalMillis() - configDirtyMillis >= CONFIG_AUTOSAVE_DELAY_MS && !Flash_SaveDirty())
+      {
+        configDirtyMillis = HalMillis();
+        SendUi(UI_STORAGE_FAILED, 0);
+      }
 
-  // PUMP 3 CHECK START
-  if(_config.pump3_enable && pump3EnableOn && timeRTC.IsTime(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.pump3_onTimeHour, _config.pump3_onTimeMinute, 0)))
-  {
-    pump3EnableOn = false;
-    pump_3.Start();
-    VolumeBottle(&_config.pump3_volume_bottle, _config.pump3_volume);
-  }
-  else if(!pump3EnableOn && timeRTC.IsTimeLower(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.pump3_onTimeHour, _config.pump3_onTimeMinute, 0)))
-  {
-    pump3EnableOn = true;
-  }
+      continue;
+    }
 
-  // PUMP 4 CHECK START
-  if(_config.pump4_enable && pump4EnableOn && timeRTC.IsTime(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.pump4_onTimeHour, _config.pump4_onTimeMinute, 0)))
-  {
-    pump4EnableOn = false;
-    pump_4.Start();
-    VolumeBottle(&_config.pump4_volume_bottle, _config.pump4_volume);
-  }
-  else if(!pump4EnableOn && timeRTC.IsTimeLower(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.pump4_onTimeHour, _config.pump4_onTimeMinute, 0)))
-  {
-    pump4EnableOn = true;
+    switch (command)
+    {
+      case STORAGE_SAVE:
+        SendUi(Flash_SaveDirty() ? UI_STORAGE_SAVED : UI_STORAGE_FAILED, 0);
+        break;
+      case STORAGE_SET_DEFAULTS:
+        SendUi(Set_Defaults() ? UI_DEFAULTS_SET : UI_STORAGE_FAILED, 0);
+        SendControl(CONTROL_APPLY_CONFIG, 0);
+        break;
+      case STORAGE_IMPORT:
+        PROFILER.Start(PROFILE_SD);
+        isDone = SD_Begin() && SD_Load();
+        PROFILER.Stop(PROFILE_SD);
+        if(isDone)
+        {
+          Flash_Save();
+          SendUi(UI_SD_IMPORTED, 0);
+          SendControl(CONTROL_APPLY_CONFIG, 0);
+        }
+        else
+        {
+          SendUi(UI_SD_FAILED, 0);
+        }
+        break;
+      case STORAGE_EXPORT:
+        PROFILER.Start(PROFILE_SD);
+        isDone = SD_Begin() && SD_Save() && inputLog.Save(inputLogFileName);
+        PROFILER.Stop(PROFILE_SD);
+        SendUi(isDone ? UI_SD_EXPORTED : UI_SD_FAILED, 0);
+        break;
+    }
   }
+}
 
-  // SAVE CONFIG PARAMETERS DUE PUMP VOLUME LEVEL CHANGED
-  if(timeRTC.IsTime(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.pump4_onTimeHour, _config.pump4_onTimeMinute + 5, 0)))
-  {
-    SD_Save();
-  }
+void SendControl(uint8_t type, uint8_t index, uint8_t duty, int32_t value)
+{
+  ControlCommand command = {type, index, duty, value};
+  xQueueSend(controlQueue, &command, 0);
 }
 
-void CheckLedOn()
+void SendStorage(uint8_t type)
 {
-  // COLOR LED CHECK START
-  if(colorLedOn && timeRTC.IsTime(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.colorLed_onTimeHour, _config.colorLed_onTimeMinute, 0)))
-  {
-    colorLedOn = false;
-    colorLed.Start();
-  }
+  xQueueSend(storageQueue, &type, 0);
+}
 
-  // COLOR LED CHECK STOP
-  if(!colorLedOn && timeRTC.IsTime(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.colorLed_offTimeHour, _config.colorLed_offTimeMinute, 0)))
+void SendUi(uint8_t type, uint8_t index)
+{
+  UiMessage message = {type, index};
+  xQueueSend(uiQueue, &message, 0);
+}
+
+void ReceiveUiMessages()
+{
+  UiMessage message;
+
+  while(xQueueReceive(uiQueue, &message, 0) == pdTRUE)
   {
-    colorLedOn = true;
-    colorLed.Stop();
+    switch (message.type)
+    {
+      case UI_STORAGE_SAVED:
+        BUZZER.Long();
+        break;
+      case UI_STORAGE_FAILED:
+        lcd.setCursor(0, 0);
+        lcd.print(F("Write To File Failed"));
+        BUZZER.Long();
+        break;
+      case UI_DEFAULTS_SET:
+      case UI_SD_IMPORTED:
+        updateAllItems = true;
+        BUZZER.Long();
+        break;
+      case UI_SD_EXPORTED:
+        BUZZER.Long();
+        break;
+      case UI_SD_FAILED:
+        lcd.setCursor(0, 0);
+        lcd.print(F("SD Card Failed!     "));
+        BUZZER.Long();
+        break;
+      case UI_PUMP_CYCLE_COMPLETE:
+        pumpCycleComplete[message.index] = true;
+        break;
+    }
   }
+}
 
-  // WHITE LED CHECK START
-  if(whiteLedOn && timeRTC.IsTime(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.whiteLed_onTimeHour, _config.whiteLed_onTimeMinute, 0)))
+// =======================================================================//
+//                                  LOOP                                  //
+// =======================================================================//
+void loop() 
+{
+  // Never reached, the scheduler owns the CPU after setup()
+}
+
+// =======================================================================//
+//                                FUNCTIONS                               //
+// =======================================================================//
+void Functions()
+{
+  // Only a Tick() under i2cMutex may read the RTC, a pulse landing after the
+  // check below is counted now and read with the lock next period
+  bool isBusLocked = timeRTC.IsSyncRequired() && xSemaphoreTake(i2cMutex, pdMS_TO_TICKS(PACING_MS)) == pdTRUE;
+  PROFILER.Start(PROFILE_RTC);
+  timeRTC.Tick(isBusLocked);
+  PROFILER.Stop(PROFILE_RTC);
+  if(isBusLocked) {xSemaphoreGive(i2cMutex);}
+
+  currDateTime = timeRTC.GetDateTime();
+  xSemaphoreTake(configMutex, portMAX_DELAY);
+  controller.Tick();
+  xSemaphoreGive(configMutex);
+  LedBoards_Flush();
+
+  for(uint8_t i = 0; i < PUMP_COUNT; i++)
   {
-    whiteLedOn = false;
-    whiteLed.Start();
+    if(pumps[i]->IsCycleComplete())
+    {
+      SendUi(UI_PUMP_CYCLE_COMPLETE, i);
+    }
   }
+}
 
-  // WHITE LED CHECK STOP
-  if(!whiteLedOn && timeRTC.IsTime(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.whiteLed_offTimeHour, _config.whiteLed_offTimeMinute, 0)))
+// LED BOARDS ---------------------------------
+// Every channel of a board that answers becomes a Led in its schedule group.
+// Built once at boot, so the heap holds them for good
+void LedBoards_Init()
+{
+#if PCA9685_BOARDS > 0
+  for(uint8_t board = 0; board < PCA9685_BOARDS; board++)
   {
-    whiteLedOn = true;
-    whiteLed.Stop();
+    if(!ledBoards[board].Begin(HAL_EXPANDER_ADDRESS + board))
+    {
+      continue;
+    }
+
+    for(uint8_t channel = 0; channel < PCA9685_CHANNELS; channel++)
+    {
+      bool isColor = (PCA9685_COLOR_CHANNELS >> channel) & 1;
+      Led *led = new Led(&ledBoards[board], channel, isColor ? LedCurve<LED_COLOR_GAMMA>::Get() : LedCurve<LED_WHITE_GAMMA>::Get());
+      controller.AttachLed(led, isColor ? LED_GROUP_COLOR : LED_GROUP_WHITE);
+    }
   }
+#endif
 }
 
-void CheckLedRepeatOn()
+// Led writes only change the board shadows. One board per control period
+// gets its changes as one posted burst, the previous burst is off the bus by
+// then, and each board sees a frame every LED_BOARD_FRAME_MS
+void LedBoards_Flush()
 {
-  if(colorLedOn 
-  && (timeRTC.IsTimeGreater(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.colorLed_onTimeHour, _config.colorLed_onTimeMinute, 0)) 
-  && timeRTC.IsTimeLower(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.colorLed_offTimeHour, _config.colorLed_offTimeMinute, 0))))
+#if PCA9685_BOARDS > 0
+  if(HalMillis() - ledBoardMillis < LED_BOARD_FRAME_MS / PCA9685_BOARDS)
   {
-    colorLedOn = false;
-    colorLed.Enable();
+    return;
   }
 
-  if(whiteLedOn 
-  && (timeRTC.IsTimeGreater(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.whiteLed_onTimeHour, _config.whiteLed_onTimeMinute, 0)) 
-  && timeRTC.IsTimeLower(DateTime(currDateTime.year(), currDateTime.month(), currDateTime.day(), _config.whiteLed_offTimeHour, _config.whiteLed_offTimeMinute, 0))))
+  if(ledBoards[ledBoardNext].IsDirty())
   {
-    whiteLedOn = false;
-    whiteLed.Enable();
+    if(xSemaphoreTake(i2cMutex, pdMS_TO_TICKS(PACING_MS)) != pdTRUE)
+    {
+      return;
+    }
+
+    PROFILER.Start(PROFILE_LED);
+    ledBoards[ledBoardNext].Flush();
+    PROFILER.Stop(PROFILE_LED);
+    xSemaphoreGive(i2cMutex);
   }
+
+  ledBoardMillis = HalMillis();
+  ledBoardNext = (ledBoardNext + 1) % PCA9685_BOARDS;
+#endif
 }
 
 void WakeUp()
@@ -459,23 +625,23 @@ void WakeUp()
   {
     wakeUp = false;
     noBacklight = true;
-    wakeUpMillis = millis();
+    wakeUpMillis = HalMillis();
     lcd.backlight();
     return;
   }
 
-  if(noBacklight && millis() - wakeUpMillis >= (BACKLIGHT * 1000))
+  if(noBacklight && HalMillis() - wakeUpMillis >= (BACKLIGHT * 1000))
   {
     noBacklight = false;
     lcd.noBacklight();
   }
 
-  if(currPage != MENU_HOME && millis() - wakeUpMillis >= (WAKEUP * 1000))
+  if(currPage != MENU_HOME && HalMillis() - wakeUpMillis >= (WAKEUP * 1000))
   {
     currPage = MENU_HOME;
     root_pntrPos = 1; 
     root_dispOffset = 0;
-    loop();
+    editMode = false;
   }
 }
 
@@ -486,44 +652,12 @@ void Page_MenuHome()
 {
   InitMenuPage(timeRTC.GetCurrentTimeStr(), 22);
 
-  while (true)
+  while (currPage == MENU_HOME)
   {
-    Functions();
-    BUZZER.Tick();
-
-    if(timeRTC.IsTimeUpdated() || updateAllItems)
+    if(timeRTC.GetSecondOfDay() != shownSecond || updateAllItems)
     {
-      lcd.setCursor(1, 0);
-      lcd.print(timeRTC.GetCurrentTimeStr() + "-");
-
-      if(warningVolumeBottle)
-      {
-        if(MenuItemPrintable(1, 2)) {lcd.print("Low Level Bottle!");}
-        return;
-      }
-
-      if(MenuItemPrintable(1, 1)) {lcd.print("Led White On " + GetTimeString(_config.whiteLed_onTimeHour, _config.whiteLed_onTimeMinute) + " ");}
-      if(MenuItemPrintable(1, 2)) {lcd.print("Led White Off " + GetTimeString(_config.whiteLed_offTimeHour, _config.whiteLed_offTimeMinute));}
-      if(MenuItemPrintable(1, 3)) {lcd.print("Led White Duty " + String(whiteLed.GetCurrentDuty()) + "%  ");}
-      if(MenuItemPrintable(1, 4)) {lcd.print("Led Color On " + GetTimeString(_config.colorLed_onTimeHour, _config.colorLed_onTimeMinute)  + " ");}
-      if(MenuItemPrintable(1, 5)) {lcd.print("Led Color Off " + GetTimeString(_config.colorLed_offTimeHour, _config.colorLed_offTimeMinute));}
-      if(MenuItemPrintable(1, 6)) {lcd.print("Led Color Duty "  + String(colorLed.GetCurrentDuty()) + "%  ");}
-      if(MenuItemPrintable(1, 7)) {lcd.print(_config.pump1_name);}
-      if(MenuItemPrintable(1, 8)) {lcd.print("Pump 1 On " + GetTimeString(_config.pump1_onTimeHour, _config.pump1_onTimeMinute) + "  ");}
-      if(MenuItemPrintable(1, 9)) {lcd.print("Pump 1 " + String(_config.pump1_volume) + "ml   ");}
-      if(MenuItemPrintable(1, 10)) {lcd.print("Volume Bottle: " + String(_config.pump1_volume_bottle) + "ml");}
-      if(MenuItemPrintable(1, 11)) {lcd.print(_config.pump2_name);}
-      if(MenuItemPrintable(1, 12)) {lcd.print("Pump 2 On " + GetTimeString(_config.pump2_onTimeHour, _config.pump2_onTimeMinute) + "  ");}
-      if(MenuItemPrintable(1, 13)){lcd.print("Pump 2 " + String(_config.pump2_volume) + "ml   ");}
-      if(MenuItemPrintable(1, 14)) {lcd.print("Volume Bottle: " + String(_config.pump2_volume_bottle) + "ml");}
-      if(MenuItemPrintable(1, 15)) {lcd.print(_config.pump3_name);}
-      if(MenuItemPrintable(1, 16)){lcd.print("Pump 3 On " + GetTimeString(_config.pump3_onTimeHour, _config.pump3_onTimeMinute) + "  ");}
-      if(MenuItemPrintable(1, 17)){lcd.print("Pump 3 " + String(_config.pump3_volume) + "ml   ");}
-      if(MenuItemPrintable(1, 18)) {lcd.print("Volume Bottle: " + String(_config.pump3_volume_bottle) + "ml");}
-      if(MenuItemPrintable(1, 19)) {lcd.print(_config.pump4_name);}
-      if(MenuItemPrintable(1, 20)){lcd.print("Pump 4 On " + GetTimeString(_config.pump4_onTimeHour, _config.pump4_onTimeMinute) + "  ");}
-      if(MenuItemPrintable(1, 21)){lcd.print("Pump 4 " + String(_config.pump4_volume) + "ml   ");}
-      if(MenuItemPrintable(1, 22)) {lcd.print("Volume Bottle: " + String(_config.pump4_volume_bottle) + "ml");}
+      shownSecond = timeRTC.GetSecondOfDay();
+      if(!MenuHome_Render()) {return;}
     }
 
     if(IsFlashChanged())
@@ -537,8 +671,8 @@ void Page_MenuHome()
     {
       isLongPress = false;
       BUZZER.Double();
-      whiteLed.Manual();
-      colorLed.Manual();
+      SendControl(CONTROL_LED_MANUAL, 0);
+      SendControl(CONTROL_LED_MANUAL, 1);
     }
 
     if(isClick)
@@ -554,17 +688,56 @@ void Page_MenuHome()
   }
 }
 
+// Home screen rows, false while the bottle warning replaces them
+bool MenuHome_Render()
+{
+  uint32_t heapAllocs = GetHeapAllocCount();
+  lcd.setCursor(1, 0);
+  PrintText(text.Clear().Append(timeRTC.GetCurrentTimeStr()).Append("-"));
+
+  if(controller.IsBottleWarning())
+  {
+    if(MenuItemPrintable(1, 2)) {lcd.print("Low Level Bottle!");}
+    return false;
+  }
+
+  if(MenuItemPrintable(1, 1)) {PrintText(text.Clear().Append("Led White On ").AppendTime(_config.whiteLed_onTimeHour, _config.whiteLed_onTimeMinute).Append(" "));}
+  if(MenuItemPrintable(1, 2)) {PrintText(text.Clear().Append("Led White Off ").AppendTime(_config.whiteLed_offTimeHour, _config.whiteLed_offTimeMinute));}
+  if(MenuItemPrintable(1, 3)) {PrintText(text.Clear().Append("Led White Duty ").AppendUint(whiteLed.GetCurrentDuty()).Append("%  "));}
+  if(MenuItemPrintable(1, 4)) {PrintText(text.Clear().Append("Led Color On ").AppendTime(_config.colorLed_onTimeHour, _config.colorLed_onTimeMinute).Append(" "));}
+  if(MenuItemPrintable(1, 5)) {PrintText(text.Clear().Append("Led Color Off ").AppendTime(_config.colorLed_offTimeHour, _config.colorLed_offTimeMinute));}
+  if(MenuItemPrintable(1, 6)) {PrintText(text.Clear().Append("Led Color Duty ").AppendUint(colorLed.GetCurrentDuty()).Append("%  "));}
+  if(MenuItemPrintable(1, 7)) {lcd.print(_config.pump1_name);}
+  if(MenuItemPrintable(1, 8)) {PrintText(text.Clear().Append("Pump 1 On ").AppendTime(_config.pump1_onTimeHour, _config.pump1_onTimeMinute).Append("  "));}
+  if(MenuItemPrintable(1, 9)) {PrintText(text.Clear().Append("Pump 1 ").AppendFixed(_config.pump1_volume / 10, 2).Append("ml   "));}
+  if(MenuItemPrintable(1, 10)) {PrintText(text.Clear().Append("Volume Bottle: ").AppendFixed(_config.pump1_volume_bottle / 10, 2).Append("ml"));}
+  if(MenuItemPrintable(1, 11)) {lcd.print(_config.pump2_name);}
+  if(MenuItemPrintable(1, 12)) {PrintText(text.Clear().Append("Pump 2 On ").AppendTime(_config.pump2_onTimeHour, _config.pump2_onTimeMinute).Append("  "));}
+  if(MenuItemPrintable(1, 13)){PrintText(text.Clear().Append("Pump 2 ").AppendFixed(_config.pump2_volume / 10, 2).Append("ml   "));}
+  if(MenuItemPrintable(1, 14)) {PrintText(text.Clear().Append("Volume Bottle: ").AppendFixed(_config.pump2_volume_bottle / 10, 2).Append("ml"));}
+  if(MenuItemPrintable(1, 15)) {lcd.print(_config.pump3_name);}
+  if(MenuItemPrintable(1, 16)){PrintText(text.Clear().Append("Pump 3 On ").AppendTime(_config.pump3_onTimeHour, _config.pump3_onTimeMinute).Append("  "));}
+  if(MenuItemPrintable(1, 17)){PrintText(text.Clear().Append("Pump 3 ").AppendFixed(_config.pump3_volume / 10, 2).Append("ml   "));}
+  if(MenuItemPrintable(1, 18)) {PrintText(text.Clear().Append("Volume Bottle: ").AppendFixed(_config.pump3_volume_bottle / 10, 2).Append("ml"));}
+  if(MenuItemPrintable(1, 19)) {lcd.print(_config.pump4_name);}
+  if(MenuItemPrintable(1, 20)){PrintText(text.Clear().Append("Pump 4 On ").AppendTime(_config.pump4_onTimeHour, _config.pump4_onTimeMinute).Append("  "));}
+  if(MenuItemPrintable(1, 21)){PrintText(text.Clear().Append("Pump 4 ").AppendFixed(_config.pump4_volume / 10, 2).Append("ml   "));}
+  if(MenuItemPrintable(1, 22)) {PrintText(text.Clear().Append("Volume Bottle: ").AppendFixed(_config.pump4_volume_bottle / 10, 2).Append("ml"));}
+  renderHeapAllocs += GetHeapAllocCount() - heapAllocs;
+  return true;
+}
+
 // =======================================================================//
 //                                MENU MAIN                               //
 // =======================================================================//
 void Page_MenuMain()
 {
-  InitMenuPage(F("Main Menu"), 8);
+  InitMenuPage("Main Menu", 9);
 
   pntrPos = root_pntrPos;
   dispOffset = root_dispOffset;
 
-  while (true)
+  while (currPage == MENU_MAIN)
   {
     if(updateAllItems)
     {
@@ -575,7 +748,8 @@ void Page_MenuMain()
       if(MenuItemPrintable(1, 5)){lcd.print("Pump #3 Menu       ");}
       if(MenuItemPrintable(1, 6)){lcd.print("Pump #4 Menu       ");}
       if(MenuItemPrintable(1, 7)){lcd.print("Settings           ");}
-      if(MenuItemPrintable(1, 8)){lcd.print("Back               ");}
+      if(MenuItemPrintable(1, 8)){lcd.print("Diagnostics        ");}
+      if(MenuItemPrintable(1, 9)){lcd.print("Back               ");}
     }
 
     if(IsFlashChanged())
@@ -602,7 +776,8 @@ void Page_MenuMain()
         case 5: currPage = MENU_PUMP_3; return;
         case 6: currPage = MENU_PUMP_4; return;
         case 7: currPage = MENU_SETTINGS; return;
-        case 8: currPage = MENU_HOME; root_pntrPos = 1; root_dispOffset = 0; return;
+        case 8: currPage = MENU_DIAGNOSTICS; return;
+        case 9: currPage = MENU_HOME; root_pntrPos = 1; root_dispOffset = 0; return;
       }
     }
 
@@ -616,9 +791,9 @@ void Page_MenuMain()
 // =======================================================================//
 void Page_MenuLedWhite()
 {
-  InitMenuPage(F("Led White"), 7);
+  InitMenuPage("Led White", 8);
 
-  while (true)
+  while (currPage == MENU_LED_WHITE)
   {
     if(updateAllItems)
     {
@@ -627,22 +802,24 @@ void Page_MenuLedWhite()
       if(MenuItemPrintable(1, 3)){lcd.print("Ramp Up:           ");}
       if(MenuItemPrintable(1, 4)){lcd.print("Ramp Down:         ");}
       if(MenuItemPrintable(1, 5)){lcd.print("Max Duty:          ");}
-      if(MenuItemPrintable(1, 6)){lcd.print("Save               ");}
-      if(MenuItemPrintable(1, 7)){lcd.print("Back               ");}
+      if(MenuItemPrintable(1, 6)){lcd.print("Profile:           ");}
+      if(MenuItemPrintable(1, 7)){lcd.print("Save               ");}
+      if(MenuItemPrintable(1, 8)){lcd.print("Back               ");}
     }
 
     if(updateAllItems || updateItemValue)
     {
       if(MenuItemPrintable(10, 1)){PrintTimeString(_config.whiteLed_onTimeHour, _config.whiteLed_onTimeMinute);}
       if(MenuItemPrintable(11, 2)){PrintTimeString(_config.whiteLed_offTimeHour, _config.whiteLed_offTimeMinute);}
-      if(MenuItemPrintable(10, 3)){PrintUint8_tAtWidth(_config.whiteLed_rampUp, 1, ' ', false); lcd.print("min ");}
-      if(MenuItemPrintable(12, 4)){PrintUint8_tAtWidth(_config.whiteLed_rampDown, 1, ' ', false); lcd.print("min ");}
-      if(MenuItemPrintable(11, 5)){PrintUint8_tAtWidth(_config.whiteLed_maxDuty, 1, ' ', false); lcd.print("% ");}
+      if(MenuItemPrintable(10, 3)){PrintText(text.Clear().AppendUint(_config.whiteLed_rampUp).Append("min "));}
+      if(MenuItemPrintable(12, 4)){PrintText(text.Clear().AppendUint(_config.whiteLed_rampDown).Append("min "));}
+      if(MenuItemPrintable(11, 5)){PrintText(text.Clear().AppendUint(_config.whiteLed_maxDuty).Append("% "));}
+      if(MenuItemPrintable(10, 6)){PrintOnOff(IsProfileUsed(_config.whiteLed_keyframes));}
     }
 
     if(updateValues)
     {
-      whiteLed.SetParameters(_config.whiteLed_maxDuty, _config.whiteLed_rampUp, _config.whiteLed_rampDown);
+      SendControl(CONTROL_APPLY_CONFIG, 0);
     }
 
     if(IsFlashChanged())
@@ -669,19 +846,22 @@ void Page_MenuLedWhite()
       switch (pntrPos)
       {
         case 6: 
-          BUZZER.Long();
-          SD_Save(); 
-          BUZZER.Long();
-          Page_MenuLedWhite();
+          profileLed = 0;
+          currPage = MENU_LED_PROFILE; 
+          BUZZER.Double();
           return;
         case 7: 
+          BUZZER.Long();
+          SendStorage(STORAGE_SAVE);
+          break;
+        case 8: 
           currPage = MENU_MAIN; 
           BUZZER.Double();
           return;
       }
     }
 
-    if(isLongPress && !(pntrPos == 6 || pntrPos == 7))
+    if(isLongPress && !(pntrPos == 6 || pntrPos == 7 || pntrPos == 8))
     {
       isLongPress = false;
       updateValues = true;
@@ -704,7 +884,7 @@ void Page_MenuLedWhite()
         case 2: AdjustTime(&_config.whiteLed_offTimeHour, &_config.whiteLed_offTimeMinute); break;
         case 3: AdjustUint8_t(&_config.whiteLed_rampUp, 1, 180); break;
         case 4: AdjustUint8_t(&_config.whiteLed_rampDown, 1, 180); break;
-        case 5: AdjustUint8_t(&_config.whiteLed_maxDuty, 1, 100); whiteLed.UpdateDuty(_config.whiteLed_maxDuty); break;
+        case 5: AdjustUint8_t(&_config.whiteLed_maxDuty, 1, 100); if(updateItemValue) {SendControl(CONTROL_LED_DUTY, 0, _config.whiteLed_maxDuty);} break;
       }
 
       encoder->setPosition(0);
@@ -723,9 +903,9 @@ void Page_MenuLedWhite()
 // =======================================================================//
 void Page_MenuLedColor()
 {
-  InitMenuPage(F("Led Color"), 7);
+  InitMenuPage("Led Color", 8);
 
-  while (true)
+  while (currPage == MENU_LED_COLOR)
   {
     if(updateAllItems)
     {
@@ -734,22 +914,24 @@ void Page_MenuLedColor()
       if(MenuItemPrintable(1, 3)){lcd.print("Ramp Up:           ");}
       if(MenuItemPrintable(1, 4)){lcd.print("Ramp Down:         ");}
       if(MenuItemPrintable(1, 5)){lcd.print("Max Duty:          ");}
-      if(MenuItemPrintable(1, 6)){lcd.print("Save               ");}
-      if(MenuItemPrintable(1, 7)){lcd.print("Back               ");}
+      if(MenuItemPrintable(1, 6)){lcd.print("Profile:           ");}
+      if(MenuItemPrintable(1, 7)){lcd.print("Save               ");}
+      if(MenuItemPrintable(1, 8)){lcd.print("Back               ");}
     }
 
     if(updateAllItems || updateItemValue)
     {
       if(MenuItemPrintable(10, 1)){PrintTimeString(_config.colorLed_onTimeHour, _config.colorLed_onTimeMinute);}
       if(MenuItemPrintable(11, 2)){PrintTimeString(_config.colorLed_offTimeHour, _config.colorLed_offTimeMinute);}
-      if(MenuItemPrintable(10, 3)){PrintUint8_tAtWidth(_config.colorLed_rampUp, 1, ' ', false); lcd.print("min ");}
-      if(MenuItemPrintable(12, 4)){PrintUint8_tAtWidth(_config.colorLed_rampDown, 1, ' ', false); lcd.print("min ");}
-      if(MenuItemPrintable(11, 5)){PrintUint8_tAtWidth(_config.colorLed_maxDuty, 1, ' ', false); lcd.print("% ");}
+      if(MenuItemPrintable(10, 3)){PrintText(text.Clear().AppendUint(_config.colorLed_rampUp).Append("min "));}
+      if(MenuItemPrintable(12, 4)){PrintText(text.Clear().AppendUint(_config.colorLed_rampDown).Append("min "));}
+      if(MenuItemPrintable(11, 5)){PrintText(text.Clear().AppendUint(_config.colorLed_maxDuty).Append("% "));}
+      if(MenuItemPrintable(10, 6)){PrintOnOff(IsProfileUsed(_config.colorLed_keyframes));}
     }
 
     if(updateValues)
     {
-      colorLed.SetParameters(_config.colorLed_maxDuty, _config.colorLed_rampUp, _config.colorLed_rampDown);
+      SendControl(CONTROL_APPLY_CONFIG, 0);
     }
 
     if(IsFlashChanged())
@@ -776,19 +958,22 @@ void Page_MenuLedColor()
       switch (pntrPos)
       {
         case 6: 
+          profileLed = 1;
+          currPage = MENU_LED_PROFILE; 
+          BUZZER.Double();
+          return;
+        case 7: 
           BUZZER.Long();
-          SD_Save(); 
-          BUZZER.Long();
-          Page_MenuLedColor();
+          SendStorage(STORAGE_SAVE);
           break;
-        case 7: 
+        case 8: 
           currPage = MENU_MAIN; 
           BUZZER.Double();
           return;
       }
     }
 
-    if(isLongPress && !(pntrPos == 6 || pntrPos == 7))
+    if(isLongPress && !(pntrPos == 6 || pntrPos == 7 || pntrPos == 8))
     {
       isLongPress = false;
       updateValues = true;
@@ -811,7 +996,7 @@ void Page_MenuLedColor()
         case 2: AdjustTime(&_config.colorLed_offTimeHour, &_config.colorLed_offTimeMinute); break;
         case 3: AdjustUint8_t(&_config.colorLed_rampUp, 1, 120); break;
         case 4: AdjustUint8_t(&_config.colorLed_rampDown, 1, 120); break;
-        case 5: AdjustUint8_t(&_config.colorLed_maxDuty, 1, 100); colorLed.UpdateDuty(_config.colorLed_maxDuty); break;
+        case 5: AdjustUint8_t(&_config.colorLed_maxDuty, 1, 100); if(updateItemValue) {SendControl(CONTROL_LED_DUTY, 1, _config.colorLed_maxDuty);} break;
       }
 
       encoder->setPosition(0);
@@ -825,14 +1010,147 @@ void Page_MenuLedColor()
   }
 }
 
+// =======================================================================//
+//                              MENU LED PROFILE                          //
+// =======================================================================//
+void Page_MenuLedProfile()
+{
+  uint32_t *keyframes = (profileLed == 0) ? _config.whiteLed_keyframes : _config.colorLed_keyframes;
+  uint8_t frame = 1;
+  byte hour, minute;
+  uint8_t level, easing;
+  bool isUsed = LightProfile::Unpack(keyframes[0], &hour, &minute, &level, &easing);
+
+  InitMenuPage((profileLed == 0) ? "White Profile" : "Color Profile", 7);
+
+  while (currPage == MENU_LED_PROFILE)
+  {
+    if(updateAllItems)
+    {
+      if(MenuItemPrintable(1, 1)){lcd.print("Frame:             ");}
+      if(MenuItemPrintable(1, 2)){lcd.print("Time:              ");}
+      if(MenuItemPrintable(1, 3)){lcd.print("Level:             ");}
+      if(MenuItemPrintable(1, 4)){lcd.print("Ease:              ");}
+      if(MenuItemPrintable(1, 5)){lcd.print("Use:               ");}
+      if(MenuItemPrintable(1, 6)){lcd.print("Save               ");}
+      if(MenuItemPrintable(1, 7)){lcd.print("Back               ");}
+    }
+
+    if(updateAllItems || updateItemValue)
+    {
+      if(MenuItemPrintable(8, 1)){PrintText(text.Clear().AppendUint(frame).Append("/").AppendUint(CONFIG_LED_KEYFRAMES).Append(" "));}
+      if(MenuItemPrintable(7, 2)){PrintTimeString(hour, minute);}
+      if(MenuItemPrintable(8, 3)){PrintText(text.Clear().AppendUint(level).Append("% "));}
+      if(MenuItemPrintable(7, 4)){PrintText(text.Clear().Append(easingNames[easing]));}
+      if(MenuItemPrintable(6, 5)){PrintOnOff(isUsed);}
+    }
+
+    if(updateValues)
+    {
+      SendControl(CONTROL_APPLY_CONFIG, 0);
+    }
+
+    if(IsFlashChanged())
+    {
+      if(editMode)
+      {
+        PrintEditPoint();
+      }
+      else
+      {
+        PrintPointer();
+      }
+    }
+
+    updateAllItems = false;
+    updateItemValue = false;
+    updateValues = false;
+    CaptureButtonDownStates();
+
+    if(isClick)
+    {
+      isClick = false;
+
+      switch (pntrPos)
+      {
+        case 6: 
+          BUZZER.Long();
+          SendStorage(STORAGE_SAVE);
+          break;
+        case 7: 
+          currPage = (profileLed == 0) ? MENU_LED_WHITE : MENU_LED_COLOR; 
+          BUZZER.Double();
+          return;
+      }
+    }
+
+    if(isLongPress && !(pntrPos == 6 || pntrPos == 7))
+    {
+      isLongPress = false;
+      updateValues = true;
+      editMode = !editMode;
+      BUZZER.Double();
+    }
+
+    if(editMode)
+    {
+      encoder->tick();
+      encoderPos = encoder->getPosition();
+      if(encoderPos == 2)
+      {
+        encoderPos = encoderPos / 2;
+      }
+
+      // Fields are edited unpacked, the frame's config word is packed again after each step
+      switch (pntrPos)
+      {
+        case 1:
+          AdjustUint8_t(&frame, 1, CONFIG_LED_KEYFRAMES);
+          if(updateItemValue) {isUsed = LightProfile::Unpack(keyframes[frame - 1], &hour, &minute, &level, &easing);}
+          break;
+        case 2: AdjustTime(&hour, &minute); break;
+        case 3: AdjustUint8_t(&level, 0, 100); break;
+        case 4: AdjustUint8_t(&easing, 0, EASING_COUNT - 1); break;
+        case 5: AdjustBoolean(&isUsed); break;
+      }
+
+      if(updateItemValue && pntrPos != 1)
+      {
+        xSemaphoreTake(configMutex, portMAX_DELAY);
+        keyframes[frame - 1] = LightProfile::Pack(hour, minute, level, easing) & (isUsed ? 0xFFFFFFFFUL : ~LIGHT_FRAME_USED);
+        Config_MarkDirty(&keyframes[frame - 1]);
+        xSemaphoreGive(configMutex);
+      }
+
+      encoder->setPosition(0);
+    }
+    else
+    {
+      DoPointerNavigation();
+    }
+
+    PacintWait();
+  }
+}
+
+bool IsProfileUsed(const uint32_t *keyframes)
+{
+  for(uint8_t i = 0; i < CONFIG_LED_KEYFRAMES; i++)
+  {
+    if(keyframes[i] & LIGHT_FRAME_USED) {return true;}
+  }
+
+  return false;
+}
+
 // =======================================================================//
 //                               MENU PUMP 1                              //
 // =======================================================================//
 void Page_Pump_1()
 {
-  InitMenuPage(F("Pump #1"), 9);
+  InitMenuPage("Pump #1", 9);
 
-  while (true)
+  while (currPage == MENU_PUMP_1)
   {
     if(updateAllItems)
     {
@@ -850,14 +1168,14 @@ void Page_Pump_1()
     if(updateAllItems || updateItemValue)
     {
       if(MenuItemPrintable(10, 1))  {PrintTimeString(_config.pump1_onTimeHour, _config.pump1_onTimeMinute);}
-      if(MenuItemPrintable(9, 2))   {PrintFloatAtWidth(_config.pump1_volume, 1, ' ', false); lcd.print("ml ");}
-      if(MenuItemPrintable(7, 3))   {PrintUint8_tAtWidth(_config.pump1_duty, 1, ' ', false); lcd.print("% ");}
+      if(MenuItemPrintable(9, 2))   {PrintText(text.Clear().AppendFixed(_config.pump1_volume / 10, 2).Append("ml "));}
+      if(MenuItemPrintable(7, 3))   {PrintText(text.Clear().AppendUint(_config.pump1_duty).Append("% "));}
       if(MenuItemPrintable(7, 4))   {PrintOnOff(_config.pump1_enable);}
     }
 
     if(updateValues)
     {
-      pump_1.SetParameters(_config.pump1_duty, _config.pump1_volume, _config.pump1_calibrationOffset);
+      SendControl(CONTROL_APPLY_CONFIG, 0);
     }
 
     if(IsFlashChanged())
@@ -877,11 +1195,6 @@ void Page_Pump_1()
     updateValues = false;
     CaptureButtonDownStates();
 
-    while(pump_1.IsEnable())
-    {
-      pump_1.Tick();
-    }
-
     if(isClick)
     {
       isClick = false;
@@ -890,8 +1203,7 @@ void Page_Pump_1()
       {
         case 5:
           BUZZER.Single();
-          pump_1.Start();
-          VolumeBottle(&_config.pump1_volume_bottle, _config.pump1_volume);
+          SendControl(CONTROL_PUMP_DOSE, 0);
           break;
         case 6:
           encoder->setPosition(0);
@@ -900,9 +1212,7 @@ void Page_Pump_1()
           return;
         case 8: 
           BUZZER.Long();
-          SD_Save(); 
-          BUZZER.Long();
-          Page_Pump_1();
+          SendStorage(STORAGE_SAVE);
           break;
         case 9: 
           currPage = MENU_MAIN; 
@@ -917,8 +1227,7 @@ void Page_Pump_1()
 
       if(pntrPos == 7)
       {
-        _config.pump1_volume_bottle = 450;
-        warningVolumeBottle = false;
+        SendControl(CONTROL_BOTTLE_RESET, 0);
         BUZZER.Long();
         return;
       }
@@ -940,7 +1249,7 @@ void Page_Pump_1()
       switch (pntrPos)
       {
         case 1: AdjustTime(&_config.pump1_onTimeHour, &_config.pump1_onTimeMinute); break;
-        case 2: AdjustFloat(&_config.pump1_volume, 0.2, 50); break;
+        case 2: AdjustMilli(&_config.pump1_volume, 200, 50000); break;
         case 3: AdjustUint8_t(&_config.pump1_duty, 1, 100); break;
         case 4: AdjustBoolean(&_config.pump1_enable); break;
       }
@@ -961,11 +1270,12 @@ void Page_Pump_1()
 // =======================================================================//
 void Page_Pump_1_Calibration()
 {
-  InitMenuPage(F("Pump 1 Calibration"), 0);
-  pump_1.SetParameters(_config.pump1_duty , 5, 0);
+  InitMenuPage("Pump 1 Calibration", 0);
+  step = 1;
+  SendControl(CONTROL_PUMP_CALIBRATE, 0, _config.pump1_duty, 0);
 
   // ########### STEP 1 ############
-  while (step == 1)
+  while (step == 1 && currPage == MENU_PUMP_1_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -980,14 +1290,14 @@ void Page_Pump_1_Calibration()
     updateAllItems = false;
     CaptureButtonDownStates();
 
-    if(isLongPress)
+    if(isLongPress && !pump_1.IsEnable())
     {
-      pump_1.Enable();
+      SendControl(CONTROL_PUMP_ENABLE, 0);
     }
 
     if(!isLongPress && pump_1.IsEnable())
     {
-      pump_1.Disable();
+      SendControl(CONTROL_PUMP_DISABLE, 0);
     }
 
     if(isClick)
@@ -997,10 +1307,12 @@ void Page_Pump_1_Calibration()
       updateAllItems = true;
       step = 2;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 2 ############
-  while (step == 2)
+  while (step == 2 && currPage == MENU_PUMP_1_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1014,15 +1326,15 @@ void Page_Pump_1_Calibration()
 
     updateAllItems = false;
     CaptureButtonDownStates();
-    pump_1.Tick();
 
     if(isClick && !pump_1.IsEnable())
     {
       isClick = false;
-      pump_1.Start();
+      pumpCycleComplete[0] = false;
+      SendControl(CONTROL_PUMP_START, 0);
     }
 
-    if(pump_1.IsCycleComplete())
+    if(pumpCycleComplete[0])
     {
       BUZZER.Double();
       lcd.setCursor(0, 3);
@@ -1030,10 +1342,12 @@ void Page_Pump_1_Calibration()
       updateAllItems = true;
       step = 3;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 3 ############
-  while (step == 3)
+  while (step == 3 && currPage == MENU_PUMP_1_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1046,7 +1360,7 @@ void Page_Pump_1_Calibration()
     if(updateAllItems || updateItemValue)
     {
       lcd.setCursor(0, 3);
-      lcd.print(String(_config.pump1_calibrationOffset) + "ml ");
+      PrintText(text.Clear().AppendFixed(_config.pump1_calibrationOffset / 10, 2).Append("ml "));
     }
 
     updateAllItems = false;
@@ -1060,20 +1374,22 @@ void Page_Pump_1_Calibration()
       encoderPos = encoderPos / 2;
     }
 
-    AdjustFloat(&_config.pump1_calibrationOffset, 0.0F, 50.0F);
+    AdjustMilli(&_config.pump1_calibrationOffset, 0, 50000);
 
     if(isClick)
     {
       isClick = false;
-      pump_1.SetParameters(_config.pump1_duty, 5, _config.pump1_calibrationOffset);
+      SendControl(CONTROL_PUMP_CALIBRATE, 0, _config.pump1_duty, _config.pump1_calibrationOffset);
       BUZZER.Single();
       updateAllItems = true;
       step = 4;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 4 ############
-  while (step == 4)
+  while (step == 4 && currPage == MENU_PUMP_1_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1087,24 +1403,26 @@ void Page_Pump_1_Calibration()
 
     updateAllItems = false;
     CaptureButtonDownStates();
-    pump_1.Tick();
 
     if(isClick && !pump_1.IsEnable())
     {
       isClick = false;
-      pump_1.Start();
+      pumpCycleComplete[0] = false;
+      SendControl(CONTROL_PUMP_START, 0);
     }
 
-    if(pump_1.IsCycleComplete())
+    if(pumpCycleComplete[0])
     {
       BUZZER.Double();
       updateAllItems = true;
       step = 5;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 5 ############
-  while (step == 5)
+  while (step == 5 && currPage == MENU_PUMP_1_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1129,13 +1447,16 @@ void Page_Pump_1_Calibration()
     if(isClick)
     {
       isClick = false;
-      pump_1.SetParameters(_config.pump1_duty, _config.pump1_volume, _config.pump1_calibrationOffset);
       encoder->setPosition(0);
       BUZZER.Double();
       currPage = MENU_PUMP_1;
       step = 1;
     }
+
+    PacintWait();
   }
+
+  SendControl(CONTROL_APPLY_CONFIG, 0);
 }
 
 // =======================================================================//
@@ -1143,9 +1464,9 @@ void Page_Pump_1_Calibration()
 // =======================================================================//
 void Page_Pump_2()
 {
-  InitMenuPage(F("Pump #2"), 9);
+  InitMenuPage("Pump #2", 9);
 
-  while (true)
+  while (currPage == MENU_PUMP_2)
   {
     if(updateAllItems)
     {
@@ -1163,14 +1484,14 @@ void Page_Pump_2()
     if(updateAllItems || updateItemValue)
     {
       if(MenuItemPrintable(10, 1))  {PrintTimeString(_config.pump2_onTimeHour, _config.pump2_onTimeMinute);}
-      if(MenuItemPrintable(9, 2))   {PrintFloatAtWidth(_config.pump2_volume, 1, ' ', false); lcd.print("ml ");}
-      if(MenuItemPrintable(7, 3))   {PrintUint8_tAtWidth(_config.pump2_duty, 1, ' ', false); lcd.print("% ");}
+      if(MenuItemPrintable(9, 2))   {PrintText(text.Clear().AppendFixed(_config.pump2_volume / 10, 2).Append("ml "));}
+      if(MenuItemPrintable(7, 3))   {PrintText(text.Clear().AppendUint(_config.pump2_duty).Append("% "));}
       if(MenuItemPrintable(7, 4))   {PrintOnOff(_config.pump2_enable);}
     }
 
     if(updateValues)
     {
-      pump_2.SetParameters(_config.pump2_duty, _config.pump2_volume, _config.pump2_calibrationOffset);
+      SendControl(CONTROL_APPLY_CONFIG, 0);
     }
 
     if(IsFlashChanged())
@@ -1190,11 +1511,6 @@ void Page_Pump_2()
     updateValues = false;
     CaptureButtonDownStates();
 
-    while(pump_2.IsEnable())
-    {
-      pump_2.Tick();
-    }
-
     if(isClick)
     {
       isClick = false;
@@ -1203,8 +1519,7 @@ void Page_Pump_2()
       {
         case 5:
           BUZZER.Single();
-          pump_2.Start();
-          VolumeBottle(&_config.pump2_volume_bottle, _config.pump2_volume);
+          SendControl(CONTROL_PUMP_DOSE, 1);
         break;
         case 6:
           encoder->setPosition(0);
@@ -1213,9 +1528,7 @@ void Page_Pump_2()
           return;
         case 8: 
           BUZZER.Long();
-          SD_Save(); 
-          BUZZER.Long();
-          Page_Pump_2();
+          SendStorage(STORAGE_SAVE);
           break;
         case 9: 
           currPage = MENU_MAIN; 
@@ -1230,8 +1543,7 @@ void Page_Pump_2()
 
       if(pntrPos == 7)
       {
-        _config.pump2_volume_bottle = 450;
-        warningVolumeBottle = false;
+        SendControl(CONTROL_BOTTLE_RESET, 1);
         BUZZER.Long();
         return;
       }
@@ -1253,7 +1565,7 @@ void Page_Pump_2()
       switch (pntrPos)
       {
         case 1: AdjustTime(&_config.pump2_onTimeHour, &_config.pump2_onTimeMinute); break;
-        case 2: AdjustFloat(&_config.pump2_volume, 0.2, 50); break;
+        case 2: AdjustMilli(&_config.pump2_volume, 200, 50000); break;
         case 3: AdjustUint8_t(&_config.pump2_duty, 1, 100); break;
         case 4: AdjustBoolean(&_config.pump2_enable); break;
       }
@@ -1274,11 +1586,12 @@ void Page_Pump_2()
 // =======================================================================//
 void Page_Pump_2_Calibration()
 {
-  InitMenuPage(F("Pump 2 Calibration"), 0);
-  pump_2.SetParameters(_config.pump2_duty, 5, 0);
+  InitMenuPage("Pump 2 Calibration", 0);
+  step = 1;
+  SendControl(CONTROL_PUMP_CALIBRATE, 1, _config.pump2_duty, 0);
 
   // ########### STEP 1 ############
-  while (step == 1)
+  while (step == 1 && currPage == MENU_PUMP_2_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1293,14 +1606,14 @@ void Page_Pump_2_Calibration()
     updateAllItems = false;
     CaptureButtonDownStates();
 
-    if(isLongPress)
+    if(isLongPress && !pump_2.IsEnable())
     {
-      pump_2.Enable();
+      SendControl(CONTROL_PUMP_ENABLE, 1);
     }
 
     if(!isLongPress && pump_2.IsEnable())
     {
-      pump_2.Disable();
+      SendControl(CONTROL_PUMP_DISABLE, 1);
     }
 
     if(isClick)
@@ -1310,10 +1623,12 @@ void Page_Pump_2_Calibration()
       updateAllItems = true;
       step = 2;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 2 ############
-  while (step == 2)
+  while (step == 2 && currPage == MENU_PUMP_2_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1327,15 +1642,15 @@ void Page_Pump_2_Calibration()
 
     updateAllItems = false;
     CaptureButtonDownStates();
-    pump_2.Tick();
 
     if(isClick && !pump_2.IsEnable())
     {
       isClick = false;
-      pump_2.Start();
+      pumpCycleComplete[1] = false;
+      SendControl(CONTROL_PUMP_START, 1);
     }
 
-    if(pump_2.IsCycleComplete())
+    if(pumpCycleComplete[1])
     {
       BUZZER.Double();
       lcd.setCursor(0, 3);
@@ -1343,10 +1658,12 @@ void Page_Pump_2_Calibration()
       updateAllItems = true;
       step = 3;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 3 ############
-  while (step == 3)
+  while (step == 3 && currPage == MENU_PUMP_2_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1359,7 +1676,7 @@ void Page_Pump_2_Calibration()
     if(updateAllItems || updateItemValue)
     {
       lcd.setCursor(0, 3);
-      lcd.print(String(_config.pump2_calibrationOffset) + "ml ");
+      PrintText(text.Clear().AppendFixed(_config.pump2_calibrationOffset / 10, 2).Append("ml "));
     }
 
     updateAllItems = false;
@@ -1373,20 +1690,22 @@ void Page_Pump_2_Calibration()
       encoderPos = encoderPos / 2;
     }
 
-    AdjustFloat(&_config.pump2_calibrationOffset, 0.0F, 50.0F);
+    AdjustMilli(&_config.pump2_calibrationOffset, 0, 50000);
 
     if(isClick)
     {
       isClick = false;
-      pump_2.SetParameters(_config.pump2_duty, 5, _config.pump2_calibrationOffset);
+      SendControl(CONTROL_PUMP_CALIBRATE, 1, _config.pump2_duty, _config.pump2_calibrationOffset);
       BUZZER.Single();
       updateAllItems = true;
       step = 4;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 4 ############
-  while (step == 4)
+  while (step == 4 && currPage == MENU_PUMP_2_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1400,24 +1719,26 @@ void Page_Pump_2_Calibration()
 
     updateAllItems = false;
     CaptureButtonDownStates();
-    pump_2.Tick();
 
     if(isClick && !pump_2.IsEnable())
     {
       isClick = false;
-      pump_2.Start();
+      pumpCycleComplete[1] = false;
+      SendControl(CONTROL_PUMP_START, 1);
     }
 
-    if(pump_2.IsCycleComplete())
+    if(pumpCycleComplete[1])
     {
       BUZZER.Double();
       updateAllItems = true;
       step = 5;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 5 ############
-  while (step == 5)
+  while (step == 5 && currPage == MENU_PUMP_2_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1442,13 +1763,16 @@ void Page_Pump_2_Calibration()
     if(isClick)
     {
       isClick = false;
-      pump_2.SetParameters(_config.pump2_duty, _config.pump2_volume, _config.pump2_calibrationOffset);
       encoder->setPosition(0);
       BUZZER.Double();
       currPage = MENU_PUMP_2;
       step = 1;
     }
+
+    PacintWait();
   }
+
+  SendControl(CONTROL_APPLY_CONFIG, 0);
 }
 
 // =======================================================================//
@@ -1456,9 +1780,9 @@ void Page_Pump_2_Calibration()
 // =======================================================================//
 void Page_Pump_3()
 {
-  InitMenuPage(F("Pump #3"), 9);
+  InitMenuPage("Pump #3", 9);
 
-  while (true)
+  while (currPage == MENU_PUMP_3)
   {
     if(updateAllItems)
     {
@@ -1476,14 +1800,14 @@ void Page_Pump_3()
     if(updateAllItems || updateItemValue)
     {
       if(MenuItemPrintable(10, 1))  {PrintTimeString(_config.pump3_onTimeHour, _config.pump3_onTimeMinute);}
-      if(MenuItemPrintable(9, 2))   {PrintFloatAtWidth(_config.pump3_volume, 1, ' ', false); lcd.print("ml ");}
-      if(MenuItemPrintable(7, 3))   {PrintUint8_tAtWidth(_config.pump3_duty, 1, ' ', false); lcd.print("% ");}
+      if(MenuItemPrintable(9, 2))   {PrintText(text.Clear().AppendFixed(_config.pump3_volume / 10, 2).Append("ml "));}
+      if(MenuItemPrintable(7, 3))   {PrintText(text.Clear().AppendUint(_config.pump3_duty).Append("% "));}
       if(MenuItemPrintable(7, 4))   {PrintOnOff(_config.pump3_enable);}
     }
 
     if(updateValues)
     {
-      pump_3.SetParameters(_config.pump3_duty, _config.pump3_volume, _config.pump3_calibrationOffset);
+      SendControl(CONTROL_APPLY_CONFIG, 0);
     }
 
     if(IsFlashChanged())
@@ -1503,11 +1827,6 @@ void Page_Pump_3()
     updateValues = false;
     CaptureButtonDownStates();
 
-    while(pump_3.IsEnable())
-    {
-      pump_3.Tick();
-    }
-
     if(isClick)
     {
       isClick = false;
@@ -1516,8 +1835,7 @@ void Page_Pump_3()
       {
         case 5:
           BUZZER.Single();
-          pump_3.Start();
-          VolumeBottle(&_config.pump3_volume_bottle, _config.pump3_volume);
+          SendControl(CONTROL_PUMP_DOSE, 2);
           break;
         case 6:
           encoder->setPosition(0);
@@ -1526,9 +1844,7 @@ void Page_Pump_3()
           return;
         case 8: 
           BUZZER.Long();
-          SD_Save(); 
-          BUZZER.Long();
-          Page_Pump_3();
+          SendStorage(STORAGE_SAVE);
           break;
         case 9: 
           currPage = MENU_MAIN; 
@@ -1543,8 +1859,7 @@ void Page_Pump_3()
 
       if(pntrPos == 7)
       {
-        _config.pump3_volume_bottle = 450;
-        warningVolumeBottle = false;
+        SendControl(CONTROL_BOTTLE_RESET, 2);
         BUZZER.Long();
         return;
       }
@@ -1566,7 +1881,7 @@ void Page_Pump_3()
       switch (pntrPos)
       {
         case 1: AdjustTime(&_config.pump3_onTimeHour, &_config.pump3_onTimeMinute); break;
-        case 2: AdjustFloat(&_config.pump3_volume, 0.2, 50); break;
+        case 2: AdjustMilli(&_config.pump3_volume, 200, 50000); break;
         case 3: AdjustUint8_t(&_config.pump3_duty, 1, 100); break;
         case 4: AdjustBoolean(&_config.pump3_enable); break;
       }
@@ -1587,11 +1902,12 @@ void Page_Pump_3()
 // =======================================================================//
 void Page_Pump_3_Calibration()
 {
-  InitMenuPage(F("Pump 3 Calibration"), 0);
-  pump_3.SetParameters(_config.pump3_duty, 5, 0);
+  InitMenuPage("Pump 3 Calibration", 0);
+  step = 1;
+  SendControl(CONTROL_PUMP_CALIBRATE, 2, _config.pump3_duty, 0);
 
   // ########### STEP 1 ############
-  while (step == 1)
+  while (step == 1 && currPage == MENU_PUMP_3_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1606,14 +1922,14 @@ void Page_Pump_3_Calibration()
     updateAllItems = false;
     CaptureButtonDownStates();
 
-    if(isLongPress)
+    if(isLongPress && !pump_3.IsEnable())
     {
-      pump_3.Enable();
+      SendControl(CONTROL_PUMP_ENABLE, 2);
     }
 
     if(!isLongPress && pump_3.IsEnable())
     {
-      pump_3.Disable();
+      SendControl(CONTROL_PUMP_DISABLE, 2);
     }
 
     if(isClick)
@@ -1623,10 +1939,12 @@ void Page_Pump_3_Calibration()
       updateAllItems = true;
       step = 2;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 2 ############
-  while (step == 2)
+  while (step == 2 && currPage == MENU_PUMP_3_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1640,15 +1958,15 @@ void Page_Pump_3_Calibration()
 
     updateAllItems = false;
     CaptureButtonDownStates();
-    pump_3.Tick();
 
     if(isClick && !pump_3.IsEnable())
     {
       isClick = false;
-      pump_3.Start();
+      pumpCycleComplete[2] = false;
+      SendControl(CONTROL_PUMP_START, 2);
     }
 
-    if(pump_3.IsCycleComplete())
+    if(pumpCycleComplete[2])
     {
       BUZZER.Double();
       lcd.setCursor(0, 3);
@@ -1656,10 +1974,12 @@ void Page_Pump_3_Calibration()
       updateAllItems = true;
       step = 3;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 3 ############
-  while (step == 3)
+  while (step == 3 && currPage == MENU_PUMP_3_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1672,7 +1992,7 @@ void Page_Pump_3_Calibration()
     if(updateAllItems || updateItemValue)
     {
       lcd.setCursor(0, 3);
-      lcd.print(String(_config.pump3_calibrationOffset) + "ml ");
+      PrintText(text.Clear().AppendFixed(_config.pump3_calibrationOffset / 10, 2).Append("ml "));
     }
 
     updateAllItems = false;
@@ -1686,20 +2006,22 @@ void Page_Pump_3_Calibration()
       encoderPos = encoderPos / 2;
     }
 
-    AdjustFloat(&_config.pump3_calibrationOffset, 0.0F, 50.0F);
+    AdjustMilli(&_config.pump3_calibrationOffset, 0, 50000);
 
     if(isClick)
     {
       isClick = false;
-      pump_3.SetParameters(_config.pump3_duty, 5, _config.pump3_calibrationOffset);
+      SendControl(CONTROL_PUMP_CALIBRATE, 2, _config.pump3_duty, _config.pump3_calibrationOffset);
       BUZZER.Single();
       updateAllItems = true;
       step = 4;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 4 ############
-  while (step == 4)
+  while (step == 4 && currPage == MENU_PUMP_3_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1713,24 +2035,26 @@ void Page_Pump_3_Calibration()
 
     updateAllItems = false;
     CaptureButtonDownStates();
-    pump_3.Tick();
 
     if(isClick && !pump_3.IsEnable())
     {
       isClick = false;
-      pump_3.Start();
+      pumpCycleComplete[2] = false;
+      SendControl(CONTROL_PUMP_START, 2);
     }
 
-    if(pump_3.IsCycleComplete())
+    if(pumpCycleComplete[2])
     {
       BUZZER.Double();
       updateAllItems = true;
       step = 5;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 5 ############
-  while (step == 5)
+  while (step == 5 && currPage == MENU_PUMP_3_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1755,13 +2079,16 @@ void Page_Pump_3_Calibration()
     if(isClick)
     {
       isClick = false;
-      pump_3.SetParameters(_config.pump3_duty, _config.pump3_volume, _config.pump3_calibrationOffset);
       encoder->setPosition(0);
       BUZZER.Double();
       currPage = MENU_PUMP_3;
       step = 1;
     }
+
+    PacintWait();
   }
+
+  SendControl(CONTROL_APPLY_CONFIG, 0);
 }
 
 // =======================================================================//
@@ -1769,9 +2096,9 @@ void Page_Pump_3_Calibration()
 // =======================================================================//
 void Page_Pump_4()
 {
-  InitMenuPage(F("Pump #4"), 9);
+  InitMenuPage("Pump #4", 9);
 
-  while (true)
+  while (currPage == MENU_PUMP_4)
   {
     if(updateAllItems)
     {
@@ -1789,14 +2116,14 @@ void Page_Pump_4()
     if(updateAllItems || updateItemValue)
     {
       if(MenuItemPrintable(10, 1))  {PrintTimeString(_config.pump4_onTimeHour, _config.pump4_onTimeMinute);}
-      if(MenuItemPrintable(9, 2))   {PrintFloatAtWidth(_config.pump4_volume, 1, ' ', false); lcd.print("ml ");}
-      if(MenuItemPrintable(7, 3))   {PrintUint8_tAtWidth(_config.pump4_duty, 1, ' ', false); lcd.print("% ");}
+      if(MenuItemPrintable(9, 2))   {PrintText(text.Clear().AppendFixed(_config.pump4_volume / 10, 2).Append("ml "));}
+      if(MenuItemPrintable(7, 3))   {PrintText(text.Clear().AppendUint(_config.pump4_duty).Append("% "));}
       if(MenuItemPrintable(7, 4))   {PrintOnOff(_config.pump4_enable);}
     }
 
     if(updateValues)
     {
-      pump_4.SetParameters(_config.pump4_duty, _config.pump4_volume, _config.pump4_calibrationOffset);
+      SendControl(CONTROL_APPLY_CONFIG, 0);
     }
 
     if(IsFlashChanged())
@@ -1816,11 +2143,6 @@ void Page_Pump_4()
     updateValues = false;
     CaptureButtonDownStates();
 
-    while(pump_4.IsEnable())
-    {
-      pump_4.Tick();
-    }
-
     if(isClick)
     {
       isClick = false;
@@ -1829,8 +2151,7 @@ void Page_Pump_4()
       {
         case 5:
           BUZZER.Single();
-          pump_4.Start();
-          VolumeBottle(&_config.pump4_volume_bottle, _config.pump4_volume);
+          SendControl(CONTROL_PUMP_DOSE, 3);
         break;
         case 6:
           encoder->setPosition(0);
@@ -1839,9 +2160,7 @@ void Page_Pump_4()
           return;
         case 8: 
           BUZZER.Long();
-          SD_Save(); 
-          BUZZER.Long();
-          Page_Pump_4();
+          SendStorage(STORAGE_SAVE);
           break;
         case 9: 
           currPage = MENU_MAIN; 
@@ -1856,8 +2175,7 @@ void Page_Pump_4()
 
       if(pntrPos == 7)
       {
-        _config.pump4_volume_bottle = 450;
-        warningVolumeBottle = false;
+        SendControl(CONTROL_BOTTLE_RESET, 3);
         BUZZER.Long();
         return;
       }
@@ -1879,7 +2197,7 @@ void Page_Pump_4()
       switch (pntrPos)
       {
         case 1: AdjustTime(&_config.pump4_onTimeHour, &_config.pump4_onTimeMinute); break;
-        case 2: AdjustFloat(&_config.pump4_volume, 0.2, 50); break;
+        case 2: AdjustMilli(&_config.pump4_volume, 200, 50000); break;
         case 3: AdjustUint8_t(&_config.pump4_duty, 1, 100); break;
         case 4: AdjustBoolean(&_config.pump4_enable); break;
       }
@@ -1900,11 +2218,12 @@ void Page_Pump_4()
 // =======================================================================//
 void Page_Pump_4_Calibration()  
 {
-  InitMenuPage(F("Pump 4 Calibration"), 0);
-  pump_4.SetParameters(_config.pump4_duty, 5, 0);
+  InitMenuPage("Pump 4 Calibration", 0);
+  step = 1;
+  SendControl(CONTROL_PUMP_CALIBRATE, 3, _config.pump4_duty, 0);
 
   // ########### STEP 1 ############
-  while (step == 1)
+  while (step == 1 && currPage == MENU_PUMP_4_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1919,14 +2238,14 @@ void Page_Pump_4_Calibration()
     updateAllItems = false;
     CaptureButtonDownStates();
 
-    if(isLongPress)
+    if(isLongPress && !pump_4.IsEnable())
     {
-      pump_4.Enable();
+      SendControl(CONTROL_PUMP_ENABLE, 3);
     }
 
     if(!isLongPress && pump_4.IsEnable())
     {
-      pump_4.Disable();
+      SendControl(CONTROL_PUMP_DISABLE, 3);
     }
 
     if(isClick)
@@ -1936,10 +2255,12 @@ void Page_Pump_4_Calibration()
       updateAllItems = true;
       step = 2;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 2 ############
-  while (step == 2)
+  while (step == 2 && currPage == MENU_PUMP_4_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1953,15 +2274,15 @@ void Page_Pump_4_Calibration()
 
     updateAllItems = false;
     CaptureButtonDownStates();
-    pump_4.Tick();
 
     if(isClick && !pump_4.IsEnable())
     {
       isClick = false;
-      pump_4.Start();
+      pumpCycleComplete[3] = false;
+      SendControl(CONTROL_PUMP_START, 3);
     }
 
-    if(pump_4.IsCycleComplete())
+    if(pumpCycleComplete[3])
     {
       BUZZER.Double();
       lcd.setCursor(0, 3);
@@ -1969,10 +2290,12 @@ void Page_Pump_4_Calibration()
       updateAllItems = true;
       step = 3;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 3 ############
-  while (step == 3)
+  while (step == 3 && currPage == MENU_PUMP_4_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -1985,7 +2308,7 @@ void Page_Pump_4_Calibration()
     if(updateAllItems || updateItemValue)
     {
       lcd.setCursor(0, 3);
-      lcd.print(String(_config.pump4_calibrationOffset) + "ml ");
+      PrintText(text.Clear().AppendFixed(_config.pump4_calibrationOffset / 10, 2).Append("ml "));
     }
 
     updateAllItems = false;
@@ -1999,20 +2322,22 @@ void Page_Pump_4_Calibration()
       encoderPos = encoderPos / 2;
     }
 
-    AdjustFloat(&_config.pump4_calibrationOffset, 0.0F, 50.0F);
+    AdjustMilli(&_config.pump4_calibrationOffset, 0, 50000);
 
     if(isClick)
     {
       isClick = false;
-      pump_4.SetParameters(_config.pump4_duty, 5, _config.pump4_calibrationOffset);
+      SendControl(CONTROL_PUMP_CALIBRATE, 3, _config.pump4_duty, _config.pump4_calibrationOffset);
       BUZZER.Single();
       updateAllItems = true;
       step = 4;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 4 ############
-  while (step == 4)
+  while (step == 4 && currPage == MENU_PUMP_4_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -2026,24 +2351,26 @@ void Page_Pump_4_Calibration()
 
     updateAllItems = false;
     CaptureButtonDownStates();
-    pump_4.Tick();
 
     if(isClick && !pump_4.IsEnable())
     {
       isClick = false;
-      pump_4.Start();
+      pumpCycleComplete[3] = false;
+      SendControl(CONTROL_PUMP_START, 3);
     }
 
-    if(pump_4.IsCycleComplete())
+    if(pumpCycleComplete[3])
     {
       BUZZER.Double();
       updateAllItems = true;
       step = 5;
     }
+
+    PacintWait();
   }
 
   // ########### STEP 5 ############
-  while (step == 5)
+  while (step == 5 && currPage == MENU_PUMP_4_CALIBRATION)
   {
     if(updateAllItems)
     {
@@ -2068,13 +2395,16 @@ void Page_Pump_4_Calibration()
     if(isClick)
     {
       isClick = false;
-      pump_4.SetParameters(_config.pump4_duty, _config.pump4_volume, _config.pump4_calibrationOffset);
       encoder->setPosition(0);
       BUZZER.Double();
       currPage = MENU_PUMP_4;
       step = 1;
     }
+
+    PacintWait();
   }
+
+  SendControl(CONTROL_APPLY_CONFIG, 0);
 }
 
 // =======================================================================//
@@ -2082,15 +2412,17 @@ void Page_Pump_4_Calibration()
 // =======================================================================//
 void Page_MenuSettings()
 {
-  InitMenuPage(F("Settings"), 8);
-  currDateTime = timeRTC.GetDateTime();
-  _config.years = currDateTime.year();
-  _config.months = currDateTime.month();
-  _config.days = currDateTime.day();
-  _config.hours = currDateTime.hour();
-  _config.minutes = currDateTime.minute();
-
-  while (true)
+  InitMenuPage("Settings", 12);
+  RtcDateTime dateTime = timeRTC.GetDateTime();
+  xSemaphoreTake(configMutex, portMAX_DELAY);
+  _config.years = dateTime.year;
+  _config.months = dateTime.month;
+  _config.days = dateTime.day;
+  _config.hours = dateTime.hour;
+  _config.minutes = dateTime.minute;
+  xSemaphoreGive(configMutex);
+
+  while (currPage == MENU_SETTINGS)
   {
     if(updateAllItems)
     {
@@ -2099,18 +2431,24 @@ void Page_MenuSettings()
       if(MenuItemPrintable(1, 3)){lcd.print("Day:               ");}
       if(MenuItemPrintable(1, 4)){lcd.print("Month:             ");}
       if(MenuItemPrintable(1, 5)){lcd.print("Year:              ");}
-      if(MenuItemPrintable(1, 6)){lcd.print("Save               ");}
-      if(MenuItemPrintable(1, 7)){lcd.print("Set Defaults       ");}
-      if(MenuItemPrintable(1, 8)){lcd.print("Back               ");}
+      if(MenuItemPrintable(1, 6)){lcd.print("Weather:           ");}
+      if(MenuItemPrintable(1, 7)){lcd.print("Cloud Dip:         ");}
+      if(MenuItemPrintable(1, 8)){lcd.print("Save               ");}
+      if(MenuItemPrintable(1, 9)){lcd.print("Set Defaults       ");}
+      if(MenuItemPrintable(1, 10)){lcd.print("Import From SD     ");}
+      if(MenuItemPrintable(1, 11)){lcd.print("Export To SD       ");}
+      if(MenuItemPrintable(1, 12)){lcd.print("Back               ");}
     }
 
     if(updateAllItems || updateItemValue)
     {
-      if(MenuItemPrintable(10, 1)){PrintUint8_tAtWidth(_config.minutes, 3, ' ', false);}
-      if(MenuItemPrintable(8, 2)){PrintUint8_tAtWidth(_config.hours, 3, ' ', false);}
-      if(MenuItemPrintable(6, 3)){PrintUint8_tAtWidth(_config.days, 3, ' ', false);}
-      if(MenuItemPrintable(8, 4)){PrintUint8_tAtWidth(_config.months, 3, ' ', false);}
-      if(MenuItemPrintable(7, 5)){PrintUint8_tAtWidth(_config.years, 3, ' ', false);}
+      if(MenuItemPrintable(10, 1)){PrintText(text.Clear().AppendUint(_config.minutes, 3, ' ', false));}
+      if(MenuItemPrintable(8, 2)){PrintText(text.Clear().AppendUint(_config.hours, 3, ' ', false));}
+      if(MenuItemPrintable(6, 3)){PrintText(text.Clear().AppendUint(_config.days, 3, ' ', false));}
+      if(MenuItemPrintable(8, 4)){PrintText(text.Clear().AppendUint(_config.months, 3, ' ', false));}
+      if(MenuItemPrintable(7, 5)){PrintText(text.Clear().AppendUint(_config.years, 3, ' ', false));}
+      if(MenuItemPrintable(10, 6)){PrintText(text.Clear().Append(weatherNames[_config.weather_mode % WEATHER_MODE_COUNT]));}
+      if(MenuItemPrintable(12, 7)){PrintText(text.Clear().AppendUint(_config.weather_depth).Append("% "));}
     }
 
     if(IsFlashChanged() && !editMode)
@@ -2124,9 +2462,8 @@ void Page_MenuSettings()
 
     if(isDoubleClick && pntrPos == 4)
     {
-      //buzzer.BeepSetDefault();
-      Set_Defaults();
-      Page_MenuSettings();
+      isDoubleClick = false;
+      SendStorage(STORAGE_SET_DEFAULTS);
     }
 
     if(isClick)
@@ -2135,22 +2472,33 @@ void Page_MenuSettings()
 
       switch (pntrPos)
       {
-        case 6: 
+        case 8: 
           BUZZER.Long();
-          timeRTC.SetTime(DateTime(_config.years, _config.months, _config.days, _config.hours, _config.minutes));
+          xSemaphoreTake(i2cMutex, portMAX_DELAY);
+          timeRTC.SetTime({_config.years, _config.months, _config.days, _config.hours, _config.minutes, 0});
+          xSemaphoreGive(i2cMutex);
           break;
-        case 8: 
+        case 10:
+          BUZZER.Double();
+          SendStorage(STORAGE_IMPORT);
+          break;
+        case 11:
+          BUZZER.Double();
+          SendStorage(STORAGE_EXPORT);
+          break;
+        case 12: 
           currPage = MENU_MAIN; 
           BUZZER.Double();
           return;
       }
     }
 
-    if(isLongPress && !(pntrPos == 6 || pntrPos == 7 || pntrPos == 8))
+    if(isLongPress && pntrPos < 8)
     {
       isLongPress = false;
       editMode = !editMode;
       BUZZER.Double();
+      if(pntrPos >= 6) {SendControl(CONTROL_APPLY_CONFIG, 0);}
     }
 
     if(editMode)
@@ -2170,6 +2518,8 @@ void Page_MenuSettings()
         case 3: AdjustUint8_t(&_config.days, 1, 31);          break;
         case 4: AdjustUint8_t(&_config.months, 1, 12);        break;
         case 5: AdjustUint16_t(&_config.years, 2024, 9999);   break;
+        case 6: AdjustUint8_t(&_config.weather_mode, 0, WEATHER_MODE_COUNT - 1); break;
+        case 7: AdjustUint8_t(&_config.weather_depth, 0, 100); break;
       }
 
       encoder->setPosition(0);
@@ -2184,35 +2534,140 @@ void Page_MenuSettings()
 }
 
 // =======================================================================//
-//                                  TOOLS                                 //
+//                              MENU DIAGNOSTICS                          //
 // =======================================================================//
-void InitMenuPage(String title, uint8_t itemCount)
+#define DIAG_LOOPS_ITEM   (PROFILE_SECTION_COUNT + PROFILE_OVERRUN_BINS + 1)
+#define DIAG_BUS_ITEM     (DIAG_LOOPS_ITEM + 1)
+#define DIAG_RENDER_ITEM  (DIAG_LOOPS_ITEM + 2)
+#define DIAG_LOAD_ITEM    (DIAG_LOOPS_ITEM + 3)
+#define DIAG_SAVE_ITEM    (DIAG_LOOPS_ITEM + 4)
+#define DIAG_SIZE_ITEM    (DIAG_LOOPS_ITEM + 5)
+#define DIAG_IMPORT_ITEM  (DIAG_LOOPS_ITEM + 6)
+#define DIAG_PEAK_ITEM    (DIAG_LOOPS_ITEM + 7)
+#define DIAG_RESET_ITEM   (DIAG_LOOPS_ITEM + 8)
+#define DIAG_BACK_ITEM    (DIAG_LOOPS_ITEM + 9)
+
+uint32_t diagBusBytes = 0;
+uint32_t diagMillis = 0;
+
+// Label left, time right aligned in us, or ms from 100 ms on
+void PrintDiagMicros(const char *label, uint32_t micros)
 {
-  lcd.backlight();
-  lcd.clear();
-  lcd.setCursor(0, 0);
+  text.Clear().Append(label);
+  uint8_t width = DISP_CHAR_WIDTH - 3 - text.GetLength();
+  if(micros < 100000) {PrintText(text.AppendUint(micros, width).Append("us"));}
+  else {PrintText(text.AppendUint(micros / 1000, width).Append("ms"));}
+}
 
-  uint8_t fillCnt = (DISP_CHAR_WIDTH - title.length()) / 2;
-  if(fillCnt > 0)
+void Page_MenuDiagnostics()
+{
+  InitMenuPage("Diagnostics", DIAG_BACK_ITEM);
+
+  while (currPage == MENU_DIAGNOSTICS)
   {
-    for(uint8_t i = 0; i < fillCnt; i++)
+    if(updateAllItems)
+    {
+      if(MenuItemPrintable(1, DIAG_RESET_ITEM)){lcd.print("Reset              ");}
+      if(MenuItemPrintable(1, DIAG_BACK_ITEM)){lcd.print("Back               ");}
+    }
+
+    // Share of the loop time per section and its worst single run, then the late loop periods
+    if(updateAllItems || timeRTC.GetSecondOfDay() != shownSecond)
+    {
+      shownSecond = timeRTC.GetSecondOfDay();
+
+      // MenuItemPrintable() only passes rows on a full redraw, the counters get one every second
+      updateAllItems = true;
+      for(uint8_t i = 0; i < PROFILE_SECTION_COUNT; i++)
+      {
+        if(!MenuItemPrintable(1, i + 1)) {continue;}
+
+        uint32_t maxMicros = PROFILER.GetMaxMicros(i);
+        text.Clear().Append(PROFILER.GetSectionName(i)).AppendFixed(PROFILER.GetLoadPermille(i), 1, 6).Append("% ");
+        if(maxMicros < 100000) {PrintText(text.AppendUint(maxMicros, 6).Append("us"));}
+        else {PrintText(text.AppendUint(maxMicros / 1000, 6).Append("ms"));}
+      }
+
+      for(uint8_t i = 0; i < PROFILE_OVERRUN_BINS; i++)
+      {
+        if(!MenuItemPrintable(1, PROFILE_SECTION_COUNT + i + 1)) {continue;}
+
+        text.Clear().Append("Late >").AppendUint(PROFILER.GetOverrunMs(i)).Append("ms");
+        PrintText(text.AppendUint(PROFILER.GetOverruns(i), DISP_CHAR_WIDTH - 1 - text.GetLength()));
+      }
+
+      if(MenuItemPrintable(1, DIAG_LOOPS_ITEM)) {PrintText(text.Clear().Append("Loops").AppendUint(PROFILER.GetPeriods(), DISP_CHAR_WIDTH - 6));}
+
+      // LCD bus bytes per second since the last reset
+      uint32_t seconds = (HalMillis() - diagMillis) / 1000;
+      uint32_t busRate = (lcd.GetBusBytes() - diagBusBytes) / (seconds > 0 ? seconds : 1);
+      if(MenuItemPrintable(1, DIAG_BUS_ITEM)) {PrintText(text.Clear().Append("Lcd I2C").AppendUint(busRate, DISP_CHAR_WIDTH - 12).Append(" B/s"));}
+
+      // Heap allocations made while drawing the home page, 0 unless a formatter regressed
+      if(MenuItemPrintable(1, DIAG_RENDER_ITEM)) {PrintText(text.Clear().Append("Render allocs").AppendUint(renderHeapAllocs, DISP_CHAR_WIDTH - 14));}
+
+      // Last config load and save, flash or SD, and the bytes that save wrote
+      if(MenuItemPrintable(1, DIAG_LOAD_ITEM)) {PrintDiagMicros("Cfg load", configLoadMicros);}
+      if(MenuItemPrintable(1, DIAG_SAVE_ITEM)) {PrintDiagMicros("Cfg save", configSaveMicros);}
+      if(MenuItemPrintable(1, DIAG_SIZE_ITEM)) {PrintText(text.Clear().Append("Cfg saved").AppendUint(configSaveBytes, DISP_CHAR_WIDTH - 12).Append(" B"));}
+
+      // Last JSON import and the most of the arena it used, out of CONFIG_JSON_ARENA_SIZE
+      if(MenuItemPrintable(1, DIAG_IMPORT_ITEM)) {PrintDiagMicros("Json import", configImportMicros);}
+      if(MenuItemPrintable(1, DIAG_PEAK_ITEM)) {PrintText(text.Clear().Append("Json peak").AppendUint(configImportPeakBytes, DISP_CHAR_WIDTH - 15).Append("/").AppendUint(CONFIG_JSON_ARENA_SIZE));}
+    }
+
+    if(IsFlashChanged())
+    {
+      PrintPointer();
+    }
+
+    updateAllItems = false;
+    CaptureButtonDownStates();
+
+    if(isClick)
     {
-      lcd.print("-");
+      isClick = false;
+
+      switch (pntrPos)
+      {
+        case DIAG_RESET_ITEM:
+          BUZZER.Double();
+          PROFILER.Reset();
+          diagBusBytes = lcd.GetBusBytes();
+          diagMillis = HalMillis();
+          renderHeapAllocs = 0;
+          updateAllItems = true;
+          break;
+        case DIAG_BACK_ITEM:
+          currPage = MENU_MAIN;
+          BUZZER.Double();
+          return;
+      }
     }
 
-    lcd.print(title);
+    DoPointerNavigation();
+    PacintWait();
   }
-  if((title.length() % 2) == 1)
+}
+
+// =======================================================================//
+//                                  TOOLS                                 //
+// =======================================================================//
+void InitMenuPage(const char *title, uint8_t itemCount)
+{
+  lcd.backlight();
+  lcd.clear();
+  lcd.setCursor(0, 0);
+
+  uint8_t titleLength = strlen(title);
+  uint8_t fillCnt = (titleLength < DISP_CHAR_WIDTH) ? (DISP_CHAR_WIDTH - titleLength) / 2 : 0;
+  text.Clear().AppendChars(fillCnt, '-').Append(title);
+  if((titleLength % 2) == 1)
   {
     fillCnt++;
   }
-  if(fillCnt > 0)
-  {
-    for(uint8_t i; i < fillCnt; i++)
-    {
-      lcd.print("-");
-    }
-  }
+
+  PrintText(text.AppendChars(fillCnt, '-'));
 
   //btnOk.ClearWasDown();
 
@@ -2222,27 +2677,35 @@ void InitMenuPage(String title, uint8_t itemCount)
   flashCntr = 0;
   flashIsOn = false;
   updateAllItems = true;
-  loopStartMs = millis();
+  loopStartTick = xTaskGetTickCount();
 }
 
 void CaptureButtonDownStates()
 {
+  ReceiveUiMessages();
   WakeUp();
+  PROFILER.Start(PROFILE_BUTTON);
   btnOk.tick();
+  PROFILER.Stop(PROFILE_BUTTON);
 }
 
 void AdjustBoolean(bool *v)
 {
+  xSemaphoreTake(configMutex, portMAX_DELAY);
   if(encoderPos > 0 || encoderPos < 0)
   {
     *v = !*v;
     BUZZER.Single();
     updateItemValue = true;
   }
+
+  if(updateItemValue) {Config_MarkDirty(v);}
+  xSemaphoreGive(configMutex);
 }
 
 void AdjustUint8_t(uint8_t *v, uint8_t min, uint8_t max)
 {
+  xSemaphoreTake(configMutex, portMAX_DELAY);
   if(encoderPos < 0)
   {
     if(*v > min)
@@ -2264,10 +2727,14 @@ void AdjustUint8_t(uint8_t *v, uint8_t min, uint8_t max)
       updateItemValue = true;
     }
   }
+
+  if(updateItemValue) {Config_MarkDirty(v);}
+  xSemaphoreGive(configMutex);
 }
 
 void AdjustUint16_t(uint16_t *v, uint16_t min, uint16_t max)
 {
+  xSemaphoreTake(configMutex, portMAX_DELAY);
   if(encoderPos < 0)
   {
     if(*v > min)
@@ -2289,15 +2756,20 @@ void AdjustUint16_t(uint16_t *v, uint16_t min, uint16_t max)
       updateItemValue = true;
     }
   }
+
+  if(updateItemValue) {Config_MarkDirty(v);}
+  xSemaphoreGive(configMutex);
 }
 
-void AdjustFloat(float *v, float min, float max)
+// Thousandths, one detent is 0.1
+void AdjustMilli(int32_t *v, int32_t min, int32_t max)
 {
+  xSemaphoreTake(configMutex, portMAX_DELAY);
   if(encoderPos < 0)
   {
     if(*v > min)
     {
-      *v = *v - 0.1;
+      *v = *v - 100;
       BUZZER.Single();
       updateItemValue = true;
     }
@@ -2307,17 +2779,21 @@ void AdjustFloat(float *v, float min, float max)
   {
     if(*v < max)
     {
-      *v = *v + 0.1;
+      *v = *v + 100;
       BUZZER.Single();
       updateItemValue = true;
     }
   }
 
   encoder->setPosition(0);
+
+  if(updateItemValue) {Config_MarkDirty(v);}
+  xSemaphoreGive(configMutex);
 }
 
 void AdjustTime(byte *hour, byte *minute)
 {
+  xSemaphoreTake(configMutex, portMAX_DELAY);
   if(encoderPos > 0)
   {
     *minute = *minute + 1;
@@ -2355,6 +2831,13 @@ void AdjustTime(byte *hour, byte *minute)
     encoder->setPosition(0);
     updateItemValue = true;
   }
+
+  if(updateItemValue)
+  {
+    Config_MarkDirty(hour);
+    Config_MarkDirty(minute);
+  }
+  xSemaphoreGive(configMutex);
 }
 
 void DoPointerNavigation()
@@ -2416,12 +2899,13 @@ bool IsFlashChanged()
 
 void PacintWait()
 {
-  while (millis() - loopStartMs < PACING_MS)
-  {
-    delay(1);
-  } 
-
-  loopStartMs = millis();
+  // Pages draw into the shadow frame, the bus is only held while the changes are queued
+  xSemaphoreTake(i2cMutex, portMAX_DELAY);
+  lcd.Flush();
+  xSemaphoreGive(i2cMutex);
+  PROFILER.Stop(PROFILE_LCD);
+  vTaskDelayUntil(&loopStartTick, pdMS_TO_TICKS(PACING_MS));
+  PROFILER.Start(PROFILE_LCD);
 }
 
 bool MenuItemPrintable(uint8_t xPos, uint8_t yPos)
@@ -2489,422 +2973,374 @@ void PrintOnOff(bool val)
   }
 }
 
-void PrintChars(uint8_t cnt, char c)
+void PrintText(TextBuffer &text)
+{
+  lcd.print(text.GetText());
+}
+
+void PrintTimeString(byte hour, byte minute)
+{
+  PrintText(text.Clear().AppendTime(hour, minute).Append(" "));
+}
+
+void CheckPositionEncoder()
+{
+  encoder->tick();
+
+  int8_t direction = (int8_t)encoder->getDirection();
+  if(direction != 0) {inputLog.Record(INPUT_ENCODER, direction, timeRTC.GetUnixTime());}
+}
+
+bool Set_Defaults()
+{
+  xSemaphoreTake(configMutex, portMAX_DELAY);
+  _config = Configuration();
+  Config_SyncTime();
+  xSemaphoreGive(configMutex);
+  return Flash_Save();
+}
+
+void Storage_Init()
+{
+  bool isFlashReady = flashKv.Begin();
+  SD_Init();
+
+  lcd.clear();
+  lcd.setCursor(0, 0);
+  if(isFlashReady && Flash_Load())
+  {
+    lcd.print(F("Data Initialized!   "));
+  }
+  else if(sdAvailable && SD_Load())
+  {
+    lcd.print(F("Imported From SD!   "));
+    Flash_Save();
+  }
+  else
+  {
+    lcd.print(F("Defaults Loaded!    "));
+    Flash_Save();
+  }
+
+  lcd.Flush();
+  HalDelay(1000);
+}
+
+bool Flash_Load()
 {
-  if(cnt > 0)
+  uint32_t startMicros = HalMicros();
+  if(flashKv.IsEmpty())
   {
-    char cc[] = " ";
-    cc[0] = c;
+    return false;
+  }
 
-    for(uint8_t i = 1; i <= cnt; i++)
+  for(size_t i = 0; i < CONFIG_FIELD_COUNT; i++)
+  {
+    uint32_t bits;
+    if(flashKv.Read(configFields[i].key, &bits))
     {
-      lcd.print(cc);
+      Config_SetBits(&_config, &configFields[i], bits);
     }
   }
+
+  Config_SyncTime();
+  configLoadMicros = HalMicros() - startMicros;
+  return true;
 }
 
-uint8_t GetUint32_tCharCnt(uint32_t value)
+bool Flash_Save()
 {
-  if(value == 0)
+  uint32_t startMicros = HalMicros();
+  uint32_t freeRecords = flashKv.GetFreeRecords();
+  bool isSaved = true;
+
+  xSemaphoreTake(configMutex, portMAX_DELAY);
+  for(uint8_t i = 0; i < CONFIG_DIRTY_WORDS; i++)
   {
-    return 1;
+    __atomic_store_n(&configDirty[i], 0, __ATOMIC_RELAXED);
   }
+  configSnapshot = _config;
+  xSemaphoreGive(configMutex);
 
-  uint32_t tensCalc = 10;
-  uint8_t cnt = 1;
+  // Unchanged fields are skipped by the store, only edits cost a record
+  for(size_t i = 0; i < CONFIG_FIELD_COUNT; i++)
+  {
+    if(!flashKv.Write(configFields[i].key, Config_GetBits(&configSnapshot, &configFields[i])))
+    {
+      isSaved = false;
+    }
+  }
 
-  while (tensCalc <= value && cnt > 20)
+  if(flashKv.GetFreeRecords() <= freeRecords)
   {
-    tensCalc *= 10;
-    cnt += 1;
+    configSaveBytes = (freeRecords - flashKv.GetFreeRecords()) * FLASH_KV_RECORD_SIZE;
   }
-  
-  return cnt;
+
+  configSaveMicros = HalMicros() - startMicros;
+  return isSaved;
 }
 
-uint8_t GetFloatCharCnt(float value)
+bool Flash_SaveDirty()
 {
-  if(value == 0)
+  uint32_t startMicros = HalMicros();
+  uint32_t freeRecords = flashKv.GetFreeRecords();
+  bool isSaved = true;
+  uint32_t dirty[CONFIG_DIRTY_WORDS];
+
+  // Bits and values are taken together, an edit after this marks its field again
+  xSemaphoreTake(configMutex, portMAX_DELAY);
+  for(uint8_t word = 0; word < CONFIG_DIRTY_WORDS; word++)
   {
-    return 1;
+    dirty[word] = __atomic_exchange_n(&configDirty[word], 0, __ATOMIC_RELAXED);
   }
+  configSnapshot = _config;
+  xSemaphoreGive(configMutex);
+
+  for(uint8_t word = 0; word < CONFIG_DIRTY_WORDS; word++)
+  {
+    while(dirty[word] != 0)
+    {
+      size_t i = word * 32 + __builtin_ctz(dirty[word]);
+      dirty[word] &= dirty[word] - 1;
 
-  uint32_t tensCalc = 10;
-  uint8_t cnt = 1;
+      if(!flashKv.Write(configFields[i].key, Config_GetBits(&configSnapshot, &configFields[i])))
+      {
+        Config_SetDirty(i);
+        isSaved = false;
+      }
+    }
+  }
 
-  while (tensCalc <= value && cnt > 20)
+  if(flashKv.GetFreeRecords() <= freeRecords)
   {
-    tensCalc *= 10;
-    cnt += 1;
+    configSaveBytes = (freeRecords - flashKv.GetFreeRecords()) * FLASH_KV_RECORD_SIZE;
   }
-  
-  return cnt;
+
+  configSaveMicros = HalMicros() - startMicros;
+  return isSaved;
 }
 
-String GetTimeString(byte hour, byte minute)
+void SD_Init()
 {
-  String time = String(hour) + ":";
+  sdAvailable = HalFileBegin(SD_PIN);
 
-  if(minute < 10)
+  lcd.setCursor(0, 0);
+  if(sdAvailable)
   {
-    time += "0" + String(minute);
+    lcd.print(F("SD Card Initialized!"));
   }
   else
   {
-    time += String(minute);
+    lcd.print(F("SD Card Not Found!  "));
   }
 
-  return time;
+  lcd.Flush();
+  HalDelay(500);
 }
 
-void PrintTimeString(byte hour, byte minute)
+bool SD_Begin()
 {
-  String time = String(hour) + ":";
-
-  if(minute < 10)
-  {
-    time += "0" + String(minute);
-  }
-  else
+  if(!sdAvailable)
   {
-    time += String(minute);
+    sdAvailable = HalFileBegin(SD_PIN);
   }
 
-  lcd.print(time + " ");
+  return sdAvailable;
 }
 
-void PrintUint8_tAtWidth(uint32_t value, uint8_t width, char c, boolean isRight)
+bool SD_Load()
 {
-  uint8_t numChars = GetUint32_tCharCnt(value);
-  if(isRight)
+  uint32_t startMicros = HalMicros();
+  xSemaphoreTake(configMutex, portMAX_DELAY);
+  Configuration config = _config;
+  xSemaphoreGive(configMutex);
+  uint32_t sequence;
+
+  // Newest valid slot first, then the single file of older firmware, then JSON
+  if(SD_FindSlot(&config, &sequence) < 0 && !SD_ReadConfig(legacyFileName, &config, &sequence) && !SD_ImportJson(&config))
   {
-    PrintChars(width - numChars, c);
+    return false;
   }
 
-  lcd.print(value);
-  if(!isRight)
+  xSemaphoreTake(configMutex, portMAX_DELAY);
+  _config = config;
+  Config_SyncTime();
+  xSemaphoreGive(configMutex);
+
+  configLoadMicros = HalMicros() - startMicros;
+  return true;
+}
+
+bool SD_Save()
+{
+  uint32_t startMicros = HalMicros();
+  Configuration config;
+  uint32_t sequence = 0;
+
+  // Only the slot without the newest copy is rewritten, a power cut leaves the other one intact
+  int8_t slot = SD_FindSlot(&config, &sequence);
+  uint8_t target = (slot == 0) ? 1 : 0;
+
+  if(!SD_WriteConfig(slotFileNames[target], sequence + 1))
   {
-    PrintChars(width - numChars, c);
+    return false;
   }
+
+  configSaveMicros = HalMicros() - startMicros;
+  return true;
 }
 
-void PrintFloatAtWidth(float value, uint8_t width, char c, boolean isRight)
+// Encoded config to one file, read back to check it
+bool SD_WriteConfig(const char *name, uint32_t sequence)
 {
-  uint8_t numChars = GetFloatCharCnt(value);
-  if(isRight)
+  xSemaphoreTake(configMutex, portMAX_DELAY);
+  configSnapshot = _config;
+  xSemaphoreGive(configMutex);
+
+  size_t length = Config_Encode(&configSnapshot, sequence, configBuffer, CONFIG_BUFFER_SIZE);
+  if(length == 0)
   {
-    PrintChars(width - numChars, c);
+    return false;
   }
 
-  lcd.print(value);
-  if(!isRight)
+  if(!HalFileWrite(name, configBuffer, length))
   {
-    PrintChars(width - numChars, c);
+    return false;
   }
-}
 
-void CheckPositionEncoder()
-{
-  encoder->tick();
+  configSaveBytes = length;
+
+  Configuration config;
+  uint32_t writtenSequence;
+  return (SD_ReadConfig(name, &config, &writtenSequence) && writtenSequence == sequence);
 }
 
-void VolumeBottle(float *volumeBottle, float volume)
+bool SD_ReadConfig(const char *name, Configuration *config, uint32_t *sequence)
 {
-  *volumeBottle = *volumeBottle - volume; 
-
-  if(*volumeBottle < 50)
+  size_t length;
+  if(!HalFileRead(name, configBuffer, CONFIG_BUFFER_SIZE, &length))
   {
-    BUZZER.Long();
-    BUZZER.Double();
-    BUZZER.Long();
-    warningVolumeBottle = true;
+    return false;
   }
+
+  return Config_Decode(config, configBuffer, length, sequence);
 }
 
-void Set_Defaults()
+int8_t SD_FindSlot(Configuration *config, uint32_t *sequence)
 {
-  SD.remove(fileName);
-  File file = SD.open(fileName, FILE_WRITE);
-  lcd.clear();
+  const Configuration base = *config;
+  Configuration candidate;
+  uint32_t candidateSequence;
+  int8_t slot = -1;
 
-  while(!file) 
-  {
-    lcd.setCursor(0, 0);
-    lcd.print("Create File Failed! ");
-  }
-
-  JsonDocument doc;
-
-  // WHITE LED
-  doc["whiteLed_onTimeHour"] = 12;
-  doc["whiteLed_onTimeMinute"] = 0;
-  doc["whiteLed_offTimeHour"] = 20;
-  doc["whiteLed_offTimeMinute"] = 0;
-  doc["whiteLed_rampUp"] = 30;
-  doc["whiteLed_rampDown"] = 30;
-  doc["whiteLed_maxDuty"] = 100;
-
-  // COLOR LED
-  doc["colorLed_onTimeHour"] = 12;
-  doc["colorLed_onTimeMinute"] = 0;
-  doc["colorLed_offTimeHour"] = 20;
-  doc["colorLed_offTimeMinute"] = 0;
-  doc["colorLed_rampUp"] = 30;
-  doc["colorLed_rampDown"] = 30;
-  doc["colorLed_maxDuty"] = 100;
-
-  // PUMP 1
-  doc["pump1_onTimeHour"] = 12;
-  doc["pump1_onTimeMinute"] = 0;
-  doc["pump1_duty"] = 100;
-  doc["pump1_volume"] = 5;
-  doc["pump1_calibrationOffset"] = 0;
-  doc["pump1_enable"] = false;
-
-  // PUMP 2
-  doc["pump2_onTimeHour"] = 12;
-  doc["pump2_onTimeMinute"] = 0;
-  doc["pump2_duty"] = 100;
-  doc["pump2_volume"] = 5;
-  doc["pump2_calibrationOffset"] = 0;
-  doc["pump2_enable"] = false;
-
-  // PUMP 3
-  doc["pump3_onTimeHour"] = 12;
-  doc["pump3_onTimeMinute"] = 0;
-  doc["pump3_duty"] = 100;
-  doc["pump3_volume"] = 5;
-  doc["pump3_calibrationOffset"] = 0;
-  doc["pump3_enable"] = false;
-
-  // PUMP 4
-  doc["pump4_onTimeHour"] = 12;
-  doc["pump4_onTimeMinute"] = 0;
-  doc["pump4_duty"] = 100;
-  doc["pump4_volume"] = 5;
-  doc["pump4_calibrationOffset"] = 0;
-  doc["pump4_enable"] = false;
-
-  if(serializeJson(doc, file) == 0) 
-  {
-    lcd.setCursor(0, 1);
-    lcd.print("Write To File Failed");
-  }
-  else
+  for(uint8_t i = 0; i < CONFIG_SLOT_COUNT; i++)
   {
-    lcd.setCursor(0, 2);
-    lcd.print("Default Values Set  ");
-    delay(1500);
+    candidate = base;
+    if(SD_ReadConfig(slotFileNames[i], &candidate, &candidateSequence) && (slot < 0 || candidateSequence > *sequence))
+    {
+      slot = i;
+      *sequence = candidateSequence;
+      *config = candidate;
+    }
   }
 
-  file.close();
-  SD_Load();
-  //buzzer.BeepSetDefault();
+  return slot;
 }
 
-void SD_Init()
+// Only a migration from older firmware reads the JSON file, so its arena is
+// taken from the heap for the import and given back, not kept in .bss
+bool SD_ImportJson(Configuration *config)
 {
-  while (!SD.begin(SD_PIN)) 
+  uint32_t startMicros = HalMicros();
+  if(!HalFileOpen(jsonFileName))
   {
-    lcd.setCursor(0, 0);
-    lcd.print(F("Failed To Initialize"));
-    lcd.setCursor(0, 1);
-    lcd.print(F("      SD Card!      "));
-    BUZZER.Long();
+    return false;
   }
 
-  lcd.setCursor(0, 0);
-  lcd.print(F("SD Card Initialized!"));
-  lcd.setCursor(0, 1);
-  lcd.print(F("Data Loading....    "));
-  delay(500);
-  SD_Load();
+  uint8_t *arenaBuffer = (uint8_t *)malloc(CONFIG_JSON_ARENA_SIZE);
+  if(arenaBuffer == nullptr)
+  {
+    HalFileClose();
+    return false;
+  }
+
+  ArenaAllocator arena(arenaBuffer, CONFIG_JSON_ARENA_SIZE);
+  bool isRead = SD_ReadJson(config, &arena);
+  HalFileClose();
+  configImportPeakBytes = arena.GetPeak();
+  free(arenaBuffer);
+  if(!isRead)
+  {
+    return false;
+  }
+
+  configImportMicros = HalMicros() - startMicros;
+  return true;
 }
 
-void SD_Load()
+// The documents are gone when this returns, before the arena is freed
+bool SD_ReadJson(Configuration *config, ArenaAllocator *arena)
 {
-  File file = SD.open(fileName);
-  if(!file)
+  // ArduinoJson has no event parser, a document is the least it builds. Only
+  // known keys are kept, the rest of the file is skipped while streaming, and
+  // filter and document both live in the arena. Its peak is shown on the
+  // Diagnostics page against CONFIG_JSON_ARENA_SIZE.
+  // Pump names are not settings (see Config.h), a pumpN_name key is dropped too
+  JsonDocument filter(arena);
+  for(size_t i = 0; i < CONFIG_FIELD_COUNT; i++)
   {
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print(F("File Not Available! "));
-    lcd.setCursor(0, 1);
-    lcd.print(F("Creating New File..."));
-    delay(1000);
-    SD_Save();
+    filter[configFields[i].name] = true;
   }
-  else
+
+  JsonDocument doc(arena);
+  HalFileStream stream;
+  DeserializationError error = deserializeJson(doc, stream, DeserializationOption::Filter(filter));
+  if(error)
   {
-    lcd.setCursor(0, 2);
-    lcd.print(F("Data Initialized!   "));
-    delay(1000);
+    return false;
   }
 
-  JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, file);
-  if(error)
+  for(size_t i = 0; i < CONFIG_FIELD_COUNT; i++)
   {
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print(F("Failed To Read File!"));
-    return;
+    JsonVariant value = doc[configFields[i].name];
+    void *field = Config_FieldPtr(config, &configFields[i]);
+    if(value.isNull()) {continue;}
+
+    switch (configFields[i].type)
+    {
+    case FIELD_UINT8:
+      *(uint8_t *)field = value.as<uint8_t>();
+      break;
+
+    case FIELD_MILLI:
+      *(int32_t *)field = Config_FloatToMilli(value.as<float>());
+      break;
+
+    case FIELD_BOOL:
+      *(bool *)field = value.as<bool>();
+      break;
+
+    case FIELD_KEYFRAME:
+    {
+      // [hour, minute, level, easing], the easing may be left out
+      JsonArray frame = value.as<JsonArray>();
+      *(uint32_t *)field = (frame.size() >= 3) ? LightProfile::Pack(frame[0].as<uint8_t>(), frame[1].as<uint8_t>(), frame[2].as<uint8_t>(),
+                                                                  (frame.size() > 3) ? frame[3].as<uint8_t>() : (uint8_t)EASING_LINEAR) : 0;
+      break;
+    }
+    }
   }
 
-  // WHITE LED
-  _config.whiteLed_onTimeHour = doc["whiteLed_onTimeHour"];
-  _config.whiteLed_onTimeMinute = doc["whiteLed_onTimeMinute"];
-  _config.whiteLed_offTimeHour = doc["whiteLed_offTimeHour"];
-  _config.whiteLed_offTimeMinute = doc["whiteLed_offTimeMinute"];
-  _config.whiteLed_rampUp = doc["whiteLed_rampUp"];
-  _config.whiteLed_rampDown = doc["whiteLed_rampDown"];
-  _config.whiteLed_maxDuty = doc["whiteLed_maxDuty"];
-
-  // COLOR LED
-  _config.colorLed_onTimeHour = doc["colorLed_onTimeHour"];
-  _config.colorLed_onTimeMinute = doc["colorLed_onTimeMinute"];
-  _config.colorLed_offTimeHour = doc["colorLed_offTimeHour"];
-  _config.colorLed_offTimeMinute = doc["colorLed_offTimeMinute"];
-  _config.colorLed_rampUp = doc["colorLed_rampUp"];
-  _config.colorLed_rampDown = doc["colorLed_rampDown"];
-  _config.colorLed_maxDuty = doc["colorLed_maxDuty"];
-
-  // PUMP 1
-  _config.pump1_onTimeHour = doc["pump1_onTimeHour"];
-  _config.pump1_onTimeMinute = doc["pump1_onTimeMinute"];
-  _config.pump1_duty = doc["pump1_duty"];
-  _config.pump1_volume_bottle = doc["pump1_volume_bottle"];
-  _config.pump1_volume = doc["pump1_volume"];
-  _config.pump1_calibrationOffset = doc["pump1_calibrationOffset"];
-  _config.pump1_enable = doc["pump1_enable"];
-
-  // PUMP 2
-  _config.pump2_onTimeHour = doc["pump2_onTimeHour"];
-  _config.pump2_onTimeMinute = doc["pump2_onTimeMinute"];
-  _config.pump2_duty = doc["pump2_duty"];
-  _config.pump2_volume_bottle = doc["pump2_volume_bottle"];
-  _config.pump2_volume = doc["pump2_volume"];
-  _config.pump2_calibrationOffset = doc["pump2_calibrationOffset"];
-  _config.pump2_enable = doc["pump2_enable"];
-
-  // PUMP 3
-  _config.pump3_onTimeHour = doc["pump3_onTimeHour"];
-  _config.pump3_onTimeMinute = doc["pump3_onTimeMinute"];
-  _config.pump3_duty = doc["pump3_duty"];
-  _config.pump3_volume_bottle = doc["pump3_volume_bottle"];
-  _config.pump3_volume = doc["pump3_volume"];
-  _config.pump3_calibrationOffset = doc["pump3_calibrationOffset"];
-  _config.pump3_enable = doc["pump3_enable"];
-
-  // PUMP 4
-  _config.pump4_onTimeHour = doc["pump4_onTimeHour"];
-  _config.pump4_onTimeMinute = doc["pump4_onTimeMinute"];
-  _config.pump4_duty = doc["pump4_duty"];
-  _config.pump4_volume_bottle = doc["pump4_volume_bottle"];
-  _config.pump4_volume = doc["pump4_volume"];
-  _config.pump4_calibrationOffset = doc["pump4_calibrationOffset"];
-  _config.pump4_enable = doc["pump4_enable"];
-
-  // RTC
-  _config.years = currDateTime.year();
-  _config.months = currDateTime.month();
-  _config.days = currDateTime.day();
-  _config.hours = currDateTime.hour();
-  _config.minutes = currDateTime.minute();
-
-  file.close();
-}
-
-void SD_Save()
-{
-  SD.remove(fileName);
-  File file = SD.open(fileName, FILE_WRITE);
-  lcd.clear();
+  return true;
+}
 
-  while(!file) 
-  {
-    lcd.setCursor(0, 0);
-    lcd.print("Create File Failed! ");
-    BUZZER.Long();
-    delay(1000);
-  }
-
-  JsonDocument doc;
-
-  // WHITE LED
-  doc["whiteLed_onTimeHour"] = _config.whiteLed_onTimeHour;
-  doc["whiteLed_onTimeMinute"] = _config.whiteLed_onTimeMinute;
-  doc["whiteLed_offTimeHour"] = _config.whiteLed_offTimeHour;
-  doc["whiteLed_offTimeMinute"] = _config.whiteLed_offTimeMinute;
-  doc["whiteLed_rampUp"] = _config.whiteLed_rampUp;
-  doc["whiteLed_rampDown"] = _config.whiteLed_rampDown;
-  doc["whiteLed_maxDuty"] = _config.whiteLed_maxDuty;
-
-  // COLOR LED
-  doc["colorLed_onTimeHour"] = _config.colorLed_onTimeHour;
-  doc["colorLed_onTimeMinute"] = _config.colorLed_onTimeMinute;
-  doc["colorLed_offTimeHour"] = _config.colorLed_offTimeHour;
-  doc["colorLed_offTimeMinute"] = _config.colorLed_offTimeMinute;
-  doc["colorLed_rampUp"] = _config.colorLed_rampUp;
-  doc["colorLed_rampDown"] = _config.colorLed_rampDown;
-  doc["colorLed_maxDuty"] = _config.colorLed_maxDuty;
-
-  // PUMP 1
-  doc["pump1_onTimeHour"] = _config.pump1_onTimeHour;
-  doc["pump1_onTimeMinute"] = _config.pump1_onTimeMinute;
-  doc["pump1_duty"] = _config.pump1_duty;
-  doc["pump1_volume_bottle"] = _config.pump1_volume_bottle;
-  doc["pump1_volume"] = _config.pump1_volume;
-  doc["pump1_calibrationOffset"] = _config.pump1_calibrationOffset;
-  doc["pump1_enable"] = _config.pump1_enable;
-
-  // PUMP 2
-  doc["pump2_onTimeHour"] = _config.pump2_onTimeHour;
-  doc["pump2_onTimeMinute"] = _config.pump2_onTimeMinute;
-  doc["pump2_duty"] = _config.pump2_duty;
-  doc["pump2_volume_bottle"] = _config.pump2_volume_bottle;
-  doc["pump2_volume"] = _config.pump2_volume;
-  doc["pump2_calibrationOffset"] = _config.pump2_calibrationOffset;
-  doc["pump2_enable"] = _config.pump2_enable;
-
-  // PUMP 3
-  doc["pump3_onTimeHour"] = _config.pump3_onTimeHour;
-  doc["pump3_onTimeMinute"] = _config.pump3_onTimeMinute;
-  doc["pump3_duty"] = _config.pump3_duty;
-  doc["pump3_volume_bottle"] = _config.pump3_volume_bottle;
-  doc["pump3_volume"] = _config.pump3_volume;
-  doc["pump3_calibrationOffset"] = _config.pump3_calibrationOffset;
-  doc["pump3_enable"] = _config.pump3_enable;
-
-  // PUMP 4
-  doc["pump4_onTimeHour"] = _config.pump4_onTimeHour;
-  doc["pump4_onTimeMinute"] = _config.pump4_onTimeMinute;
-  doc["pump4_duty"] = _config.pump4_duty;
-  doc["pump4_volume_bottle"] = _config.pump4_volume_bottle;
-  doc["pump4_volume"] = _config.pump4_volume;
-  doc["pump4_calibrationOffset"] = _config.pump4_calibrationOffset;
-  doc["pump4_enable"] = _config.pump4_enable;
-
-  // RTC
-  //doc["hour"] = _config.hours;
-  //doc["minute"] = _config.minutes;
-
-  while(serializeJson(doc, file) == 0)
-  {
-    lcd.setCursor(0, 1);
-    lcd.print("Write To File Failed");
-    BUZZER.Long();
-    delay(1000);
-  }
-
-  if(serializeJson(doc, file) != 0)
-  {
-    lcd.setCursor(0, 1);
-    lcd.print("  Write To File Ok  ");
-    delay(1000);
-  }
-
-  file.close();
+void Config_SyncTime()
+{
+  _config.years = currDateTime.year;
+  _config.months = currDateTime.month;
+  _config.days = currDateTime.day;
+  _config.hours = currDateTime.hour;
+  _config.minutes = currDateTime.minute;
 }
 
 void LCD_Init()
@@ -2922,6 +3358,7 @@ void LCD_Init()
   lcd.print("V1.4 by Paul");
   lcd.setCursor(0, 3);
   lcd.print("####################");
-  delay(1500);
+  lcd.Flush();
+  HalDelay(1500);
   lcd.clear();
 }
\ No newline at end of file
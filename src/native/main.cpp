@@ -0,0 +1,287 @@
+//##############################//
+//        Aqua Controller       //
+//      Schedule Simulator      //
+//##############################//
+
+// Runs the control loop on the host against the simulated RTC and PWM in
+// lib/Hal, on a virtual clock. The loop steps PACING_MS while a LED ramps, a
+// pump runs or the weather is on and jumps to the next RTC second otherwise,
+// so a month takes a few seconds. The weather is seeded with the day, two
+// runs of the same config give the same trace. Every PWM change, pump start/stop and bottle volume update
+// goes to the trace. Built with PCA9685_BOARDS, the expansion channels are
+// traced too, each board flushed once per step.
+//
+//   native [-d days] [-t HH:MM] [-c config.bin] [-o trace] [-b]
+//
+//   -d  days to simulate, default 30
+//   -t  start time on 2024/1/1, default 0:00
+//   -c  config exported to SD (config_a.bin / config_b.bin), default is a
+//       built in config with all four pumps enabled
+//   -o  trace file, default stdout
+//   -b  binary trace of TraceRecord instead of CSV
+
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+#include <Hal.h>
+#include <TimeRTC.h>
+#include <Pump.h>
+#include <Led.h>
+#include <Buzzer.h>
+#include <Config.h>
+#include <Controller.h>
+
+#define BUZZER_PIN        PA8
+#define RTC_SQW_PIN       PB1
+#define PACING_MS         10
+#define SIM_DAYS          30
+#define PUMP_COUNT        4
+
+enum traceEventType
+{
+  TRACE_PWM,
+  TRACE_PUMP_START,
+  TRACE_PUMP_STOP,
+  TRACE_BOTTLE
+};
+
+// 12 bytes, little endian. For pwm the channel is the pin (PA0 = 0 .. PB15 =
+// 31, expansion channels from HAL_SIM_EXPANDER_PIN) and value the duty
+// 0..4095, pumps are numbered 1..4 and bottle values are the volume in
+// thousandths of a ml, signed.
+struct TraceRecord
+{
+  uint32_t second;
+  uint16_t millis;
+  uint8_t type;
+  uint8_t channel;
+  uint32_t value;
+};
+
+TimeRTC timeRTC;
+Pump pump_1(PA0);
+Pump pump_2(PA1);
+Pump pump_3(PA2);
+Pump pump_4(PA3);
+Led whiteLed(PA9, LedCurve<LED_WHITE_GAMMA>::Get());
+Led colorLed(PA10, LedCurve<LED_COLOR_GAMMA>::Get());
+Pump *pumps[] = {&pump_1, &pump_2, &pump_3, &pump_4};
+Controller controller(&_config, &timeRTC, pumps, &whiteLed, &colorLed);
+#if PCA9685_BOARDS > 0
+Pca9685 ledBoards[PCA9685_BOARDS];
+#endif
+
+const char *traceNames[] = {"pwm", "pump_start", "pump_stop", "bottle"};
+FILE *traceFile = stdout;
+bool isBinary = false;
+uint64_t simMillis = 0;
+uint32_t traceCount = 0;
+
+// TRACE -------------------------------------
+void Trace(uint8_t type, uint8_t channel, uint32_t value)
+{
+  TraceRecord record = {(uint32_t)(simMillis / 1000), (uint16_t)(simMillis % 1000), type, channel, value};
+  traceCount++;
+
+  if(isBinary)
+  {
+    fwrite(&record, sizeof(record), 1, traceFile);
+    return;
+  }
+
+  if(type == TRACE_BOTTLE)
+  {
+    int32_t volume = (int32_t)value;
+    fprintf(traceFile, "%u.%03u,%s,%u,%s%d.%02d\n", record.second, record.millis, traceNames[type], channel, volume < 0 ? "-" : "",
+            abs(volume) / 1000, abs(volume) % 1000 / 10);
+  }
+  else
+  {
+    fprintf(traceFile, "%u.%03u,%s,%u,%u\n", record.second, record.millis, traceNames[type], channel, value);
+  }
+}
+
+void TracePwm(uint32_t pin, uint32_t value)
+{
+  Trace(TRACE_PWM, pin, value);
+}
+
+int32_t *BottleVolume(uint8_t pump)
+{
+  switch (pump)
+  {
+    case 0: return &_config.pump1_volume_bottle;
+    case 1: return &_config.pump2_volume_bottle;
+    case 2: return &_config.pump3_volume_bottle;
+    default: return &_config.pump4_volume_bottle;
+  }
+}
+
+// CONFIG -------------------------------------
+bool LoadConfig(const char *name)
+{
+  uint8_t buffer[512];
+  FILE *file = fopen(name, "rb");
+  if(file == nullptr)
+  {
+    return false;
+  }
+
+  size_t length = fread(buffer, 1, sizeof(buffer), file);
+  fclose(file);
+
+  uint32_t sequence;
+  return Config_Decode(&_config, buffer, length, &sequence);
+}
+
+void DefaultConfig()
+{
+  _config.pump1_enable = true;
+  _config.pump1_onTimeHour = 8;
+  _config.pump2_enable = true;
+  _config.pump2_onTimeHour = 9;
+  _config.pump3_enable = true;
+  _config.pump3_onTimeHour = 10;
+  _config.pump4_enable = true;
+  _config.pump4_onTimeHour = 11;
+}
+
+// =======================================================================//
+//                                  MAIN                                  //
+// =======================================================================//
+int main(int argc, char **argv)
+{
+  uint32_t days = SIM_DAYS;
+  const char *configName = nullptr;
+  const char *traceName = nullptr;
+  unsigned startHour = 0;
+  unsigned startMinute = 0;
+  int option;
+
+  while((option = getopt(argc, argv, "d:t:c:o:b")) != -1)
+  {
+    switch (option)
+    {
+      case 'd': days = strtoul(optarg, nullptr, 10); break;
+      case 't': sscanf(optarg, "%u:%u", &startHour, &startMinute); break;
+      case 'c': configName = optarg; break;
+      case 'o': traceName = optarg; break;
+      case 'b': isBinary = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-d days] [-t HH:MM] [-c config.bin] [-o trace] [-b]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  if(configName != nullptr && !LoadConfig(configName))
+  {
+    fprintf(stderr, "cannot load config %s\n", configName);
+    return 1;
+  }
+
+  if(configName == nullptr)
+  {
+    DefaultConfig();
+  }
+
+  if(traceName != nullptr && (traceFile = fopen(traceName, isBinary ? "wb" : "w")) == nullptr)
+  {
+    fprintf(stderr, "cannot open trace %s\n", traceName);
+    return 1;
+  }
+
+  if(!isBinary)
+  {
+    fprintf(traceFile, "time_s,event,channel,value\n");
+  }
+
+  clock_t startClock = clock();
+  HalSimSetRtc(2024, 1, 1, startHour % 24, startMinute % 60, 0);
+
+  // The RTC counts from here, the buzzer start up below already takes time off the clock
+  uint64_t endMillis = HalMillis() + (uint64_t)days * 86400000ULL;
+  HalSimSetPwmHook(TracePwm);
+  HalBegin();
+  BUZZER.InitBuzzer(BUZZER_PIN);
+  simMillis = HalMillis();
+
+#if PCA9685_BOARDS > 0
+  for(uint8_t board = 0; board < PCA9685_BOARDS; board++)
+  {
+    ledBoards[board].Begin(HAL_EXPANDER_ADDRESS + board);
+    for(uint8_t channel = 0; channel < PCA9685_CHANNELS; channel++)
+    {
+      bool isColor = (PCA9685_COLOR_CHANNELS >> channel) & 1;
+      Led *led = new Led(&ledBoards[board], channel, isColor ? LedCurve<LED_COLOR_GAMMA>::Get() : LedCurve<LED_WHITE_GAMMA>::Get());
+      controller.AttachLed(led, isColor ? LED_GROUP_COLOR : LED_GROUP_WHITE);
+    }
+  }
+#endif
+
+  controller.ApplyConfig();
+  timeRTC.Begin(RTC_SQW_PIN);
+  timeRTC.Tick();
+  controller.CheckLedRepeatOn();
+
+  bool pumpOn[PUMP_COUNT] = {};
+  int32_t bottle[PUMP_COUNT];
+  for(uint8_t i = 0; i < PUMP_COUNT; i++)
+  {
+    bottle[i] = *BottleVolume(i);
+  }
+
+  while(simMillis < endMillis)
+  {
+    bool isBusy = whiteLed.IsRamping() || colorLed.IsRamping() || _config.weather_mode != WEATHER_OFF;
+    for(uint8_t i = 0; i < PUMP_COUNT; i++)
+    {
+      isBusy |= pumps[i]->IsEnable();
+    }
+
+    // The simulated RTC ticks on whole seconds of the HAL clock
+    uint32_t step = isBusy ? PACING_MS : 1000 - (uint32_t)(simMillis % 1000);
+    if(step > endMillis - simMillis)
+    {
+      step = (uint32_t)(endMillis - simMillis);
+    }
+    HalSimAdvance(step);
+    simMillis += step;
+
+    timeRTC.Tick();
+    controller.Tick();
+    BUZZER.Tick();
+#if PCA9685_BOARDS > 0
+    for(uint8_t board = 0; board < PCA9685_BOARDS; board++)
+    {
+      ledBoards[board].Flush();
+    }
+#endif
+
+    for(uint8_t i = 0; i < PUMP_COUNT; i++)
+    {
+      if(pumps[i]->IsEnable() != pumpOn[i])
+      {
+        pumpOn[i] = pumps[i]->IsEnable();
+        Trace(pumpOn[i] ? TRACE_PUMP_START : TRACE_PUMP_STOP, i + 1, 0);
+      }
+
+      if(*BottleVolume(i) != bottle[i])
+      {
+        bottle[i] = *BottleVolume(i);
+        Trace(TRACE_BOTTLE, i + 1, (uint32_t)bottle[i]);
+      }
+    }
+  }
+
+  if(traceFile != stdout)
+  {
+    fclose(traceFile);
+  }
+
+  fprintf(stderr, "%u days, %u trace records, %.2f s, ends %s%s\n", days, traceCount, (double)(clock() - startClock) / CLOCKS_PER_SEC,
+          timeRTC.GetCurrentTimeStr(), controller.IsBottleWarning() ? ", low bottle" : "");
+#if PCA9685_BOARDS > 0
+  fprintf(stderr, "%u expander writes\n", HalSimGetExpanderWrites());
+#endif
+  return 0;
+}
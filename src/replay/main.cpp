@@ -0,0 +1,194 @@
+//##############################//
+//        Aqua Controller       //
+//         Input Replay         //
+//##############################//
+
+// Runs the real firmware in src/main.cpp on the host, with the tasks on the
+// cooperative scheduler in lib/Hal and the encoder and button replaced by the
+// stand-ins in lib/InputLog, then feeds them a recorded input log at the
+// original uptime. The same log always gives the same screens, so a menu bug
+// seen on the device can be replayed and stepped through in a debugger.
+//
+//   replay [-s settle_ms] log
+//
+//   log  inputs.bin exported with the config, or a text script with one
+//        "<millis> <enc|click|double|long_start|long_stop> [steps]" per line
+//   -s   time to keep running after the last input, default 1000 ms
+//
+// Prints the host time and the LCD bytes per Ui frame, then the last screen.
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <Hal.h>
+#include <HalRtos.h>
+#include <TimeRTC.h>
+#include <InputLog.h>
+#include <InputReplay.h>
+
+#define REPLAY_MAX_RECORDS    4096
+#define REPLAY_SETTLE_MS      1000
+#define REPLAY_TASK_STACK     256
+#define REPLAY_TASK_PRIORITY  (tskIDLE_PRIORITY + 4)
+
+void setup();
+
+struct FrameStats
+{
+  uint32_t count;
+  uint64_t totalMicros;
+  uint32_t minMicros;
+  uint32_t maxMicros;
+  uint64_t totalBytes;
+  uint32_t maxBytes;
+};
+
+const char *eventNames[] = {"enc", "click", "double", "long_start", "long_stop"};
+InputRecord records[REPLAY_MAX_RECORDS];
+uint32_t recordCount = 0;
+uint32_t settleMillis = REPLAY_SETTLE_MS;
+FrameStats uiStats = {0, 0, UINT32_MAX, 0, 0, 0};
+uint32_t lastDisplayBytes = 0;
+
+// LOG -------------------------------------
+bool LoadBinary(FILE *file)
+{
+  recordCount = fread(records, sizeof(InputRecord), REPLAY_MAX_RECORDS, file);
+  return recordCount > 0;
+}
+
+bool LoadScript(FILE *file)
+{
+  char line[80];
+  char name[16];
+
+  while(fgets(line, sizeof(line), file) != nullptr && recordCount < REPLAY_MAX_RECORDS)
+  {
+    unsigned long millis;
+    int value = 1;
+    int fields = sscanf(line, "%lu %15s %d", &millis, name, &value);
+    if(fields < 2 || line[0] == '#')
+    {
+      continue;
+    }
+
+    uint8_t type = 0;
+    while(type < sizeof(eventNames) / sizeof(eventNames[0]) && strcmp(name, eventNames[type]) != 0)
+    {
+      type++;
+    }
+
+    if(type == sizeof(eventNames) / sizeof(eventNames[0]))
+    {
+      fprintf(stderr, "unknown input %s\n", name);
+      return false;
+    }
+
+    records[recordCount++] = {(uint32_t)millis, 0, type, (int8_t)(type == INPUT_ENCODER ? value : 0), 0};
+  }
+
+  return recordCount > 0;
+}
+
+bool LoadLog(const char *name)
+{
+  FILE *file = fopen(name, "rb");
+  if(file == nullptr)
+  {
+    return false;
+  }
+
+  size_t length = strlen(name);
+  bool isBinary = length > 4 && strcmp(name + length - 4, ".bin") == 0;
+  bool isLoaded = isBinary ? LoadBinary(file) : LoadScript(file);
+  fclose(file);
+  return isLoaded;
+}
+
+// TASKS -------------------------------------
+void ReplayTask(void *parameters)
+{
+  for(uint32_t i = 0; i < recordCount; i++)
+  {
+    uint32_t now = HalMillis();
+    if((int32_t)(records[i].millis - now) > 0)
+    {
+      vTaskDelay(pdMS_TO_TICKS(records[i].millis - now));
+    }
+
+    ReplayInput(records[i]);
+  }
+
+  vTaskDelay(pdMS_TO_TICKS(settleMillis));
+  vTaskEndScheduler();
+  vTaskDelay(portMAX_DELAY);
+}
+
+void TaskHook(const char *name, uint32_t hostMicros)
+{
+  uint32_t displayBytes = HalSimGetDisplayBytes();
+  uint32_t frameBytes = displayBytes - lastDisplayBytes;
+  lastDisplayBytes = displayBytes;
+
+  if(strcmp(name, "Ui") != 0)
+  {
+    return;
+  }
+
+  uiStats.count++;
+  uiStats.totalMicros += hostMicros;
+  uiStats.totalBytes += frameBytes;
+  if(hostMicros < uiStats.minMicros) {uiStats.minMicros = hostMicros;}
+  if(hostMicros > uiStats.maxMicros) {uiStats.maxMicros = hostMicros;}
+  if(frameBytes > uiStats.maxBytes) {uiStats.maxBytes = frameBytes;}
+}
+
+// =======================================================================//
+//                                  MAIN                                  //
+// =======================================================================//
+int main(int argc, char **argv)
+{
+  int option;
+
+  while((option = getopt(argc, argv, "s:")) != -1)
+  {
+    switch (option)
+    {
+      case 's': settleMillis = strtoul(optarg, nullptr, 10); break;
+      default:
+        fprintf(stderr, "usage: %s [-s settle_ms] log\n", argv[0]);
+        return 2;
+    }
+  }
+
+  if(optind >= argc || !LoadLog(argv[optind]))
+  {
+    fprintf(stderr, "cannot load input log %s\n", optind < argc ? argv[optind] : "");
+    return 1;
+  }
+
+  // Start the RTC where it was at boot, so the screens show the same time
+  if(records[0].unixTime != 0)
+  {
+    RtcDateTime dt = TimeRTC::FromUnixTime(records[0].unixTime - records[0].millis / 1000);
+    HalSimSetRtc(dt.year, dt.month, dt.day, dt.hour, dt.minute, dt.second);
+  }
+
+  HalSimSetTaskHook(TaskHook);
+  xTaskCreate(ReplayTask, "Replay", REPLAY_TASK_STACK, NULL, REPLAY_TASK_PRIORITY, NULL);
+  setup();
+
+  printf("%u inputs, ends at %u ms\n", recordCount, HalMillis());
+  if(uiStats.count > 0)
+  {
+    printf("ui frames %u, host us min %u avg %u max %u, lcd bytes avg %.1f max %u\n", uiStats.count, uiStats.minMicros,
+           (uint32_t)(uiStats.totalMicros / uiStats.count), uiStats.maxMicros, (double)uiStats.totalBytes / uiStats.count, uiStats.maxBytes);
+  }
+
+  for(uint8_t row = 0; row < 4; row++)
+  {
+    printf("|%s|\n", HalSimGetDisplayRow(row));
+  }
+
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include <unity.h>
+#include <string.h>
+#include <Config.h>
+#include <Crc32.h>
+#include <LightProfile.h>
+
+// The config file codec: a header with a CRC-32 over a MessagePack map of
+// the configFields keys. Whatever is encoded decodes to the same fields, and
+// a file that does not check out leaves the config untouched.
+
+#define TEST_BUFFER_SIZE 512
+
+uint8_t buffer[TEST_BUFFER_SIZE];
+Configuration config;
+
+void setUp()
+{
+    config = Configuration();
+    config.whiteLed_onTimeHour = 7;
+    config.whiteLed_maxDuty = 65;
+    config.whiteLed_keyframes[2] = LightProfile::Pack(9, 30, 80, EASING_LINEAR);
+    config.weather_mode = 2;
+    config.pump1_volume = 12300;
+    config.pump1_volume_bottle = 321500;
+    config.pump3_enable = true;
+}
+
+void tearDown()
+{
+}
+
+void Test_Crc32CheckValue()
+{
+    const char *check = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, Crc32((const uint8_t *)check, 9));
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926UL, Crc32((const uint8_t *)check + 4, 5, Crc32((const uint8_t *)check, 4)));
+}
+
+void Test_RoundTrip()
+{
+    Configuration decoded;
+    uint32_t sequence = 0;
+    size_t length = Config_Encode(&config, 42, buffer, TEST_BUFFER_SIZE);
+
+    TEST_ASSERT_TRUE(length > sizeof(ConfigHeader));
+    TEST_ASSERT_TRUE(Config_Decode(&decoded, buffer, length, &sequence));
+    TEST_ASSERT_EQUAL_UINT32(42, sequence);
+
+    for(size_t i = 0; i < CONFIG_FIELD_COUNT; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(Config_GetBits(&config, &configFields[i]), Config_GetBits(&decoded, &configFields[i]));
+    }
+}
+
+void Test_RejectsCorruptPayload()
+{
+    Configuration decoded;
+    uint32_t sequence = 0;
+    size_t length = Config_Encode(&config, 1, buffer, TEST_BUFFER_SIZE);
+
+    buffer[length - 1] ^= 0x01;
+    TEST_ASSERT_FALSE(Config_Decode(&decoded, buffer, length, &sequence));
+    TEST_ASSERT_EQUAL_UINT8(Configuration().whiteLed_onTimeHour, decoded.whiteLed_onTimeHour);
+}
+
+void Test_RejectsCorruptCrc()
+{
+    Configuration decoded;
+    uint32_t sequence = 0;
+    size_t length = Config_Encode(&config, 1, buffer, TEST_BUFFER_SIZE);
+
+    buffer[offsetof(ConfigHeader, crc)] ^= 0x80;
+    TEST_ASSERT_FALSE(Config_Decode(&decoded, buffer, length, &sequence));
+}
+
+void Test_RejectsTruncated()
+{
+    Configuration decoded;
+    uint32_t sequence = 0;
+    size_t length = Config_Encode(&config, 1, buffer, TEST_BUFFER_SIZE);
+
+    TEST_ASSERT_FALSE(Config_Decode(&decoded, buffer, length - 1, &sequence));
+    TEST_ASSERT_FALSE(Config_Decode(&decoded, buffer, CONFIG_HEADER_V1_SIZE - 1, &sequence));
+}
+
+void Test_EncodeOverflow()
+{
+    TEST_ASSERT_EQUAL_UINT32(0, Config_Encode(&config, 1, buffer, sizeof(ConfigHeader)));
+    TEST_ASSERT_EQUAL_UINT32(0, Config_Encode(&config, 1, buffer, 64));
+}
+
+void Test_MilliKeepsThousandths()
+{
+    TEST_ASSERT_EQUAL_INT(12300, Config_FloatToMilli(Config_MilliToFloat(12300)));
+    TEST_ASSERT_EQUAL_INT(-2500, Config_FloatToMilli(Config_MilliToFloat(-2500)));
+    TEST_ASSERT_EQUAL_INT(450000, Config_FloatToMilli(Config_MilliToFloat(450000)));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_Crc32CheckValue);
+    RUN_TEST(Test_RoundTrip);
+    RUN_TEST(Test_RejectsCorruptPayload);
+    RUN_TEST(Test_RejectsCorruptCrc);
+    RUN_TEST(Test_RejectsTruncated);
+    RUN_TEST(Test_EncodeOverflow);
+    RUN_TEST(Test_MilliKeepsThousandths);
+    return UNITY_END();
+}
@@ -0,0 +1,105 @@
+#include <unity.h>
+#include <Controller.h>
+
+// Controller against the simulated RTC: a clock set while the LEDs are on
+// resumes whatever the schedule has them in at the new time. The default
+// config has them on from 12:00 to 20:00 with 30 minute ramps.
+
+#define TEST_SQW_PIN        PB1
+#define TEST_WHITE_PIN      PA9
+#define TEST_COLOR_PIN      PA10
+
+Configuration config;
+TimeRTC timeRTC;
+Pump pump_1(PA0);
+Pump pump_2(PA1);
+Pump pump_3(PA2);
+Pump pump_4(PA3);
+Pump *pumps[] = {&pump_1, &pump_2, &pump_3, &pump_4};
+Led whiteLed(TEST_WHITE_PIN);
+Led colorLed(TEST_COLOR_PIN);
+Controller *controller;
+
+void TickFor(uint32_t ms)
+{
+    for(uint32_t elapsed = 0; elapsed < ms; elapsed += 100)
+    {
+        HalSimAdvance(100);
+        timeRTC.Tick();
+        controller->Tick();
+    }
+}
+
+void SetClock(uint8_t hour, uint8_t minute)
+{
+    timeRTC.SetTime({2024, 1, 1, hour, minute, 0});
+    TickFor(1000);
+}
+
+// Fully on in the middle of the afternoon
+void setUp()
+{
+    config = Configuration();
+    config.weather_mode = WEATHER_OFF;
+    whiteLed.Disable();
+    colorLed.Disable();
+    HalSimSetRtc(2024, 1, 1, 15, 0, 0);
+
+    controller = new Controller(&config, &timeRTC, pumps, &whiteLed, &colorLed);
+    controller->ApplyConfig();
+    timeRTC.Begin(TEST_SQW_PIN);
+    TickFor(1000);
+    TEST_ASSERT_TRUE(whiteLed.IsEnable());
+    TEST_ASSERT_EQUAL_UINT8(100, whiteLed.GetCurrentDuty());
+}
+
+void tearDown()
+{
+    delete controller;
+}
+
+void Test_JumpPastRampDownTurnsOff()
+{
+    SetClock(20, 45);
+    TEST_ASSERT_FALSE(whiteLed.IsEnable());
+    TEST_ASSERT_FALSE(colorLed.IsEnable());
+    TEST_ASSERT_EQUAL_UINT32(0, HalSimGetPwm(TEST_WHITE_PIN));
+    TEST_ASSERT_EQUAL_UINT32(0, HalSimGetPwm(TEST_COLOR_PIN));
+
+    // The next on event starts them again
+    SetClock(11, 59);
+    TickFor(60000);
+    TEST_ASSERT_TRUE(whiteLed.IsRamping());
+}
+
+void Test_JumpBeforeOnTurnsOff()
+{
+    SetClock(9, 0);
+    TEST_ASSERT_FALSE(whiteLed.IsEnable());
+    TEST_ASSERT_EQUAL_UINT32(0, HalSimGetPwm(TEST_WHITE_PIN));
+}
+
+void Test_JumpIntoRampDownFades()
+{
+    SetClock(20, 15);
+    TEST_ASSERT_TRUE(whiteLed.IsEnable());
+    TEST_ASSERT_TRUE(whiteLed.IsRamping());
+    TEST_ASSERT_UINT_WITHIN(2, 50, whiteLed.GetCurrentDuty());
+}
+
+void Test_JumpWithinWindowStaysOn()
+{
+    SetClock(18, 0);
+    TEST_ASSERT_TRUE(whiteLed.IsEnable());
+    TEST_ASSERT_EQUAL_UINT8(100, whiteLed.GetCurrentDuty());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_JumpPastRampDownTurnsOff);
+    RUN_TEST(Test_JumpBeforeOnTurnsOff);
+    RUN_TEST(Test_JumpIntoRampDownFades);
+    RUN_TEST(Test_JumpWithinWindowStaysOn);
+    return UNITY_END();
+}
@@ -0,0 +1,110 @@
+#include <unity.h>
+#include <FlashKv.h>
+
+// FlashKv over the RAM pages of the host build. The pages outlive a FlashKv,
+// so a second one opened with Begin() sees what a reboot would.
+
+FlashKv flashKv;
+
+void setUp()
+{
+    TEST_ASSERT_TRUE(flashKv.Format());
+}
+
+void tearDown()
+{
+}
+
+void Test_WriteRead()
+{
+    uint32_t value = 0;
+
+    TEST_ASSERT_TRUE(flashKv.IsEmpty());
+    TEST_ASSERT_FALSE(flashKv.Read(1, &value));
+
+    TEST_ASSERT_TRUE(flashKv.Write(1, 1234));
+    TEST_ASSERT_TRUE(flashKv.Write(2, 0xFFFFFFFFUL));
+    TEST_ASSERT_TRUE(flashKv.Write(1, 5678));
+    TEST_ASSERT_FALSE(flashKv.IsEmpty());
+
+    TEST_ASSERT_TRUE(flashKv.Read(1, &value));
+    TEST_ASSERT_EQUAL_UINT32(5678, value);
+    TEST_ASSERT_TRUE(flashKv.Read(2, &value));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFUL, value);
+    TEST_ASSERT_FALSE(flashKv.Write(FLASH_KV_EMPTY, 1));
+}
+
+void Test_UnchangedWriteIsFree()
+{
+    TEST_ASSERT_TRUE(flashKv.Write(3, 42));
+    uint16_t freeRecords = flashKv.GetFreeRecords();
+
+    TEST_ASSERT_TRUE(flashKv.Write(3, 42));
+    TEST_ASSERT_EQUAL_UINT16(freeRecords, flashKv.GetFreeRecords());
+    TEST_ASSERT_TRUE(flashKv.Write(3, 43));
+    TEST_ASSERT_EQUAL_UINT16(freeRecords - 1, flashKv.GetFreeRecords());
+}
+
+void Test_CompactionKeepsLatest()
+{
+    uint32_t value = 0;
+    uint32_t sequence = flashKv.GetSequence();
+
+    for(uint16_t key = 1; key <= 4; key++)
+    {
+        TEST_ASSERT_TRUE(flashKv.Write(key, key * 100));
+    }
+
+    // Fill the page with one key, the next write moves the four live keys over
+    for(uint32_t i = 0; flashKv.GetFreeRecords() > 0; i++)
+    {
+        TEST_ASSERT_TRUE(flashKv.Write(1, 1000 + i));
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(sequence, flashKv.GetSequence());
+    TEST_ASSERT_TRUE(flashKv.Write(1, 7));
+    TEST_ASSERT_EQUAL_UINT32(sequence + 1, flashKv.GetSequence());
+    TEST_ASSERT_EQUAL_UINT16(FLASH_KV_RECORD_COUNT - 5, flashKv.GetFreeRecords());
+
+    TEST_ASSERT_TRUE(flashKv.Read(1, &value));
+    TEST_ASSERT_EQUAL_UINT32(7, value);
+    for(uint16_t key = 2; key <= 4; key++)
+    {
+        TEST_ASSERT_TRUE(flashKv.Read(key, &value));
+        TEST_ASSERT_EQUAL_UINT32(key * 100, value);
+    }
+}
+
+void Test_ReopenFindsNewestPage()
+{
+    uint32_t value = 0;
+
+    // Enough updates to go around every page once
+    for(uint32_t i = 0; i < FLASH_KV_PAGE_COUNT * FLASH_KV_RECORD_COUNT; i++)
+    {
+        TEST_ASSERT_TRUE(flashKv.Write(1 + i % 3, i));
+    }
+
+    FlashKv reopened;
+    TEST_ASSERT_TRUE(reopened.Begin());
+    TEST_ASSERT_EQUAL_UINT32(flashKv.GetSequence(), reopened.GetSequence());
+    TEST_ASSERT_EQUAL_UINT16(flashKv.GetFreeRecords(), reopened.GetFreeRecords());
+
+    for(uint16_t key = 1; key <= 3; key++)
+    {
+        uint32_t expected = 0;
+        TEST_ASSERT_TRUE(flashKv.Read(key, &expected));
+        TEST_ASSERT_TRUE(reopened.Read(key, &value));
+        TEST_ASSERT_EQUAL_UINT32(expected, value);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_WriteRead);
+    RUN_TEST(Test_UnchangedWriteIsFree);
+    RUN_TEST(Test_CompactionKeepsLatest);
+    RUN_TEST(Test_ReopenFindsNewestPage);
+    return UNITY_END();
+}
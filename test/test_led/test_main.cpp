@@ -0,0 +1,123 @@
+#include <unity.h>
+#include <Led.h>
+
+// Led ramps against the simulated clock. A ramp is a function of the time
+// since it began, so how often Tick() runs only changes how smooth it is.
+
+#define TEST_LED_PIN    PA9
+#define TEST_RAMP_MIN   10
+#define TEST_RAMP_MS    (TEST_RAMP_MIN * 60000UL)
+
+Led led(TEST_LED_PIN);
+
+uint32_t FullScaleCounts()
+{
+    return LedCurve_Counts(LedCurve<>::Get()[HAL_PWM_MAX]);
+}
+
+void TickFor(uint32_t ms, uint32_t stepMs)
+{
+    for(uint32_t elapsed = 0; elapsed < ms; elapsed += stepMs)
+    {
+        HalSimAdvance(stepMs);
+        led.Tick();
+    }
+}
+
+void setUp()
+{
+    led.Disable();
+    led.SetEffect(LED_EFFECT_ONE, 0);
+    led.SetParameters(100, TEST_RAMP_MIN, TEST_RAMP_MIN);
+}
+
+void tearDown()
+{
+}
+
+void Test_RampUpIsLinearInTime()
+{
+    led.Start();
+    TEST_ASSERT_TRUE(led.IsRamping());
+
+    TickFor(TEST_RAMP_MS / 4, 1000);
+    TEST_ASSERT_UINT_WITHIN(1, 25, led.GetCurrentDuty());
+    TickFor(TEST_RAMP_MS / 4, 1000);
+    TEST_ASSERT_UINT_WITHIN(1, 50, led.GetCurrentDuty());
+
+    TickFor(TEST_RAMP_MS / 2, 1000);
+    TEST_ASSERT_FALSE(led.IsRamping());
+    TEST_ASSERT_TRUE(led.IsEnable());
+    TEST_ASSERT_EQUAL_UINT8(100, led.GetCurrentDuty());
+    TEST_ASSERT_EQUAL_UINT32(FullScaleCounts(), HalSimGetPwm(TEST_LED_PIN));
+}
+
+void Test_LateTickKeepsEnd()
+{
+    led.Start();
+
+    // One tick after a long stall lands where a ticking ramp would be
+    HalSimAdvance(TEST_RAMP_MS / 2);
+    led.Tick();
+    TEST_ASSERT_UINT_WITHIN(1, 50, led.GetCurrentDuty());
+
+    HalSimAdvance(TEST_RAMP_MS);
+    led.Tick();
+    TEST_ASSERT_FALSE(led.IsRamping());
+    TEST_ASSERT_EQUAL_UINT8(100, led.GetCurrentDuty());
+}
+
+void Test_RampDownTurnsOff()
+{
+    led.Start();
+    TickFor(TEST_RAMP_MS, 10000);
+    led.Stop();
+
+    TickFor(TEST_RAMP_MS / 2, 1000);
+    TEST_ASSERT_UINT_WITHIN(1, 50, led.GetCurrentDuty());
+    TEST_ASSERT_TRUE(led.IsEnable());
+
+    TickFor(TEST_RAMP_MS / 2, 1000);
+    TEST_ASSERT_FALSE(led.IsRamping());
+    TEST_ASSERT_FALSE(led.IsEnable());
+    TEST_ASSERT_EQUAL_UINT8(0, led.GetCurrentDuty());
+    TEST_ASSERT_EQUAL_UINT32(0, HalSimGetPwm(TEST_LED_PIN));
+}
+
+void Test_ResumeMidRamp()
+{
+    // After a reboot 3/4 into the morning ramp
+    led.Resume(true, TEST_RAMP_MS * 3 / 4 / 1000);
+    led.Tick();
+    TEST_ASSERT_UINT_WITHIN(1, 75, led.GetCurrentDuty());
+
+    TickFor(TEST_RAMP_MS / 4, 1000);
+    TEST_ASSERT_FALSE(led.IsRamping());
+    TEST_ASSERT_EQUAL_UINT8(100, led.GetCurrentDuty());
+}
+
+void Test_PartialRampTakesItsShare()
+{
+    led.SetParameters(50, TEST_RAMP_MIN, TEST_RAMP_MIN);
+    led.Start();
+    TickFor(TEST_RAMP_MS, 10000);
+    TEST_ASSERT_EQUAL_UINT8(49, led.GetCurrentDuty());
+
+    // Half the way down takes half the ramp time
+    led.SetParameters(100, TEST_RAMP_MIN, TEST_RAMP_MIN);
+    led.Stop();
+    TickFor(TEST_RAMP_MS / 2, 1000);
+    TEST_ASSERT_FALSE(led.IsRamping());
+    TEST_ASSERT_EQUAL_UINT8(0, led.GetCurrentDuty());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_RampUpIsLinearInTime);
+    RUN_TEST(Test_LateTickKeepsEnd);
+    RUN_TEST(Test_RampDownTurnsOff);
+    RUN_TEST(Test_ResumeMidRamp);
+    RUN_TEST(Test_PartialRampTakesItsShare);
+    return UNITY_END();
+}
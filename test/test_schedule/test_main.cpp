@@ -0,0 +1,128 @@
+#include <unity.h>
+#include <Schedule.h>
+
+// Schedule on the host: events come due as the second of day passes them,
+// a jump longer than SCHEDULE_MAX_CATCHUP seeks instead of catching up.
+
+Schedule schedule;
+
+void setUp()
+{
+    schedule.Clear();
+}
+
+void tearDown()
+{
+}
+
+void Test_FiresInTimeOrder()
+{
+    uint8_t id;
+    schedule.Add(20, 2);
+    schedule.Add(5, 0);
+    schedule.Add(10, 1);
+    schedule.Build();
+
+    TEST_ASSERT_TRUE(schedule.Sync(0));
+    TEST_ASSERT_FALSE(schedule.Next(&id));
+
+    schedule.Sync(10);
+    TEST_ASSERT_TRUE(schedule.Next(&id));
+    TEST_ASSERT_EQUAL_UINT8(0, id);
+    TEST_ASSERT_TRUE(schedule.Next(&id));
+    TEST_ASSERT_EQUAL_UINT8(1, id);
+    TEST_ASSERT_FALSE(schedule.Next(&id));
+
+    schedule.Sync(20);
+    TEST_ASSERT_TRUE(schedule.Next(&id));
+    TEST_ASSERT_EQUAL_UINT8(2, id);
+    TEST_ASSERT_FALSE(schedule.Next(&id));
+}
+
+void Test_SameSecondKeepsAddOrder()
+{
+    uint8_t id;
+    schedule.Add(30, 7);
+    schedule.Add(30, 3);
+    schedule.Build();
+
+    schedule.Sync(0);
+    schedule.Sync(30);
+    TEST_ASSERT_TRUE(schedule.Next(&id));
+    TEST_ASSERT_EQUAL_UINT8(7, id);
+    TEST_ASSERT_TRUE(schedule.Next(&id));
+    TEST_ASSERT_EQUAL_UINT8(3, id);
+}
+
+void Test_SeekSkipsMissedEvents()
+{
+    uint8_t id;
+    schedule.Add(100, 1);
+    schedule.Add(200, 2);
+    schedule.Add(300, 3);
+    schedule.Build();
+
+    schedule.Sync(0);
+    TEST_ASSERT_TRUE(schedule.Sync(150));
+    TEST_ASSERT_FALSE(schedule.Next(&id));
+
+    TEST_ASSERT_FALSE(schedule.Sync(200));
+    TEST_ASSERT_TRUE(schedule.Next(&id));
+    TEST_ASSERT_EQUAL_UINT8(2, id);
+    TEST_ASSERT_FALSE(schedule.Next(&id));
+}
+
+void Test_SeekPastLastWrapsToFirst()
+{
+    uint8_t id;
+    schedule.Add(100, 1);
+    schedule.Add(200, 2);
+    schedule.Build();
+
+    schedule.Sync(SECONDS_PER_DAY - 10);
+    schedule.Sync(50);
+    TEST_ASSERT_FALSE(schedule.Next(&id));
+
+    schedule.Sync(100);
+    TEST_ASSERT_TRUE(schedule.Next(&id));
+    TEST_ASSERT_EQUAL_UINT8(1, id);
+}
+
+void Test_CatchUpAcrossMidnight()
+{
+    uint8_t id;
+    schedule.Add(Schedule::SecondOfDay(23, 59, 59), 1);
+    schedule.Add(0, 2);
+    schedule.Build();
+
+    schedule.Sync(SECONDS_PER_DAY - 10);
+    TEST_ASSERT_FALSE(schedule.Sync(10));
+    TEST_ASSERT_TRUE(schedule.Next(&id));
+    TEST_ASSERT_EQUAL_UINT8(1, id);
+    TEST_ASSERT_TRUE(schedule.Next(&id));
+    TEST_ASSERT_EQUAL_UINT8(2, id);
+    TEST_ASSERT_FALSE(schedule.Next(&id));
+}
+
+void Test_WindowAcrossMidnight()
+{
+    uint32_t start = Schedule::SecondOfDay(22, 0, 0);
+    uint32_t stop = Schedule::SecondOfDay(6, 0, 0);
+
+    TEST_ASSERT_TRUE(Schedule::IsInWindow(start, stop, Schedule::SecondOfDay(23, 0, 0)));
+    TEST_ASSERT_TRUE(Schedule::IsInWindow(start, stop, Schedule::SecondOfDay(5, 0, 0)));
+    TEST_ASSERT_FALSE(Schedule::IsInWindow(start, stop, Schedule::SecondOfDay(12, 0, 0)));
+    TEST_ASSERT_FALSE(Schedule::IsInWindow(start, stop, start));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_FiresInTimeOrder);
+    RUN_TEST(Test_SameSecondKeepsAddOrder);
+    RUN_TEST(Test_SeekSkipsMissedEvents);
+    RUN_TEST(Test_SeekPastLastWrapsToFirst);
+    RUN_TEST(Test_CatchUpAcrossMidnight);
+    RUN_TEST(Test_WindowAcrossMidnight);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+#include <unity.h>
+#include <Weather.h>
+
+// The sky is a function of the seed and the time of day only: the same seed
+// plays the same levels and flashes, however the run got to that time.
+
+#define TEST_SEED       0x5EED1234UL
+#define TEST_START_MS   (14UL * 3600000UL)
+#define TEST_STEPS      45000   // half an hour
+#define TEST_DEPTH      80
+
+uint16_t scales[TEST_STEPS];
+bool flashes[TEST_STEPS];
+
+void Record(uint32_t seed, uint8_t mode)
+{
+    Weather weather;
+    weather.SetMode(mode, TEST_DEPTH);
+
+    for(uint32_t i = 0; i < TEST_STEPS; i++)
+    {
+        weather.Update(seed, TEST_START_MS + i * WEATHER_STEP_MS);
+        scales[i] = weather.GetScale();
+        flashes[i] = weather.IsFlash();
+    }
+}
+
+// Steps that differ from the recording
+uint32_t CountChanges(uint32_t seed, uint8_t mode)
+{
+    Weather weather;
+    uint32_t changes = 0;
+    weather.SetMode(mode, TEST_DEPTH);
+
+    for(uint32_t i = 0; i < TEST_STEPS; i++)
+    {
+        weather.Update(seed, TEST_START_MS + i * WEATHER_STEP_MS);
+        if(weather.GetScale() != scales[i] || weather.IsFlash() != flashes[i])
+        {
+            changes++;
+        }
+    }
+
+    return changes;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void Test_SameSeedSameClouds()
+{
+    Record(TEST_SEED, WEATHER_CLOUDS);
+    TEST_ASSERT_EQUAL_UINT32(0, CountChanges(TEST_SEED, WEATHER_CLOUDS));
+}
+
+void Test_SameSeedSameStorm()
+{
+    Record(TEST_SEED, WEATHER_STORM);
+    TEST_ASSERT_EQUAL_UINT32(0, CountChanges(TEST_SEED, WEATHER_STORM));
+}
+
+void Test_SkyMoves()
+{
+    uint16_t lowest = WEATHER_ONE;
+    uint16_t highest = 0;
+    Record(TEST_SEED, WEATHER_STORM);
+
+    for(uint32_t i = 0; i < TEST_STEPS; i++)
+    {
+        if(scales[i] < lowest) {lowest = scales[i];}
+        if(scales[i] > highest) {highest = scales[i];}
+    }
+
+    TEST_ASSERT_TRUE(lowest < highest);
+    TEST_ASSERT_TRUE(lowest >= WEATHER_ONE - TEST_DEPTH * WEATHER_ONE / 100);
+    TEST_ASSERT_TRUE(CountChanges(TEST_SEED + 1, WEATHER_STORM) > 0);
+}
+
+void Test_ResumeMidDay()
+{
+    Weather weather;
+    uint32_t half = TEST_STEPS / 2;
+    Record(TEST_SEED, WEATHER_STORM);
+
+    // As after a reboot, the first update lands in the middle of the run
+    weather.SetMode(WEATHER_STORM, TEST_DEPTH);
+    for(uint32_t i = half; i < TEST_STEPS; i++)
+    {
+        weather.Update(TEST_SEED, TEST_START_MS + i * WEATHER_STEP_MS);
+        TEST_ASSERT_EQUAL_UINT16(scales[i], weather.GetScale());
+        TEST_ASSERT_EQUAL(flashes[i], weather.IsFlash());
+    }
+}
+
+void Test_OffLeavesFullScale()
+{
+    Weather weather;
+    weather.SetMode(WEATHER_MODE_COUNT, TEST_DEPTH);
+
+    TEST_ASSERT_FALSE(weather.IsActive());
+    TEST_ASSERT_FALSE(weather.Update(TEST_SEED, TEST_START_MS));
+    TEST_ASSERT_EQUAL_UINT16(WEATHER_ONE, weather.GetScale());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_SameSeedSameClouds);
+    RUN_TEST(Test_SameSeedSameStorm);
+    RUN_TEST(Test_SkyMoves);
+    RUN_TEST(Test_ResumeMidDay);
+    RUN_TEST(Test_OffLeavesFullScale);
+    return UNITY_END();
+}